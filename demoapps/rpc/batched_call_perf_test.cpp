@@ -0,0 +1,151 @@
+/*  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <utility>
+#include <graphlab/rpc/dc.hpp>
+#include <graphlab/rpc/dc_dist_object.hpp>
+#include <graphlab/rpc/batched_remote_call.hpp>
+#include <graphlab/rpc/dc_init_from_mpi.hpp>
+#include <graphlab/util/mpi_tools.hpp>
+#include <graphlab/util/timer.hpp>
+using namespace graphlab;
+
+/*
+ * Compares the rate of tiny calls (a vertex id and a value, as when
+ * signalling vertices) issued through remote_call against the same calls
+ * issued through a batched_remote_call.
+ */
+
+#define NUM_CALLS (16 * 1024 * 1024)
+
+typedef std::pair<uint32_t, double> signal_type;
+
+struct teststruct {
+
+  dc_dist_object<teststruct> rmi;
+  batched_remote_call<signal_type> batched_signal;
+  atomic<size_t> ctr;
+  atomic<size_t> batches;
+
+  teststruct(distributed_control &dc, size_t numthreads):
+    rmi(dc, this),
+    batched_signal(dc, boost::bind(&teststruct::receive_signal_batch,
+                                   this, _1, _2),
+                   numthreads) {
+    dc.barrier();
+  }
+
+  /**
+   *  Receivers
+   */
+  void receive_signal(uint32_t vid, double value) {
+    ctr.inc();
+  }
+
+  void receive_signal_batch(procid_t src, std::vector<signal_type>& calls) {
+    ctr.inc(calls.size());
+    batches.inc();
+  }
+
+
+  /**
+   * Senders
+   */
+  void perform_plain_sends(size_t number) {
+    for (size_t i = 0;i < number; ++i) {
+      rmi.remote_call(1, &teststruct::receive_signal, uint32_t(i), 1.0);
+    }
+  }
+
+  void perform_batched_sends(size_t number, size_t thread_id) {
+    for (size_t i = 0;i < number; ++i) {
+      batched_signal.call(1, signal_type(uint32_t(i), 1.0), thread_id);
+    }
+    batched_signal.partial_flush(thread_id);
+  }
+
+
+  void run(size_t numthreads, bool batched) {
+    ctr.value = 0;
+    batches.value = 0;
+    rmi.barrier();
+    if (rmi.procid() == 1) {
+      rmi.full_barrier();
+      rmi.barrier();
+      std::cout << "Received " << ctr.value << " calls";
+      if (batched) std::cout << " in " << batches.value << " batches";
+      std::cout << "\n";
+      rmi.barrier();
+      return;
+    }
+    std::cout << numthreads << " threaded "
+              << (batched ? "batched_remote_call" : "remote_call") << ", "
+              << NUM_CALLS << " calls\n";
+    timer ti;
+    ti.start();
+    fiber_group thrgrp;
+    size_t numsends = NUM_CALLS / numthreads;
+    for (size_t i = 0; i < numthreads; ++i) {
+      fiber_control::affinity_type affinity;
+      affinity.clear(); affinity.set_bit(i % fiber_control::get_instance().num_workers());
+      if (batched) {
+        thrgrp.launch(boost::bind(&teststruct::perform_batched_sends, this,
+                                  numsends, i), affinity);
+      } else {
+        thrgrp.launch(boost::bind(&teststruct::perform_plain_sends, this,
+                                  numsends), affinity);
+      }
+    }
+    thrgrp.join();
+    double t1 = ti.current_time();
+    rmi.dc().flush();
+    rmi.full_barrier();
+    double t2 = ti.current_time();
+    std::cout << "Calls issued at " << numsends * numthreads / t1 << " calls/s\n";
+    std::cout << "Calls completed at " << numsends * numthreads / t2 << " calls/s\n";
+    rmi.barrier();
+    rmi.barrier();
+  }
+};
+
+
+int main(int argc, char** argv) {
+  // init MPI
+  mpi_tools::init(argc, argv);
+  distributed_control dc;
+
+  if (dc.numprocs() != 2) {
+    std::cout << "Run with exactly 2 MPI nodes.\n";
+    return 0;
+  }
+  dc.barrier();
+  size_t maxthreads = 8;
+  teststruct ts(dc, maxthreads);
+  for (size_t numthreads = 1; numthreads <= maxthreads; numthreads *= 2) {
+    ts.run(numthreads, false);
+    ts.run(numthreads, true);
+  }
+  dc.barrier();
+  mpi_tools::finalize();
+}
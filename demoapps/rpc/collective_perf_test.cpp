@@ -0,0 +1,164 @@
+/*  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <vector>
+#include <string>
+#include <graphlab/rpc/dc.hpp>
+#include <graphlab/rpc/dc_dist_object.hpp>
+#include <graphlab/rpc/dc_init_from_mpi.hpp>
+#include <graphlab/util/mpi_tools.hpp>
+#include <graphlab/util/timer.hpp>
+using namespace graphlab;
+
+#define NUM_ITERATIONS 1000
+
+void vector_plus_equal(std::vector<double>& left,
+                       const std::vector<double>& right) {
+  for (size_t i = 0;i < left.size(); ++i) left[i] += right[i];
+}
+
+/**
+ * Measures the per-call latency of the collective operations
+ * (all_reduce, all_gather, broadcast and gather) for each of the
+ * collective algorithms, and checks that the results are correct.
+ */
+struct collective_test {
+
+  dc_dist_object<collective_test> rmi;
+  collective_test(distributed_control &dc):rmi(dc, this) {
+    dc.barrier();
+  }
+
+  void print_res(const char* name, double t) {
+    if (rmi.procid() == 0) {
+      std::cout << name << ": " << t / NUM_ITERATIONS * 1000000
+                << " us per call\n";
+    }
+  }
+
+  void run_all_reduce() {
+    size_t expected = rmi.numprocs() * (rmi.numprocs() - 1) / 2;
+    rmi.barrier();
+    timer ti;
+    ti.start();
+    for (size_t i = 0;i < NUM_ITERATIONS; ++i) {
+      size_t val = rmi.procid();
+      rmi.all_reduce(val);
+      ASSERT_EQ(val, expected);
+    }
+    print_res("all_reduce<size_t>", ti.current_time());
+
+    // floating point reductions must produce the same value everywhere
+    double d = 1.0 / (rmi.procid() + 3);
+    rmi.all_reduce(d);
+    std::vector<double> all(rmi.numprocs());
+    all[rmi.procid()] = d;
+    rmi.all_gather(all);
+    for (size_t i = 0;i < all.size(); ++i) ASSERT_EQ(all[i], d);
+  }
+
+  void run_all_reduce_vector(size_t length) {
+    rmi.barrier();
+    timer ti;
+    ti.start();
+    for (size_t i = 0;i < NUM_ITERATIONS; ++i) {
+      std::vector<double> val(length, 1.0);
+      rmi.all_reduce2(val, vector_plus_equal);
+      ASSERT_EQ(val[0], (double)rmi.numprocs());
+    }
+    std::stringstream strm;
+    strm << "all_reduce2<vector<double>(" << length << ")>";
+    print_res(strm.str().c_str(), ti.current_time());
+  }
+
+  void run_all_gather() {
+    rmi.barrier();
+    timer ti;
+    ti.start();
+    for (size_t i = 0;i < NUM_ITERATIONS; ++i) {
+      std::vector<size_t> val(rmi.numprocs(), 0);
+      val[rmi.procid()] = rmi.procid() + i;
+      rmi.all_gather(val);
+      for (size_t j = 0;j < val.size(); ++j) ASSERT_EQ(val[j], j + i);
+    }
+    print_res("all_gather<size_t>", ti.current_time());
+  }
+
+  void run_broadcast() {
+    rmi.barrier();
+    timer ti;
+    ti.start();
+    for (size_t i = 0;i < NUM_ITERATIONS; ++i) {
+      procid_t root = (procid_t)(i % rmi.numprocs());
+      size_t val = (root == rmi.procid()) ? i : 0;
+      rmi.broadcast(val, root == rmi.procid());
+      ASSERT_EQ(val, i);
+    }
+    print_res("broadcast<size_t>", ti.current_time());
+  }
+
+  void run_gather() {
+    rmi.barrier();
+    timer ti;
+    ti.start();
+    for (size_t i = 0;i < NUM_ITERATIONS; ++i) {
+      procid_t root = (procid_t)(i % rmi.numprocs());
+      std::vector<size_t> val(rmi.numprocs(), 0);
+      val[rmi.procid()] = rmi.procid() + i;
+      rmi.gather(val, root);
+      if (root == rmi.procid()) {
+        for (size_t j = 0;j < val.size(); ++j) ASSERT_EQ(val[j], j + i);
+      }
+    }
+    print_res("gather<size_t>", ti.current_time());
+  }
+
+  void run(dc_collective_type type, const char* name) {
+    rmi.barrier();
+    rmi.set_collective_type(type);
+    if (rmi.procid() == 0) {
+      std::cout << "\n" << name << " collectives over "
+                << rmi.numprocs() << " machines\n";
+    }
+    run_all_reduce();
+    run_all_reduce_vector(16);
+    run_all_reduce_vector(16384);
+    run_all_gather();
+    run_broadcast();
+    run_gather();
+  }
+};
+
+
+int main(int argc, char** argv) {
+  // init MPI
+  mpi_tools::init(argc, argv);
+  distributed_control dc;
+
+  collective_test ct(dc);
+  ct.run(COLLECTIVE_WIDE_TREE, "Wide tree");
+  ct.run(COLLECTIVE_LOG_DEPTH, "Log depth");
+  dc.barrier();
+  mpi_tools::finalize();
+}
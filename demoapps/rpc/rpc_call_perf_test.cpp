@@ -83,6 +83,48 @@ struct teststruct {
 
 
 
+  /**
+   * Round trips. Compares calls queued for the handler threads with
+   * inline calls, which run on the receiving thread.
+   */
+  atomic<size_t> pongs;
+  void pong() {
+    pongs.inc();
+  }
+
+  void ping(bool use_inline) {
+    if (use_inline) {
+      rmi.inline_call(0, &teststruct::pong);
+    } else {
+      rmi.remote_call(0, &teststruct::pong);
+      rmi.dc().flush_soon(0);
+    }
+  }
+
+  void run_ping_pong(bool use_inline, size_t numtrips) {
+    if (rmi.procid() == 1) {
+      rmi.full_barrier();
+      return;
+    }
+    std::cout << numtrips << (use_inline ? " inline" : " queued")
+              << " call round trips\n";
+    timer ti;
+    ti.start();
+    for (size_t i = 0;i < numtrips; ++i) {
+      size_t prev = pongs.value;
+      if (use_inline) {
+        rmi.inline_call(1, &teststruct::ping, use_inline);
+      } else {
+        rmi.remote_call(1, &teststruct::ping, use_inline);
+        rmi.dc().flush_soon(1);
+      }
+      while (pongs.value == prev) sched_yield();
+    }
+    double t = ti.current_time();
+    std::cout << "Round trip latency: " << t * 1000000 / numtrips << " us\n\n";
+    rmi.full_barrier();
+  }
+
   void print_res(double t1, double t2, double t3) {
     std::cout << "Calls Sent at ";
     std::cout << SEND_LIMIT / t1 / 1024 / 1024 << " MB/s\n";
@@ -224,6 +266,9 @@ int main(int argc, char** argv) {
     ts.run_threaded_long_sends_0(10240, 8);
     ts.run_threaded_long_sends_0(10240, 16);
   */
+  ts.run_ping_pong(false, 10000);
+  ts.run_ping_pong(true, 10000);
+
   for (size_t i = 4; i < 24; ++i) {
     ts.run_string_sends_0(1<<i);
   }
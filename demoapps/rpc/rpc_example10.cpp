@@ -0,0 +1,78 @@
+/* 
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <iostream>
+#include <vector>
+#include <boost/bind.hpp>
+#include <graphlab/rpc/dc.hpp>
+#include <graphlab/parallel/atomic.hpp>
+using namespace graphlab;
+
+atomic<size_t> buffers_released;
+
+void release_vector(std::vector<double>* vec) {
+  delete vec;
+  buffers_released.inc();
+}
+
+void print_sum(size_t round, zero_copy_buffer buf) {
+  // buf points into the receive buffer and is only valid during the call
+  const double* values = reinterpret_cast<const double*>(buf.data());
+  size_t n = buf.size() / sizeof(double);
+  double sum = 0;
+  for (size_t i = 0; i < n; ++i) sum += values[i];
+  std::cout << "Round " << round << ": received " << n
+            << " values summing to " << sum << std::endl;
+}
+
+
+int main(int argc, char ** argv) {
+  // init MPI
+  mpi_tools::init(argc, argv);
+  distributed_control dc;
+
+  if (dc.numprocs() != 2) {
+    std::cout<< "RPC Example 10: Sending large buffers without copying\n";
+    std::cout << "Run with exactly 2 MPI nodes.\n";
+    return 0;
+  }
+
+  dc.barrier();
+  if (dc.procid() == 0) {
+    for (size_t round = 0; round < 5; ++round) {
+      std::vector<double>* vec = new std::vector<double>(1 << 20, round);
+      // The vector is handed to the socket directly and must not be
+      // modified until release_vector is called
+      zero_copy_buffer buf(&(*vec)[0], vec->size() * sizeof(double),
+                           boost::bind(release_vector, vec));
+      dc.remote_call(1, print_sum, round, buf);
+    }
+  }
+  dc.full_barrier();
+  if (dc.procid() == 0) {
+    std::cout << buffers_released.value << " buffers released" << std::endl;
+  }
+
+  mpi_tools::finalize();
+}
@@ -0,0 +1,101 @@
+/*
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <iostream>
+#include <vector>
+#include <graphlab/rpc/dc.hpp>
+using namespace graphlab;
+
+const size_t NUM_VALUES = 16;
+
+int main(int argc, char ** argv) {
+  // init MPI
+  mpi_tools::init(argc, argv);
+  distributed_control dc;
+
+  if (dc.numprocs() != 2) {
+    std::cout<< "RPC Example 11: One-sided access to remote memory\n";
+    std::cout << "Run with exactly 2 MPI nodes.\n";
+    return 0;
+  }
+
+  // Every machine exposes an array. Registering in the same order on
+  // every machine gives the arrays the same region id everywhere.
+  std::vector<int> local(NUM_VALUES);
+  for (size_t i = 0; i < NUM_VALUES; ++i) local[i] = 100 * dc.procid() + i;
+  size_t region = dc.register_memory_region(&local[0],
+                                            NUM_VALUES * sizeof(int));
+  dc.barrier();
+
+  if (dc.procid() == 0) {
+    // read values 4 to 7 of machine 1
+    int vals[4];
+    ASSERT_TRUE(dc.remote_get(1, region, 4 * sizeof(int),
+                              vals, sizeof(vals))());
+    for (size_t i = 0; i < 4; ++i) ASSERT_EQ(vals[i], int(104 + i));
+    std::cout << "Read " << vals[0] << " to " << vals[3]
+              << " from machine 1" << std::endl;
+
+    // overwrite the first two values of machine 1 and read them back
+    int newvals[2] = {-1, -2};
+    ASSERT_TRUE(dc.remote_put(1, region, 0, newvals, sizeof(newvals))());
+    ASSERT_TRUE(dc.remote_get(1, region, 0, vals, 2 * sizeof(int))());
+    ASSERT_EQ(vals[0], -1);
+    ASSERT_EQ(vals[1], -2);
+    std::cout << "Wrote " << vals[0] << " and " << vals[1]
+              << " to machine 1" << std::endl;
+
+    // this machine may be the target too
+    ASSERT_TRUE(dc.remote_put(0, region, 8 * sizeof(int),
+                              newvals, sizeof(newvals))());
+    ASSERT_EQ(local[8], -1);
+    ASSERT_EQ(local[9], -2);
+    ASSERT_TRUE(dc.remote_get(0, region, 15 * sizeof(int),
+                              vals, sizeof(int))());
+    ASSERT_EQ(vals[0], 15);
+
+    // accesses outside the region fail, and transfer nothing
+    vals[0] = 0;
+    ASSERT_FALSE(dc.remote_get(1, region, 15 * sizeof(int),
+                               vals, 2 * sizeof(int))());
+    ASSERT_FALSE(dc.remote_put(1, region, NUM_VALUES * sizeof(int),
+                               newvals, sizeof(int))());
+    ASSERT_FALSE(dc.remote_get(1, region + 1, 0, vals, sizeof(int))());
+    ASSERT_FALSE(dc.remote_get(0, region, 0, vals,
+                               (NUM_VALUES + 1) * sizeof(int))());
+    ASSERT_EQ(vals[0], 0);
+    std::cout << "Accesses outside the region failed" << std::endl;
+  }
+  dc.barrier();
+
+  if (dc.procid() == 1) {
+    ASSERT_EQ(local[0], -1);
+    ASSERT_EQ(local[1], -2);
+    for (size_t i = 2; i < NUM_VALUES; ++i) ASSERT_EQ(local[i], int(100 + i));
+  }
+  // nobody may access the array once it goes out of scope
+  dc.unregister_memory_region(region);
+  dc.barrier();
+  mpi_tools::finalize();
+}
@@ -200,6 +200,13 @@ namespace graphlab {
    * increases in throughput at a consistency penalty.
    * \li \b nfibers (default: 10000) Number of fibers to use
    * \li \b stacksize (default: 16384) Stacksize of each fiber.
+   * \li \b batch_gather (default: true) Coalesce the gather requests which
+   * concurrently running vertex programs send to the mirrors on the same
+   * machine into a single message and reply. Set to false to issue one
+   * request per mirror.
+   * \li \b gather_batch_size (default: 64) Maximum number of gathers in
+   * one batch. A mirror runs all the gathers of a batch in one handler
+   * thread, so this bounds the time a batch occupies that thread.
    */
   template<typename VertexProgram>
   class async_consistent_engine: public iengine<VertexProgram> {
@@ -385,6 +392,46 @@ namespace graphlab {
     };
     std::vector<vertex_fiber_cm_handle*> cm_handles;
 
+    /**
+     * A vertex program waiting for the gather results of its mirrors.
+     * Lives on the stack of the fiber running the program.
+     */
+    struct mirror_gather_waiter {
+      mutex lock;
+      conditional_gather_type accum;
+      // number of mirrors which have yet to reply
+      size_t remaining;
+      // if nonzero, the descheduled fiber to wake up
+      size_t fiber_handle;
+    };
+
+    /**
+     * Gather requests to the mirrors on one machine. Requests are sent
+     * immediately while fewer than max_gather_batches batches to that
+     * machine are awaiting replies. Otherwise they accumulate here and
+     * are sent when a reply arrives, split into batches of at most
+     * max_gather_batch_size so that the mirror can spread them over its
+     * handler threads.
+     */
+    struct mirror_gather_queue {
+      mirror_gather_queue():batches_inflight(0) { }
+      mutex lock;
+      size_t batches_inflight;
+      std::vector<vertex_id_type> vids;
+      std::vector<vertex_program_type> vprogs;
+      std::vector<size_t> waiters;
+    };
+    std::vector<mirror_gather_queue> gather_queues;
+
+    /// engine option. Sets to true if gather requests are batched
+    bool batch_gather;
+    /// Maximum number of gather batches awaiting replies from one machine
+    size_t max_gather_batches;
+    /// engine option. Maximum number of gathers in one batch
+    size_t max_gather_batch_size;
+    atomic<size_t> gather_batches_sent;
+    atomic<size_t> gather_requests_sent;
+
     dense_bitset program_running;
     dense_bitset hasnext;
 
@@ -447,6 +494,8 @@ namespace graphlab {
       stacksize = 16384;
       use_cache = false;
       factorized_consistency = true;
+      batch_gather = true;
+      max_gather_batch_size = 64;
       track_task_time = false;
       timed_termination = (size_t)(-1);
       termination_reason = execution_status::UNSET;
@@ -500,6 +549,15 @@ namespace graphlab {
           opts.get_engine_args().get_option("use_cache", use_cache);
           if (rmi.procid() == 0)
             logstream(LOG_EMPH) << "Engine Option: use_cache = " << use_cache << std::endl;
+        } else if (opt == "batch_gather") {
+          opts.get_engine_args().get_option("batch_gather", batch_gather);
+          if (rmi.procid() == 0)
+            logstream(LOG_EMPH) << "Engine Option: batch_gather = " << batch_gather << std::endl;
+        } else if (opt == "gather_batch_size") {
+          opts.get_engine_args().get_option("gather_batch_size", max_gather_batch_size);
+          if (max_gather_batch_size == 0) max_gather_batch_size = 1;
+          if (rmi.procid() == 0)
+            logstream(LOG_EMPH) << "Engine Option: gather_batch_size = " << max_gather_batch_size << std::endl;
         } else {
           logstream(LOG_FATAL) << "Unexpected Engine Option: " << opt << std::endl;
         }
@@ -553,6 +611,11 @@ namespace graphlab {
       if (!factorized_consistency) {
         cm_handles.resize(graph.num_local_vertices());
       }
+      gather_queues.resize(rmi.numprocs());
+      // aim for one batch per handler thread of the mirror machine. Its
+      // handler count is not known here, so this uses the local count and
+      // assumes every machine is started with the same number.
+      max_gather_batches = std::max<size_t>(rmi.dc().num_handler_threads(), 1);
       rmi.barrier();
     }
 
@@ -917,6 +980,114 @@ namespace graphlab {
     }
 
 
+    /**
+     * \internal
+     * Queues a gather on the mirror of vid on machine mirror. The result
+     * is added to the waiter, which is woken once all of its mirrors
+     * have replied.
+     */
+    void queue_mirror_gather(procid_t mirror, vertex_id_type vid,
+                             const vertex_program_type& vprog,
+                             mirror_gather_waiter* waiter) {
+      mirror_gather_queue& queue = gather_queues[mirror];
+      queue.lock.lock();
+      queue.vids.push_back(vid);
+      queue.vprogs.push_back(vprog);
+      queue.waiters.push_back(reinterpret_cast<size_t>(waiter));
+      if (queue.batches_inflight < max_gather_batches) {
+        send_gather_batches(mirror, queue);
+      } else {
+        queue.lock.unlock();
+      }
+    }
+
+    /**
+     * \internal
+     * Sends all the queued gather requests to machine mirror, in batches
+     * of at most max_gather_batch_size.
+     * Must be called with queue.lock held. Releases the lock.
+     */
+    void send_gather_batches(procid_t mirror, mirror_gather_queue& queue) {
+      std::vector<vertex_id_type> vids;
+      std::vector<vertex_program_type> vprogs;
+      std::vector<size_t> waiters;
+      vids.swap(queue.vids);
+      vprogs.swap(queue.vprogs);
+      waiters.swap(queue.waiters);
+      const size_t nbatches =
+          (vids.size() + max_gather_batch_size - 1) / max_gather_batch_size;
+      queue.batches_inflight += nbatches;
+      queue.lock.unlock();
+      gather_batches_sent.inc(nbatches);
+      gather_requests_sent.inc(vids.size());
+      if (nbatches == 1) {
+        rmi.remote_call(mirror, &engine_type::rpc_gather_batch,
+                        rmi.procid(), vids, vprogs, waiters);
+      } else {
+        for (size_t i = 0;i < vids.size(); i += max_gather_batch_size) {
+          const size_t end = std::min(i + max_gather_batch_size, vids.size());
+          rmi.remote_call(mirror, &engine_type::rpc_gather_batch,
+                          rmi.procid(),
+                          std::vector<vertex_id_type>(vids.begin() + i,
+                                                      vids.begin() + end),
+                          std::vector<vertex_program_type>(vprogs.begin() + i,
+                                                           vprogs.begin() + end),
+                          std::vector<size_t>(waiters.begin() + i,
+                                              waiters.begin() + end));
+        }
+      }
+      rmi.dc().flush_soon(mirror);
+    }
+
+    /**
+     * \internal
+     * Performs a batch of gathers requested by machine src and returns
+     * the results in one reply.
+     */
+    void rpc_gather_batch(procid_t src,
+                          const std::vector<vertex_id_type>& vids,
+                          std::vector<vertex_program_type>& vprogs,
+                          const std::vector<size_t>& waiters) {
+      std::vector<conditional_gather_type> results(vids.size());
+      for (size_t i = 0;i < vids.size(); ++i) {
+        results[i] = perform_gather(vids[i], vprogs[i]);
+      }
+      rmi.remote_call(src, &engine_type::rpc_gather_batch_reply,
+                      rmi.procid(), waiters, results);
+      rmi.dc().flush_soon(src);
+    }
+
+    /**
+     * \internal
+     * Hands the results of a gather batch to the waiting vertex programs,
+     * then sends the requests which queued up in the meantime.
+     */
+    void rpc_gather_batch_reply(procid_t mirror,
+                                const std::vector<size_t>& waiters,
+                                const std::vector<conditional_gather_type>& results) {
+      for (size_t i = 0;i < waiters.size(); ++i) {
+        mirror_gather_waiter* waiter =
+            reinterpret_cast<mirror_gather_waiter*>(waiters[i]);
+        waiter->lock.lock();
+        waiter->accum += results[i];
+        --waiter->remaining;
+        if (waiter->remaining == 0 && waiter->fiber_handle != 0) {
+          fiber_control::schedule_tid(waiter->fiber_handle);
+        }
+        // the waiter may be gone once the lock is released
+        waiter->lock.unlock();
+      }
+      mirror_gather_queue& queue = gather_queues[mirror];
+      queue.lock.lock();
+      --queue.batches_inflight;
+      if (queue.vids.empty()) {
+        queue.lock.unlock();
+      } else {
+        send_gather_batches(mirror, queue);
+      }
+    }
+
+
     void perform_scatter_local(lvid_type lvid,
                                vertex_program_type& vprog) {
       local_vertex_type local_vertex(graph.l_vertex(lvid));
@@ -1061,19 +1232,38 @@ namespace graphlab {
       /*                              Gather Phase                              */
       /**************************************************************************/
       conditional_gather_type gather_result;
-      std::vector<request_future<conditional_gather_type> > gather_futures;
-      foreach(procid_t mirror, local_vertex.mirrors()) {
-        gather_futures.push_back(
-            object_fiber_remote_request(rmi, 
-                                        mirror, 
-                                        &async_consistent_engine::perform_gather, 
-                                        vid,
-                                        vprog));
-      }
-      gather_result += perform_gather(vid, vprog);
+      if (batch_gather) {
+        mirror_gather_waiter waiter;
+        waiter.remaining = local_vertex.num_mirrors();
+        waiter.fiber_handle = 0;
+        foreach(procid_t mirror, local_vertex.mirrors()) {
+          queue_mirror_gather(mirror, vid, vprog, &waiter);
+        }
+        gather_result += perform_gather(vid, vprog);
+
+        waiter.lock.lock();
+        waiter.fiber_handle = fiber_control::get_tid();
+        while (waiter.remaining > 0) {
+          fiber_control::deschedule_self(&waiter.lock.m_mut);
+          waiter.lock.lock();
+        }
+        waiter.lock.unlock();
+        gather_result += waiter.accum;
+      } else {
+        std::vector<request_future<conditional_gather_type> > gather_futures;
+        foreach(procid_t mirror, local_vertex.mirrors()) {
+          gather_futures.push_back(
+              object_fiber_remote_request(rmi, 
+                                          mirror, 
+                                          &async_consistent_engine::perform_gather, 
+                                          vid,
+                                          vprog));
+        }
+        gather_result += perform_gather(vid, vprog);
 
-      for(size_t i = 0;i < gather_futures.size(); ++i) {
-        gather_result += gather_futures[i]();
+        for(size_t i = 0;i < gather_futures.size(); ++i) {
+          gather_result += gather_futures[i]();
+        }
       }
 
      /**************************************************************************/
@@ -1231,6 +1421,8 @@ namespace graphlab {
       force_stop = false;
       endgame_mode = false;
       programs_executed = 0;
+      gather_batches_sent = 0;
+      gather_requests_sent = 0;
       launch_timer.start();
 
       termination_reason = execution_status::RUNNING;
@@ -1266,6 +1458,23 @@ namespace graphlab {
       rmi.all_reduce(numadds);
       rmi.cout() << "Schedule Adds: " << numadds << std::endl;
 
+      if (batch_gather) {
+        size_t nbatches = gather_batches_sent.value;
+        size_t nrequests = gather_requests_sent.value;
+        rmi.all_reduce(nbatches);
+        rmi.all_reduce(nrequests);
+        rmi.cout() << "Mirror Gather Requests: " << nrequests
+                   << " in " << nbatches << " batches" << std::endl;
+      }
+
+      // cumulative over the life of the process
+      size_t stack_hits = fiber_control::get_instance().stack_pool_hits();
+      size_t stack_misses = fiber_control::get_instance().stack_pool_misses();
+      rmi.all_reduce(stack_hits);
+      rmi.all_reduce(stack_misses);
+      rmi.cout() << "Fiber Stack Pool Hits: " << stack_hits
+                 << " Misses: " << stack_misses << std::endl;
+
       if (track_task_time) {
         double total_task_time = 0;
         for (size_t i = 0;i < total_completion_time.size(); ++i) {
@@ -19,20 +19,36 @@
  *      http://www.graphlab.ml.cmu.edu
  *
  */
-
-
 #ifndef GRAPHLAB_MESSAGE_ARRAY_HPP
 #define GRAPHLAB_MESSAGE_ARRAY_HPP
 
 
+#include <cstring>
 #include <vector>
+#include <boost/type_traits.hpp>
 #include <graphlab/parallel/pthread_tools.hpp>
 #include <graphlab/parallel/atomic.hpp>
+#include <graphlab/parallel/fiber_control.hpp>
 #include <graphlab/scheduler/get_message_priority.hpp>
 namespace graphlab {
 
   /**
-   * \TODO DOCUMENT THIS CLASS
+   * Stores at most one message per vertex, combining messages added to
+   * the same vertex with operator+=, which must be associative.
+   *
+   * Every slot has its own atomic state (empty, busy or full) which is
+   * moved with compare and swap. The thread which moves a slot to busy
+   * owns its value until it moves it on to empty or full. Trivially
+   * copyable messages are combined with a compare and swap on their bits
+   * instead, without going through the busy state:
+   * \li Messages of at most 4 bytes are packed into a single 64 bit word
+   *     together with the state. Adding takes one compare and swap.
+   * \li Messages of at most 8 bytes keep the state in a separate word,
+   *     which also counts the adds in flight. get() waits for those to
+   *     finish before it takes the message.
+   *
+   * The join and add counters are kept per thread, so that adding
+   * messages does not write to a shared cache line.
    */ 
   
   template<typename ValueType>
@@ -41,59 +57,289 @@ namespace graphlab {
     typedef ValueType value_type;
 
   private:    
+    /// The states of a slot. An add in flight on a full wide slot adds
+    /// COMBINER to its state
+    enum { EMPTY = 0, BUSY = 1, FULL = 2, STATUS_MASK = 3, COMBINER = 4 };
+
+    /// How the messages are stored
+    enum { BOXED, PACKED, WIDE };
+    static const bool trivial = 
+        boost::has_trivial_copy<value_type>::value &&
+        boost::has_trivial_assign<value_type>::value &&
+        boost::has_trivial_destructor<value_type>::value;
+    static const int storage = 
+        !trivial ? BOXED :
+        sizeof(value_type) <= sizeof(uint32_t) ? PACKED :
+        sizeof(value_type) <= sizeof(uint64_t) ? WIDE : BOXED;
+    typedef boost::integral_constant<int, BOXED> boxed_tag;
+    typedef boost::integral_constant<int, PACKED> packed_tag;
+    typedef boost::integral_constant<int, WIDE> wide_tag;
+    typedef boost::integral_constant<int, storage> storage_type;
+    /// the full bit of a packed word. The message is in the low 32 bits
+    static const uint64_t PACKED_FULL = uint64_t(1) << 32;
+
     struct message_box {
       value_type value;
-      bool empty;
-
-      message_box() : empty(true) { }
-      /** returns false if element is already present */
-      inline bool add(const value_type& other, double& priority) {
-        if (empty) {
-          value = other;
-          empty = false;
-          priority = scheduler_impl::get_message_priority(value);
-          return true;
-        } else {
-          value += other;
-          priority = scheduler_impl::get_message_priority(value);
-          return false;
-        }
-      }
-                
-      void clear() {
-        value = value_type();
-        empty = true;
+      volatile int state;
+
+      message_box() : state(EMPTY) { }
+      /** Required for vector resize. Not thread safe */
+      message_box(const message_box& other) : 
+          value(other.value), state(other.state) { }
+      void operator=(const message_box& other) {
+        value = other.value; state = other.state;
       }
-      
     }; 
 
+    struct wide_box {
+      volatile uint64_t bits;
+      volatile int state;
+
+      wide_box() : bits(0), state(EMPTY) { }
+      /** Required for vector resize. Not thread safe */
+      wide_box(const wide_box& other) : 
+          bits(other.bits), state(other.state) { }
+      void operator=(const wide_box& other) {
+        bits = other.bits; state = other.state;
+      }
+    };
+
+    /// the slots of boxed messages
     std::vector<message_box> message_vector;
-    // lock array
-    simple_spinlock lock_array[65536];
-    size_t joincounter[65536];
-    size_t addcounter[65536];
+    /// the slots of packed messages
+    std::vector<uint64_t> packed_vector;
+    /// the slots of wide messages
+    std::vector<wide_box> wide_vector;
+
+    struct padded_counters {
+      size_t joins;
+      size_t adds;
+      char pad[64 - 2 * sizeof(size_t)];
+      padded_counters() : joins(0), adds(0) { }
+    };
+    enum { NUM_COUNTERS = 64 };
+    padded_counters counters[NUM_COUNTERS];
 
     /** Not assignable */
     void operator=(const message_array& other) { }
 
-    static size_t get_lock_idx(size_t i) {
-      return i % 65536;
+    /// the counters of the calling thread
+    padded_counters& my_counters() {
+      size_t worker = fiber_control::get_worker_id();
+      if (worker == (size_t)(-1)) worker = thread::thread_id();
+      return counters[worker % NUM_COUNTERS];
+    }
+
+    static uint64_t pack(const value_type& val) {
+      uint32_t bits = 0;
+      memcpy(&bits, &val, sizeof(value_type));
+      return uint64_t(bits) | PACKED_FULL;
+    }
+
+    static value_type unpack(uint64_t word) {
+      uint32_t bits = uint32_t(word);
+      value_type val;
+      memcpy(&val, &bits, sizeof(value_type));
+      return val;
+    }
+
+    static uint64_t to_bits(const value_type& val) {
+      uint64_t bits = 0;
+      memcpy(&bits, &val, sizeof(value_type));
+      return bits;
+    }
+
+    static value_type from_bits(uint64_t bits) {
+      value_type val;
+      memcpy(&val, &bits, sizeof(value_type));
+      return val;
     }
+
+    /** Moves the state to busy once it is not busy.
+        Returns the state it was in */
+    static int acquire(volatile int& state) {
+      while (1) {
+        int s = state;
+        if (s != BUSY && atomic_compare_and_swap(state, s, (int)BUSY)) {
+          return s;
+        }
+        asm volatile("pause\n": : :"memory");
+      }
+    }
+
+    /** Moves a wide slot to busy once it is empty or full with no adds in
+        flight. Returns the state it was in */
+    static int acquire_wide(volatile int& state) {
+      while (1) {
+        int s = state;
+        if ((s == EMPTY || s == FULL) &&
+            atomic_compare_and_swap(state, s, (int)BUSY)) {
+          return s;
+        }
+        asm volatile("pause\n": : :"memory");
+      }
+    }
+
+    static void release(volatile int& state, int s) {
+      __sync_synchronize();
+      state = s;
+    }
+
+    bool add(const size_t idx, const value_type& val,
+             double& priority, boxed_tag) {
+      message_box& box = message_vector[idx];
+      bool ret = (acquire(box.state) == EMPTY);
+      if (ret) box.value = val;
+      else box.value += val;
+      priority = scheduler_impl::get_message_priority(box.value);
+      release(box.state, FULL);
+      return ret;
+    }
+
+    bool add(const size_t idx, const value_type& val,
+             double& priority, packed_tag) {
+      volatile uint64_t& word = packed_vector[idx];
+      while (1) {
+        uint64_t old = word;
+        value_type newval = val;
+        if (old & PACKED_FULL) {
+          newval = unpack(old);
+          newval += val;
+        }
+        if (atomic_compare_and_swap(word, old, pack(newval))) {
+          priority = scheduler_impl::get_message_priority(newval);
+          return (old & PACKED_FULL) == 0;
+        }
+      }
+    }
+
+    bool add(const size_t idx, const value_type& val,
+             double& priority, wide_tag) {
+      wide_box& box = wide_vector[idx];
+      while (1) {
+        int s = box.state;
+        if ((s & STATUS_MASK) == FULL) {
+          // count myself in, so that get() waits for me
+          if (!atomic_compare_and_swap(box.state, s, s + (int)COMBINER)) continue;
+          value_type newval;
+          while (1) {
+            uint64_t old = box.bits;
+            newval = from_bits(old);
+            newval += val;
+            if (atomic_compare_and_swap(box.bits, old, to_bits(newval))) break;
+          }
+          __sync_fetch_and_sub(&box.state, (int)COMBINER);
+          priority = scheduler_impl::get_message_priority(newval);
+          return false;
+        } else if (s == EMPTY && 
+                   atomic_compare_and_swap(box.state, s, (int)BUSY)) {
+          box.bits = to_bits(val);
+          priority = scheduler_impl::get_message_priority(val);
+          release(box.state, FULL);
+          return true;
+        }
+        asm volatile("pause\n": : :"memory");
+      }
+    }
+
+    bool get(const size_t idx, value_type& ret_val, boxed_tag) {
+      message_box& box = message_vector[idx];
+      if (box.state == EMPTY) return false;
+      bool has_val = (acquire(box.state) == FULL);
+      if (has_val) {
+        ret_val = box.value;
+        box.value = value_type();
+      }
+      release(box.state, EMPTY);
+      return has_val;
+    }
+
+    bool get(const size_t idx, value_type& ret_val, packed_tag) {
+      volatile uint64_t& word = packed_vector[idx];
+      while (1) {
+        uint64_t old = word;
+        if ((old & PACKED_FULL) == 0) return false;
+        if (atomic_compare_and_swap(word, old, uint64_t(0))) {
+          ret_val = unpack(old);
+          return true;
+        }
+      }
+    }
+
+    bool get(const size_t idx, value_type& ret_val, wide_tag) {
+      wide_box& box = wide_vector[idx];
+      if (box.state == EMPTY) return false;
+      bool has_val = (acquire_wide(box.state) == FULL);
+      if (has_val) ret_val = from_bits(box.bits);
+      release(box.state, EMPTY);
+      return has_val;
+    }
+
+    bool peek(const size_t idx, value_type& ret_val, boxed_tag) {
+      message_box& box = message_vector[idx];
+      if (box.state == EMPTY) return false;
+      int s = acquire(box.state);
+      if (s == FULL) ret_val = box.value;
+      release(box.state, s);
+      return s == FULL;
+    }
+
+    bool peek(const size_t idx, value_type& ret_val, packed_tag) {
+      uint64_t word = packed_vector[idx];
+      if ((word & PACKED_FULL) == 0) return false;
+      ret_val = unpack(word);
+      return true;
+    }
+
+    bool peek(const size_t idx, value_type& ret_val, wide_tag) {
+      wide_box& box = wide_vector[idx];
+      while (box.state == BUSY) asm volatile("pause\n": : :"memory");
+      if ((box.state & STATUS_MASK) != FULL) return false;
+      ret_val = from_bits(box.bits);
+      return true;
+    }
+
+    void clear(const size_t idx, boxed_tag) {
+      message_box& box = message_vector[idx];
+      acquire(box.state);
+      box.value = value_type();
+      release(box.state, EMPTY);
+    }
+
+    void clear(const size_t idx, packed_tag) {
+      __sync_lock_test_and_set(&packed_vector[idx], uint64_t(0));
+    }
+
+    void clear(const size_t idx, wide_tag) {
+      acquire_wide(wide_vector[idx].state);
+      release(wide_vector[idx].state, EMPTY);
+    }
+
+    bool empty(const size_t idx, boxed_tag) const {
+      return message_vector[idx].state == EMPTY;
+    }
+
+    bool empty(const size_t idx, packed_tag) const {
+      return (packed_vector[idx] & PACKED_FULL) == 0;
+    }
+
+    bool empty(const size_t idx, wide_tag) const {
+      return wide_vector[idx].state == EMPTY;
+    }
+
   public:
     /** Initialize the per vertex task set */
-    message_array(size_t num_vertices = 0) :
-              message_vector(num_vertices) { 
-      for (size_t i = 0; i < 65536; ++i) {
-        joincounter[i] = 0; 
-        addcounter[i] = 0;
-      }
+    message_array(size_t num_vertices = 0) { 
+      resize(num_vertices);
     }
 
     /**
      * Resizes the number of elements this message vector can hold
      */
     void resize(size_t num_vertices) {
-      message_vector.resize(num_vertices);
+      if (storage == PACKED) packed_vector.resize(num_vertices, 0);
+      else if (storage == WIDE) wide_vector.resize(num_vertices);
+      else message_vector.resize(num_vertices);
     }
 
     /** Add a message to the set returning false if a message is already
@@ -102,12 +348,10 @@ namespace graphlab {
              const value_type& val,
              double* message_priority = NULL) {
       double priority;
-      size_t lockidx = get_lock_idx(idx);
-      lock_array[lockidx].lock();
-      bool ret = message_vector[idx].add(val, priority);
-      joincounter[lockidx] += !ret;
-      addcounter[lockidx]++;
-      lock_array[lockidx].unlock();
+      bool ret = add(idx, val, priority, storage_type());
+      padded_counters& c = my_counters();
+      __sync_fetch_and_add(&c.joins, size_t(!ret));
+      __sync_fetch_and_add(&c.adds, size_t(1));
       if (message_priority) (*message_priority) = priority;
       return ret;
     } 
@@ -119,16 +363,7 @@ namespace graphlab {
      */
     bool get(const size_t idx,
              value_type& ret_val) {
-      bool has_val = false;
-      size_t lockidx = get_lock_idx(idx);
-      lock_array[lockidx].lock();
-      if (!message_vector[idx].empty) {
-        ret_val = message_vector[idx].value;
-        message_vector[idx].clear();
-        has_val = true;
-      }
-      lock_array[lockidx].unlock();
-      return has_val;
+      return get(idx, ret_val, storage_type());
     }
 
     /** Returns the current message stored at idx. 
@@ -138,47 +373,37 @@ namespace graphlab {
      */
     bool peek(const size_t idx,
               value_type& ret_val) {
-      bool has_val = false;
-      size_t lockidx = get_lock_idx(idx);
-      lock_array[lockidx].lock();
-      if (!message_vector[idx].empty) {
-        ret_val = message_vector[idx].value;
-        has_val = true;
-      }
-      lock_array[lockidx].unlock();
-      return has_val;
+      return peek(idx, ret_val, storage_type());
     }
     
 
     /// clears the message at a particular idx
     void clear(const size_t idx) { 
-      size_t lockidx = get_lock_idx(idx);
-      lock_array[lockidx].lock();
-      message_vector[idx].clear(); 
-      lock_array[lockidx].unlock();
+      clear(idx, storage_type());
     }
 
     /// Returns true if the message at position idx is empty
     bool empty(const size_t idx) const {
-      return message_vector[idx].empty;
+      return empty(idx, storage_type());
     }
 
     bool empty() const {
-      for (size_t i = 0;i < message_vector.size(); ++i) {
-        if (!message_vector[i].empty) return false;
+      for (size_t i = 0;i < size(); ++i) {
+        if (!empty(i)) return false;
       }
       return true;
     }
 
     /// Returns the length of the message vector
     size_t size() const { 
-      return message_vector.size(); 
+      return storage == PACKED ? packed_vector.size() :
+             storage == WIDE ? wide_vector.size() : message_vector.size(); 
     }
     
     size_t num_joins() const { 
       size_t total_joins = 0;
-      for (size_t i = 0; i < 65536; ++i) {
-        total_joins += joincounter[i];
+      for (size_t i = 0; i < NUM_COUNTERS; ++i) {
+        total_joins += counters[i].joins;
       }
       return total_joins;
     }
@@ -186,15 +411,15 @@ namespace graphlab {
 
     size_t num_adds() const { 
       size_t total_adds = 0;
-      for (size_t i = 0; i < 65536; ++i) {
-        total_adds += addcounter[i];
+      for (size_t i = 0; i < NUM_COUNTERS; ++i) {
+        total_adds += counters[i].adds;
       }
       return total_adds;
     }
 
     /// not thread safe. Clears all contents
     void clear() {
-      for (size_t i = 0; i < message_vector.size(); ++i) clear(i);
+      for (size_t i = 0; i < size(); ++i) clear(i);
     }
 
     
@@ -0,0 +1,297 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_GRAPH_BINCSR_FORMAT_HPP
+#define GRAPHLAB_GRAPH_BINCSR_FORMAT_HPP
+
+#include <stdint.h>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <iostream>
+#include <boost/noncopyable.hpp>
+
+#include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/serialization/serialization_includes.hpp>
+#include <graphlab/util/varint.hpp>
+
+namespace graphlab {
+
+  /**
+   * \internal
+   * The "bincsr" binary graph format.
+   *
+   * A bincsr file is a sequence of independent chunks followed by an
+   * index of the chunks:
+   *
+   * \verbatim
+   *   file_header
+   *   chunk 0
+   *   chunk 1
+   *   ...
+   *   chunk_index_entry[nchunks]
+   *   file_trailer
+   * \endverbatim
+   *
+   * Every chunk starts with a chunk_header followed by NUM_COLUMNS
+   * columns stored back to back:
+   * \li \c ROW_VID_COLUMN The source vertex ids of the CSR rows,
+   *        increasing and delta + varint encoded.
+   * \li \c ROW_DEGREE_COLUMN The varint encoded number of edges in each
+   *        row, i.e. the differences of the CSR offsets.
+   * \li \c NEIGHBOR_COLUMN The target vertex ids of the edges. Targets are
+   *        sorted within each row and delta + varint encoded per row.
+   * \li \c VERTEX_VID_COLUMN The ids of the vertices stored in the chunk,
+   *        increasing and delta + varint encoded.
+   * \li \c VERTEX_DATA_COLUMN The serialized vertex data in the order of
+   *        VERTEX_VID_COLUMN.
+   * \li \c EDGE_DATA_COLUMN The serialized edge data in the order of
+   *        NEIGHBOR_COLUMN.
+   *
+   * Every edge and every vertex is stored exactly once over all the files
+   * making up a graph. Chunks can therefore be decoded independently and
+   * in any order, by any number of machines.
+   */
+  namespace bincsr {
+
+    /// "GLBCSR01" read as a little endian integer
+    static const uint64_t FILE_MAGIC = 0x3130525343424c47ULL;
+
+    /// Default target number of vertices + edges in a chunk
+    static const size_t DEFAULT_CHUNK_ELEMENTS = 1 << 20;
+
+    enum column_id {
+      ROW_VID_COLUMN = 0,
+      ROW_DEGREE_COLUMN,
+      NEIGHBOR_COLUMN,
+      VERTEX_VID_COLUMN,
+      VERTEX_DATA_COLUMN,
+      EDGE_DATA_COLUMN,
+      NUM_COLUMNS
+    };
+
+    struct file_header {
+      uint64_t magic;
+      uint64_t num_columns;
+    };
+
+    struct chunk_header {
+      uint64_t nrows;
+      uint64_t nedges;
+      uint64_t nvertices;
+      uint64_t column_bytes[NUM_COLUMNS];
+    };
+
+    struct chunk_index_entry {
+      /// Offset of the chunk_header from the start of the file
+      uint64_t offset;
+      /// Length of the chunk in bytes including the chunk_header
+      uint64_t length;
+      uint64_t nedges;
+      uint64_t nvertices;
+    };
+
+    struct file_trailer {
+      uint64_t nchunks;
+      uint64_t magic;
+    };
+
+
+    /// Orders (neighbor id, edge data) pairs by the neighbor id alone
+    struct neighbor_less {
+      template <typename Pair>
+      bool operator()(const Pair& a, const Pair& b) const {
+        return a.first < b.first;
+      }
+    };
+
+
+    /**
+     * \internal
+     * Accumulates the vertices and CSR rows of a single chunk in memory.
+     * Vertices must be added in increasing id order, rows must be added in
+     * increasing source id order and the edges of a row in increasing
+     * target id order.
+     */
+    template <typename VertexData, typename EdgeData>
+    class chunk_writer : boost::noncopyable {
+    public:
+      chunk_writer() { clear(); }
+      ~chunk_writer() {
+        free(vdata_arc.buf);
+        free(edata_arc.buf);
+      }
+
+      void add_vertex(vertex_id_type vid, const VertexData& vdata) {
+        put(VERTEX_VID_COLUMN, vid - last_vertex);
+        last_vertex = vid;
+        vdata_arc << vdata;
+        ++header.nvertices;
+      }
+
+      /// Starts a new row. Exactly degree calls to add_edge() must follow.
+      void add_row(vertex_id_type source, size_t degree) {
+        put(ROW_VID_COLUMN, source - last_source);
+        put(ROW_DEGREE_COLUMN, degree);
+        last_source = source;
+        last_target = 0;
+        ++header.nrows;
+      }
+
+      void add_edge(vertex_id_type target, const EdgeData& edata) {
+        put(NEIGHBOR_COLUMN, target - last_target);
+        last_target = target;
+        edata_arc << edata;
+        ++header.nedges;
+      }
+
+      size_t num_elements() const {
+        return header.nvertices + header.nedges;
+      }
+
+      /// Writes the chunk to out and returns the number of bytes written.
+      size_t write(std::ostream& out) {
+        const char* data[NUM_COLUMNS];
+        for (size_t i = 0; i < NUM_COLUMNS; ++i) {
+          header.column_bytes[i] = columns[i].size();
+          data[i] = columns[i].empty() ? NULL : &(columns[i][0]);
+        }
+        // the data columns are written straight out of the archive buffers
+        header.column_bytes[VERTEX_DATA_COLUMN] = vdata_arc.off;
+        data[VERTEX_DATA_COLUMN] = vdata_arc.buf;
+        header.column_bytes[EDGE_DATA_COLUMN] = edata_arc.off;
+        data[EDGE_DATA_COLUMN] = edata_arc.buf;
+
+        size_t length = sizeof(chunk_header);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(chunk_header));
+        for (size_t i = 0; i < NUM_COLUMNS; ++i) {
+          if (header.column_bytes[i] > 0) {
+            out.write(data[i], header.column_bytes[i]);
+            length += header.column_bytes[i];
+          }
+        }
+        return length;
+      }
+
+      const chunk_header& get_header() const { return header; }
+
+      void clear() {
+        memset(&header, 0, sizeof(chunk_header));
+        for (size_t i = 0; i < NUM_COLUMNS; ++i) columns[i].clear();
+        vdata_arc.off = 0;
+        edata_arc.off = 0;
+        last_vertex = last_source = last_target = 0;
+      }
+
+    private:
+      chunk_header header;
+      std::vector<char> columns[NUM_COLUMNS];
+      oarchive vdata_arc, edata_arc;
+      vertex_id_type last_vertex, last_source, last_target;
+
+      void put(column_id c, uint64_t v) {
+        unsigned char buf[varint::VARINT_MAX_BYTES];
+        const unsigned char* end = varint::encode(v, buf);
+        columns[c].insert(columns[c].end(), (const char*)buf, (const char*)end);
+      }
+    }; // end of chunk_writer
+
+
+    /**
+     * \internal
+     * Decodes a chunk in [begin, begin + length) calling
+     * graph.add_vertex(vid, vdata) for each vertex and
+     * graph.add_edge(source, target, edata) for each edge.
+     * Returns false if the chunk is malformed.
+     */
+    template <typename Graph>
+    bool decode_chunk(Graph& graph, const char* begin, size_t length) {
+      typedef typename Graph::vertex_data_type vertex_data_type;
+      typedef typename Graph::edge_data_type edge_data_type;
+      if (length < sizeof(chunk_header)) return false;
+      chunk_header header;
+      memcpy(&header, begin, sizeof(chunk_header));
+      const unsigned char* col[NUM_COLUMNS + 1];
+      col[0] = reinterpret_cast<const unsigned char*>(begin) + sizeof(chunk_header);
+      size_t total = sizeof(chunk_header);
+      for (size_t i = 0; i < NUM_COLUMNS; ++i) {
+        col[i + 1] = col[i] + header.column_bytes[i];
+        total += header.column_bytes[i];
+      }
+      if (total != length) return false;
+
+      // vertices
+      {
+        const unsigned char* vid_ptr = col[VERTEX_VID_COLUMN];
+        const unsigned char* vid_end = col[VERTEX_VID_COLUMN + 1];
+        iarchive iarc(reinterpret_cast<const char*>(col[VERTEX_DATA_COLUMN]),
+                      header.column_bytes[VERTEX_DATA_COLUMN]);
+        uint64_t vid = 0, delta;
+        for (size_t i = 0; i < header.nvertices; ++i) {
+          vid_ptr = varint::decode(vid_ptr, vid_end, delta);
+          if (vid_ptr == NULL) return false;
+          vid += delta;
+          vertex_data_type vdata;
+          iarc >> vdata;
+          graph.add_vertex(vid, vdata);
+        }
+        if (iarc.off != iarc.len) return false;
+      }
+      // edges
+      {
+        const unsigned char* row_ptr = col[ROW_VID_COLUMN];
+        const unsigned char* row_end = col[ROW_VID_COLUMN + 1];
+        const unsigned char* deg_ptr = col[ROW_DEGREE_COLUMN];
+        const unsigned char* deg_end = col[ROW_DEGREE_COLUMN + 1];
+        const unsigned char* nbr_ptr = col[NEIGHBOR_COLUMN];
+        const unsigned char* nbr_end = col[NEIGHBOR_COLUMN + 1];
+        iarchive iarc(reinterpret_cast<const char*>(col[EDGE_DATA_COLUMN]),
+                      header.column_bytes[EDGE_DATA_COLUMN]);
+        uint64_t source = 0, degree, delta;
+        size_t nedges = 0;
+        for (size_t i = 0; i < header.nrows; ++i) {
+          row_ptr = varint::decode(row_ptr, row_end, delta);
+          if (row_ptr == NULL) return false;
+          source += delta;
+          deg_ptr = varint::decode(deg_ptr, deg_end, degree);
+          if (deg_ptr == NULL) return false;
+          uint64_t target = 0;
+          for (size_t j = 0; j < degree; ++j) {
+            nbr_ptr = varint::decode(nbr_ptr, nbr_end, delta);
+            if (nbr_ptr == NULL) return false;
+            target += delta;
+            edge_data_type edata;
+            iarc >> edata;
+            graph.add_edge(source, target, edata);
+          }
+          nedges += degree;
+        }
+        if (nedges != header.nedges || iarc.off != iarc.len) return false;
+      }
+      return true;
+    } // end of decode_chunk
+
+  } // namespace bincsr
+} // namespace graphlab
+#endif
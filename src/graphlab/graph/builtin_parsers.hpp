@@ -23,6 +23,7 @@
 #define GRAPHLAB_GRAPH_BUILTIN_PARSERS_HPP
 
 #include <string>
+#include <cstring>
 #include <sstream>
 #include <iostream>
 
@@ -37,6 +38,8 @@
 #endif
 
 #include <graphlab/util/stl_util.hpp>
+#include <graphlab/util/timer.hpp>
+#include <graphlab/util/branch_hints.hpp>
 #include <graphlab/logger/logger.hpp>
 #include <graphlab/serialization/serialization_includes.hpp>
 
@@ -179,6 +182,156 @@ namespace graphlab {
     } // end of adj parser
 #endif
 
+    /**************************************************************************
+     *                     Mapped Range Parsers                               *
+     *                     ---------------------                              *
+     * Parsers which operate directly on a memory mapped range of a file.     *
+     * Lines are never copied into a std::string and integer ids are decoded  *
+     * straight out of the mapped pages.                                      *
+     **************************************************************************/
+
+    /**
+     * \internal
+     * Returns true if c is a whitespace character other than a newline.
+     */
+    inline bool is_blank(char c) {
+      return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+    }
+
+    /**
+     * \internal
+     * Skips the characters in [ptr, end) for which is_blank() (or
+     * c == sep if sep is not 0) holds, then decodes an unsigned decimal
+     * integer. Returns a pointer to the first character after the integer.
+     * If no digits are found, val is set to 0 and found is set to false.
+     */
+    inline const char* scan_uint(const char* ptr, const char* end,
+                                 size_t& val, bool& found, char sep = 0) {
+      while(ptr != end && (is_blank(*ptr) || (sep != 0 && *ptr == sep))) ++ptr;
+      size_t v = 0;
+      const char* start = ptr;
+      // branch free digit test: anything outside '0'..'9' wraps above 9
+      unsigned char d;
+      while(ptr != end && (d = (unsigned char)(*ptr - '0')) < 10) {
+        v = v * 10 + d;
+        ++ptr;
+      }
+      val = v;
+      found = (ptr != start);
+      return ptr;
+    } // end of scan_uint
+
+    /**
+     * \brief Parses a single SNAP line in the range [begin, end). The range
+     * does not include the newline. See snap_parser().
+     */
+    template <typename Graph>
+    bool snap_range_parser(Graph& graph, const char* begin, const char* end) {
+      if (*begin == '#') {
+        std::cout.write(begin, end - begin);
+        std::cout << std::endl;
+        return true;
+      }
+      size_t source, target; bool found;
+      const char* ptr = scan_uint(begin, end, source, found);
+      scan_uint(ptr, end, target, found);
+      if(source != target) graph.add_edge(source, target);
+      return true;
+    } // end of snap range parser
+
+    /**
+     * \brief Parses a single tsv line in the range [begin, end). The range
+     * does not include the newline. See tsv_parser().
+     */
+    template <typename Graph>
+    bool tsv_range_parser(Graph& graph, const char* begin, const char* end) {
+      size_t source, target; bool found;
+      const char* ptr = scan_uint(begin, end, source, found);
+      scan_uint(ptr, end, target, found);
+      if(source != target) graph.add_edge(source, target);
+      return true;
+    } // end of tsv range parser
+
+    /**
+     * \brief Parses a single csv line in the range [begin, end). The range
+     * does not include the newline. See csv_parser().
+     */
+    template <typename Graph>
+    bool csv_range_parser(Graph& graph, const char* begin, const char* end) {
+      const char* split =
+        reinterpret_cast<const char*>(memchr(begin, ',', end - begin));
+      if (split == NULL) return true;
+      size_t source, target; bool found;
+      scan_uint(begin, split, source, found);
+      scan_uint(split + 1, end, target, found);
+      graph.add_edge(source, target);
+      return true;
+    } // end of csv range parser
+
+    /**
+     * \brief Parses a single adjacency line in the range [begin, end). The
+     * range does not include the newline. See adj_parser().
+     */
+    template <typename Graph>
+    bool adj_range_parser(Graph& graph, const char* begin, const char* end) {
+      size_t source, n, target; bool found;
+      const char* ptr = scan_uint(begin, end, source, found);
+      if (!found) return false;
+      ptr = scan_uint(ptr, end, n, found, ',');
+      if (!found) return true;
+      size_t nadded = 0;
+      while(true) {
+        ptr = scan_uint(ptr, end, target, found, ',');
+        if (!found) break;
+        if (source != target) graph.add_edge(source, target);
+        ++nadded;
+      }
+      // anything left over on the line is not an integer
+      while(ptr != end && (is_blank(*ptr) || *ptr == ',')) ++ptr;
+      return ptr == end && n == nadded;
+    } // end of adj range parser
+
+    /**
+     * \brief Splits a mapped range of a file into lines and calls
+     * RangeParser on each non-empty line.
+     *
+     * Newlines are located with memchr() which is vectorized by the C
+     * library. The parser receives the line as a [begin, end) pair of
+     * pointers into the mapped range and must not retain them.
+     *
+     * Returns false and logs the failing line if RangeParser returns false.
+     */
+    template <typename Graph,
+              bool (*RangeParser)(Graph&, const char*, const char*)>
+    bool mapped_range_parser(Graph& graph, const std::string& srcfilename,
+                             const char* begin, const char* end) {
+      size_t linecount = 0;
+      timer ti; ti.start();
+      while(begin != end) {
+        const char* eol =
+          reinterpret_cast<const char*>(memchr(begin, '\n', end - begin));
+        if (eol == NULL) eol = end;
+        if (__likely__(eol != begin)) {
+          if (!RangeParser(graph, begin, eol)) {
+            logstream(LOG_WARNING)
+              << "Error parsing line " << linecount << " in "
+              << srcfilename << ": " << std::endl
+              << "\t\"" << std::string(begin, eol) << "\"" << std::endl;
+            return false;
+          }
+          ++linecount;
+          if (__unlikely__((linecount & 0xFFFF) == 0 &&
+                           ti.current_time() > 5.0)) {
+            logstream(LOG_INFO) << linecount << " Lines read" << std::endl;
+            ti.start();
+          }
+        }
+        begin = (eol == end) ? end : eol + 1;
+      }
+      return true;
+    } // end of mapped range parser
+
+
     template <typename Graph>
     struct tsv_writer{
       typedef typename Graph::vertex_type vertex_type;
@@ -48,6 +48,7 @@
 
 #include <graphlab/graph/graph_basic_types.hpp>
 #include <graphlab/graph/local_edge_buffer.hpp>
+#include <graphlab/graph/vertex_ordering.hpp>
 #include <graphlab/util/random.hpp>
 #include <graphlab/util/generics/shuffle.hpp>
 #include <graphlab/util/generics/counting_sort.hpp>
@@ -169,6 +170,39 @@ namespace graphlab {
     void reserve_edge_space(size_t n) {
       edge_buffer.reserve_edge_space(n);
     }
+
+    /**
+     * \brief Bounds the memory used to buffer edges before finalize().
+     * Edges beyond budget bytes are written to run files in directory
+     * and finalize() streams them into the CSR and CSC structures.
+     * A budget of 0 (the default) keeps all edges in memory.
+     */
+    void set_edge_buffer_budget(size_t budget, const std::string& directory) {
+      edge_buffer.set_spill_budget(budget, directory);
+    }
+
+    /**
+     * \brief Renumbers the vertices to improve the locality of the edge
+     * structure (see vertex_ordering). On return new_lvid[v] is the new id
+     * of the vertex formerly numbered v. Vertex data and buffered edges are
+     * moved to the new ids. Only valid while no edge has been finalized.
+     */
+    void reorder_vertices(vertex_ordering::method_type method,
+                          std::vector<lvid_type>& new_lvid) {
+      ASSERT_EQ(num_edges(), 0);
+      vertex_ordering::compute(method, edge_buffer, vertices.size(), new_lvid);
+      ASSERT_EQ(new_lvid.size(), vertices.size());
+      edge_buffer.relabel(new_lvid);
+      std::vector<VertexData> new_vertices(vertices.size());
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t i = 0; i < ssize_t(vertices.size()); ++i) {
+        new_vertices[new_lvid[i]] = vertices[i];
+      }
+      vertices.swap(new_vertices);
+    }
+
     /**
      * \brief Creates an edge connecting vertex source to vertex target.  Any
      * existing data will be cleared. Should not be called after finalization.
@@ -269,29 +303,54 @@ namespace graphlab {
       std::vector<edge_id_type> src_counting_prefix_sum;
       std::vector<edge_id_type> dest_counting_prefix_sum;
 
+      if (edge_buffer.has_spilled()) {
+        if (edges.size() == 0) {
+          // Edges exceeded the memory budget: stream the runs straight
+          // into the CSR and CSC without holding the edge buffer and the
+          // permutation arrays in memory.
+          std::vector< std::pair<lvid_type, edge_id_type> >  csr_values;
+          std::vector< std::pair<lvid_type, edge_id_type> >  csc_values;
+          edge_buffer.build_csr_csc(src_counting_prefix_sum, csr_values,
+                                    dest_counting_prefix_sum, csc_values, edges);
+          _csr_storage.wrap(src_counting_prefix_sum, csr_values);
+          _csc_storage.wrap(dest_counting_prefix_sum, csc_values);
+          ASSERT_EQ(_csr_storage.num_values(), edges.size());
+          logstream(LOG_INFO) << "Graph finalized from spilled edges in "
+                              << mytimer.current_time() << " secs" << std::endl;
+          return;
+        }
+        // incremental finalize needs all the new edges in memory
+        edge_buffer.unspill();
+      }
+
 #ifdef DEBUG_GRAPH
       logstream(LOG_DEBUG) << "Graph2 finalize: Sort by source vertex" << std::endl;
 #endif
-      counting_sort(edge_buffer.source_arr, dest_permute, &src_counting_prefix_sum);
+      parallel_counting_sort(edge_buffer.source_arr, dest_permute, &src_counting_prefix_sum);
 #ifdef DEBUG_GRAPH
       logstream(LOG_DEBUG) << "Graph2 finalize: Sort by dest id" << std::endl;
 #endif
-      counting_sort(edge_buffer.target_arr, src_permute, &dest_counting_prefix_sum);
+      parallel_counting_sort(edge_buffer.target_arr, src_permute, &dest_counting_prefix_sum);
 
       std::vector< std::pair<lvid_type, edge_id_type> >  csr_values;
       std::vector< std::pair<lvid_type, edge_id_type> >  csc_values;
 
-      csr_values.reserve(dest_permute.size());
+      csr_values.resize(dest_permute.size());
       edge_id_type begineid = edges.size();
-      for (size_t i = 0; i < dest_permute.size(); ++i) {
-        csr_values.push_back(std::pair<lvid_type, edge_id_type> (edge_buffer.target_arr[dest_permute[i]],
-                                                                 begineid + dest_permute[i]));
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t i = 0; i < ssize_t(dest_permute.size()); ++i) {
+        csr_values[i] = std::pair<lvid_type, edge_id_type> (edge_buffer.target_arr[dest_permute[i]],
+                                                            begineid + dest_permute[i]);
       }
-      csc_values.reserve(src_permute.size());
-
-      for (size_t i = 0; i < src_permute.size(); ++i) {
-        csc_values.push_back(std::pair<lvid_type, edge_id_type> (edge_buffer.source_arr[src_permute[i]],
-                                                                 begineid + src_permute[i]));
+      csc_values.resize(src_permute.size());
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t i = 0; i < ssize_t(src_permute.size()); ++i) {
+        csc_values[i] = std::pair<lvid_type, edge_id_type> (edge_buffer.source_arr[src_permute[i]],
+                                                            begineid + src_permute[i]);
       }
       ASSERT_EQ(csc_values.size(), csr_values.size());
 
@@ -38,8 +38,19 @@ namespace graphlab {
   typedef uint64_t vertex_id_type;
 #endif
 
+#ifdef USE_LVID64
   /// Identifier type of a vertex which is only locally consistent. Guaranteed to be integral
-  typedef vertex_id_type lvid_type;
+  typedef uint64_t lvid_type;
+#else
+  /**
+   * Identifier type of a vertex which is only locally consistent.
+   * Guaranteed to be integral. This is 32 bits wide regardless of
+   * vertex_id_type since a single partition never holds 4 billion
+   * vertices or edges; this halves the size of the CSR/CSC adjacency
+   * arrays. Define USE_LVID64 for larger partitions.
+   */
+  typedef uint32_t lvid_type;
+#endif
 
   /**
    * Identifier type of an edge which is only locally
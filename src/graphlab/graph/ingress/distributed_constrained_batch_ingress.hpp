@@ -30,7 +30,7 @@
 #include <graphlab/graph/ingress/distributed_ingress_base.hpp>
 #include <graphlab/rpc/buffered_exchange.hpp>
 #include <graphlab/rpc/distributed_event_log.hpp>
-#include <graphlab/util/dense_bitset.hpp>
+#include <graphlab/util/compact_bitset.hpp>
 #include <graphlab/graph/ingress/sharding_constraint.hpp>
 #include <graphlab/macros_def.hpp>
 namespace graphlab {
@@ -56,7 +56,7 @@ namespace graphlab {
     mutex local_graph_lock;
     mutex lvid2record_lock;
 
-    typedef fixed_dense_bitset<RPC_MAX_N_PROCS> bin_counts_type;
+    typedef compact_bitset bin_counts_type;
 
     /** Type of the degree hash table: 
      * a map from vertex id to a bitset of length num_procs. */
@@ -230,9 +230,14 @@ namespace graphlab {
 
     /** Updates the local part of the distributed table. */
     void block_add_degree_counts (procid_t pid, std::vector<vertex_id_type>& whohas) {
-      dht_degree_table_lock.readlock();
+      // bin_counts_type is not thread safe, so updates need the writelock
+      dht_degree_table_lock.writelock();
       foreach (vertex_id_type& vid, whohas) {
-        size_t idx = vid_to_dht_entry_with_readlock(vid);
+        size_t idx = (vid - rpc.procid()) / rpc.numprocs();
+        if (dht_degree_table.size() <= idx) {
+          size_t newsize = std::max(dht_degree_table.size() * 2, idx + 1);
+          dht_degree_table.resize(newsize);
+        }
         dht_degree_table[idx].set_bit_unsync(pid);
       }
       dht_degree_table_lock.unlock();
@@ -120,6 +120,14 @@ namespace graphlab {
 
     virtual ~distributed_ingress_base() { }
 
+    /**
+     * \brief Bounds the memory held by edges received from other machines
+     * before finalize(). See buffered_exchange::set_spill_budget().
+     */
+    void set_edge_exchange_budget(size_t budget, const std::string& directory) {
+      edge_exchange.set_spill_budget(budget, directory);
+    }
+
     /** \brief Add an edge to the ingress object. */
     virtual void add_edge(vertex_id_type source, vertex_id_type target,
                           const EdgeData& edata) {
@@ -244,6 +252,8 @@ namespace graphlab {
       { // Add all the edges to the local graph
         logstream(LOG_INFO) << "Graph Finalize: constructing local graph" << std::endl;
         const size_t nedges = edge_exchange.size()+1;
+        ASSERT_MSG(graph.local_graph.num_edges() + nedges < size_t(edge_id_type(-1)),
+                   "Too many local edges for edge_id_type. Reconfigure with --lvid64.");
         graph.local_graph.reserve_edge_space(nedges + 1);      
         edge_buffer_type edge_buffer;
         procid_t proc;
@@ -281,11 +291,33 @@ namespace graphlab {
         } // end for loop over buffers
         edge_exchange.clear();
 
+        ASSERT_MSG(graph.vid2lvid.size() + vid2lvid_buffer.size() < size_t(lvid_type(-1)),
+                   "Too many local vertices for lvid_type. Reconfigure with --lvid64.");
         ASSERT_EQ(graph.vid2lvid.size()  + vid2lvid_buffer.size(), graph.local_graph.num_vertices());
         if(rpc.procid() == 0)  {
           memory_info::log_usage("Finished populating local graph.");
         }
 
+        // Renumber the new local vertices before the edge structure is
+        // built. Only the first finalize may do this since later ones
+        // must keep the lvids already handed out.
+        if (graph.vertex_order != vertex_ordering::NONE) {
+          if (graph.vid2lvid.size() == 0) {
+            std::vector<lvid_type> new_lvid;
+            graph.local_graph.reorder_vertices(graph.vertex_order, new_lvid);
+            for (typename vid2lvid_map_type::iterator it = vid2lvid_buffer.begin();
+                 it != vid2lvid_buffer.end(); ++it) {
+              it->second = new_lvid[it->second];
+            }
+            if(rpc.procid() == 0)  {
+              memory_info::log_usage("Finished reordering local vertices.");
+            }
+          } else {
+            logstream(LOG_INFO) << "Graph Finalize: local vertices already "
+                                << "assigned, vertex_order is skipped." << std::endl;
+          }
+        }
+
         // Finalize local graph
         logstream(LOG_INFO) << "Graph Finalize: finalizing local graph." 
                             << std::endl;
@@ -391,6 +423,8 @@ namespace graphlab {
         // receive all vids owned by me
         mutex flying_vids_lock;
         boost::unordered_map<vertex_id_type, mirror_type> flying_vids;
+        // mirror_type is not thread safe. Stripe the updates over a set of locks.
+        std::vector<simple_spinlock> mirror_locks(1024);
 #ifdef _OPENMP
 #pragma omp parallel
 #endif
@@ -402,16 +436,21 @@ namespace graphlab {
               if (graph.vid2lvid.find(vid) == graph.vid2lvid.end()) {
                 if (vid2lvid_buffer.find(vid) == vid2lvid_buffer.end()) {
                   flying_vids_lock.lock();
-                  mirror_type& mirrors = flying_vids[vid];
+                  flying_vids[vid].set_bit(recvid);
                   flying_vids_lock.unlock();
-                  mirrors.set_bit(recvid);
                 } else {
                   lvid_type lvid = vid2lvid_buffer[vid];
+                  simple_spinlock& lock = mirror_locks[lvid % mirror_locks.size()];
+                  lock.lock();
                   graph.lvid2record[lvid]._mirrors.set_bit(recvid);
+                  lock.unlock();
                 }
               } else {
                 lvid_type lvid = graph.vid2lvid[vid];
+                simple_spinlock& lock = mirror_locks[lvid % mirror_locks.size()];
+                lock.lock();
                 graph.lvid2record[lvid]._mirrors.set_bit(recvid);
+                lock.unlock();
                 updated_lvids.set_bit(lvid);
               }
             }
@@ -25,12 +25,14 @@
 
 
 #include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/graph/graph_hash.hpp>
 #include <graphlab/graph/ingress/distributed_ingress_base.hpp>
 #include <graphlab/graph/ingress/ingress_edge_decision.hpp>
 #include <graphlab/graph/distributed_graph.hpp>
 #include <graphlab/rpc/buffered_exchange.hpp>
 #include <graphlab/rpc/distributed_event_log.hpp>
-#include <graphlab/util/dense_bitset.hpp>
+#include <graphlab/util/compact_bitset.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
 #include <graphlab/util/cuckoo_map_pow2.hpp>
 #include <graphlab/macros_def.hpp>
 namespace graphlab {
@@ -55,14 +57,27 @@ namespace graphlab {
 
     typedef distributed_ingress_base<VertexData, EdgeData> base_type;
     // typedef typename boost::unordered_map<vertex_id_type, std::vector<size_t> > degree_hash_table_type;
-    typedef fixed_dense_bitset<RPC_MAX_N_PROCS> bin_counts_type; 
+    typedef compact_bitset bin_counts_type; 
 
     /** Type of the degree hash table: 
      * a map from vertex id to a bitset of length num_procs. */
     typedef cuckoo_map_pow2<vertex_id_type, bin_counts_type,3,uint32_t> degree_hash_table_type;
-    degree_hash_table_type dht;
 
-    /** Array of number of edges on each proc. */
+    /** Number of independently locked pieces of the degree table. */
+    static const size_t NUM_DHT_SHARDS = 64;
+
+    /** A piece of the degree table and the lock protecting it. add_edge
+     * may be called from multiple threads; vertices are spread over the
+     * shards by hash so that edges on unrelated vertices do not contend. */
+    struct dht_shard {
+      degree_hash_table_type table;
+      padded_simple_spinlock lock;
+      dht_shard() : table(-1) { }
+    };
+    dht_shard dht[NUM_DHT_SHARDS];
+
+    /** Array of number of edges on each proc. Updated atomically by
+     * edge_to_proc_greedy. */
     std::vector<size_t> proc_num_edges;
 
     /** Ingress tratis. */
@@ -72,7 +87,7 @@ namespace graphlab {
   public:
     distributed_oblivious_ingress(distributed_control& dc, graph_type& graph, bool usehash = false, bool userecent = false) :
       base_type(dc, graph),
-      dht(-1),proc_num_edges(dc.numprocs()), usehash(usehash), userecent(userecent) { 
+      proc_num_edges(dc.numprocs()), usehash(usehash), userecent(userecent) { 
 
       //INITIALIZE_TRACER(ob_ingress_compute_assignments, "Time spent in compute assignment");
      }
@@ -82,20 +97,46 @@ namespace graphlab {
     /** Add an edge to the ingress object using oblivious greedy assignment. */
     void add_edge(vertex_id_type source, vertex_id_type target,
                   const EdgeData& edata) {
-      dht[source]; dht[target];
+      dht_shard& src_shard = get_shard(source);
+      dht_shard& dst_shard = get_shard(target);
+      lock_shards(src_shard, dst_shard);
+      src_shard.table[source]; dst_shard.table[target];
       const procid_t owning_proc = 
-        base_type::edge_decision.edge_to_proc_greedy(source, target, dht[source], dht[target], proc_num_edges, usehash, userecent);
+        base_type::edge_decision.edge_to_proc_greedy(source, target, src_shard.table[source], dst_shard.table[target], proc_num_edges, usehash, userecent);
+      unlock_shards(src_shard, dst_shard);
       typedef typename base_type::edge_buffer_record edge_buffer_record;
       edge_buffer_record record(source, target, edata);
       base_type::edge_exchange.send(owning_proc, record);
     } // end of add edge
 
     virtual void finalize() {
-     dht.clear();
+     for (size_t i = 0; i < NUM_DHT_SHARDS; ++i) dht[i].table.clear();
      distributed_ingress_base<VertexData, EdgeData>::finalize(); 
       
     }
 
+  private:
+    /** Returns the degree table shard holding vid. */
+    dht_shard& get_shard(vertex_id_type vid) {
+      return dht[graph_hash::hash_vertex(vid) % NUM_DHT_SHARDS];
+    }
+
+    /** Locks both shards, in address order to avoid deadlock. */
+    void lock_shards(dht_shard& a, dht_shard& b) {
+      if (&a == &b) {
+        a.lock.lock();
+      } else if (&a < &b) {
+        a.lock.lock(); b.lock.lock();
+      } else {
+        b.lock.lock(); a.lock.lock();
+      }
+    }
+
+    void unlock_shards(dht_shard& a, dht_shard& b) {
+      a.lock.unlock();
+      if (&a != &b) b.lock.unlock();
+    }
+
   }; // end of distributed_ob_ingress
 
 }; // end of namespace graphlab
@@ -26,7 +26,7 @@
 #include <graphlab/graph/graph_basic_types.hpp>
 #include <graphlab/graph/graph_hash.hpp>
 #include <graphlab/rpc/distributed_event_log.hpp>
-#include <graphlab/util/dense_bitset.hpp>
+#include <graphlab/util/compact_bitset.hpp>
 #include <boost/random/uniform_int_distribution.hpp>
 
 namespace graphlab {
@@ -39,7 +39,7 @@ namespace graphlab {
     public:
       typedef graphlab::vertex_id_type vertex_id_type;
       typedef distributed_graph<VertexData, EdgeData> graph_type;
-      typedef fixed_dense_bitset<RPC_MAX_N_PROCS> bin_counts_type; 
+      typedef compact_bitset bin_counts_type; 
 
     public:
       /** \brief A decision object for computing the edge assingment. */
@@ -68,9 +68,13 @@ namespace graphlab {
 
 
       /** Greedy assign (source, target) to a machine using: 
-       *  bitset<MAX_MACHINE> src_degree : the degree presence of source over machines
-       *  bitset<MAX_MACHINE> dst_degree : the degree presence of target over machines
+       *  bin_counts_type src_degree : the degree presence of source over machines
+       *  bin_counts_type dst_degree : the degree presence of target over machines
        *  vector<size_t>      proc_num_edges : the edge counts over machines
+       *
+       *  proc_num_edges may be shared by concurrent callers. It is read
+       *  once into a snapshot and the chosen count is incremented
+       *  atomically, so the balance term is approximate.
        * */
       procid_t edge_to_proc_greedy (const vertex_id_type source, 
           const vertex_id_type target,
@@ -86,13 +90,14 @@ namespace graphlab {
         double maxscore = 0.0;
         double epsilon = 1.0; 
         std::vector<double> proc_score(numprocs); 
-        size_t minedges = *std::min_element(proc_num_edges.begin(), proc_num_edges.end());
-        size_t maxedges = *std::max_element(proc_num_edges.begin(), proc_num_edges.end());
+        const std::vector<size_t> num_edges(proc_num_edges);
+        size_t minedges = *std::min_element(num_edges.begin(), num_edges.end());
+        size_t maxedges = *std::max_element(num_edges.begin(), num_edges.end());
 
         for (size_t i = 0; i < numprocs; ++i) {
           size_t sd = src_degree.get(i) + (usehash && (source % numprocs == i));
           size_t td = dst_degree.get(i) + (usehash && (target % numprocs == i));
-          double bal = (maxedges - proc_num_edges[i])/(epsilon + maxedges - minedges);
+          double bal = (maxedges - num_edges[i])/(epsilon + maxedges - minedges);
           proc_score[i] = bal + ((sd > 0) + (td > 0));
         }
         maxscore = *std::max_element(proc_score.begin(), proc_score.end());
@@ -115,14 +120,18 @@ namespace graphlab {
         }
         src_degree.set_bit(best_proc);
         dst_degree.set_bit(best_proc);
-        ++proc_num_edges[best_proc];
+        __sync_fetch_and_add(&proc_num_edges[best_proc], size_t(1));
         return best_proc;
       };
 
       /** Greedy assign (source, target) to a machine using: 
-       *  bitset<MAX_MACHINE> src_degree : the degree presence of source over machines
-       *  bitset<MAX_MACHINE> dst_degree : the degree presence of target over machines
+       *  bin_counts_type src_degree : the degree presence of source over machines
+       *  bin_counts_type dst_degree : the degree presence of target over machines
        *  vector<size_t>      proc_num_edges : the edge counts over machines
+       *
+       *  proc_num_edges may be shared by concurrent callers. It is read
+       *  once into a snapshot and the chosen count is incremented
+       *  atomically, so the balance term is approximate.
        * */
       procid_t edge_to_proc_greedy (const vertex_id_type source, 
           const vertex_id_type target,
@@ -140,14 +149,15 @@ namespace graphlab {
         double maxscore = 0.0;
         double epsilon = 1.0; 
         std::vector<double> proc_score(candidates.size()); 
-        size_t minedges = *std::min_element(proc_num_edges.begin(), proc_num_edges.end());
-        size_t maxedges = *std::max_element(proc_num_edges.begin(), proc_num_edges.end());
+        const std::vector<size_t> num_edges(proc_num_edges);
+        size_t minedges = *std::min_element(num_edges.begin(), num_edges.end());
+        size_t maxedges = *std::max_element(num_edges.begin(), num_edges.end());
 
         for (size_t j = 0; j < candidates.size(); ++j) {
           size_t i = candidates[j];
           size_t sd = src_degree.get(i) + (usehash && (source % numprocs == i));
           size_t td = dst_degree.get(i) + (usehash && (target % numprocs == i));
-          double bal = (maxedges - proc_num_edges[i])/(epsilon + maxedges - minedges);
+          double bal = (maxedges - num_edges[i])/(epsilon + maxedges - minedges);
           proc_score[j] = bal + ((sd > 0) + (td > 0));
         }
         maxscore = *std::max_element(proc_score.begin(), proc_score.end());
@@ -170,7 +180,7 @@ namespace graphlab {
         }
         src_degree.set_bit(best_proc);
         dst_degree.set_bit(best_proc);
-        ++proc_num_edges[best_proc];
+        __sync_fetch_and_add(&proc_num_edges[best_proc], size_t(1));
         return best_proc;
       };
 
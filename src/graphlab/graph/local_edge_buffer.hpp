@@ -24,11 +24,63 @@
 #ifndef GRAPHLAB_LOCAL_EDGE_BUFFER
 #define GRAPHLAB_LOCAL_EDGE_BUFFER
 
+#include <unistd.h>
+#include <cstdio>
 #include <vector>
+#include <string>
+#include <fstream>
+#include <algorithm>
 #include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/serialization/iarchive.hpp>
+#include <graphlab/serialization/oarchive.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/util/stl_util.hpp>
+#include <boost/type_traits/has_trivial_copy.hpp>
 
 namespace graphlab {    
 
+  namespace local_edge_buffer_impl {
+    /**
+     * \internal
+     * Writes and reads the edge data of a run. Edge data which cannot be
+     * copied byte for byte goes through the serialization system. The soft
+     * fail archives keep edge types without save() / load() usable when no
+     * spill budget is set: they only fail if a run is actually written.
+     */
+    template <typename EdgeData,
+              bool IsTrivial = boost::has_trivial_copy<EdgeData>::value>
+    struct edge_data_io {
+      static void write(std::ostream& out, const std::vector<EdgeData>& data) {
+        oarchive_soft_fail oarc(out);
+        for (size_t i = 0; i < data.size(); ++i) oarc << data[i];
+      }
+      static void read(std::istream& in, std::vector<EdgeData>& data) {
+        iarchive_soft_fail iarc(in);
+        for (size_t i = 0; i < data.size(); ++i) iarc >> data[i];
+      }
+    };
+
+    /**
+     * \internal
+     * Trivially copyable edge data is copied byte for byte so that edge
+     * types which do not implement save() / load() may still be spilled.
+     */
+    template <typename EdgeData>
+    struct edge_data_io<EdgeData, true> {
+      static void write(std::ostream& out, const std::vector<EdgeData>& data) {
+        for (size_t i = 0; i < data.size(); ++i) {
+          out.write(reinterpret_cast<const char*>(&data[i]), sizeof(EdgeData));
+        }
+      }
+      static void read(std::istream& in, std::vector<EdgeData>& data) {
+        for (size_t i = 0; i < data.size(); ++i) {
+          in.read(reinterpret_cast<char*>(&data[i]), sizeof(EdgeData));
+        }
+      }
+    };
+  } // end of namespace local_edge_buffer_impl
+
     template<typename VertexData, typename EdgeData>
     // Edge class for temporary storage. Will be finalized into the CSR+CSC form.
     class local_edge_buffer {
@@ -37,8 +89,11 @@ namespace graphlab {
       std::vector<lvid_type> source_arr;
       std::vector<lvid_type> target_arr;
     public:
-      local_edge_buffer() {}
+      local_edge_buffer() : spill_budget(0), nspilled(0) {}
+      ~local_edge_buffer() { remove_runs(); }
       void reserve_edge_space(size_t n) {
+        // do not reserve more than the spill budget allows
+        if (spill_budget > 0) n = std::min(n, spill_budget / bytes_per_edge());
         data.reserve(n);
         source_arr.reserve(n);
         target_arr.reserve(n);
@@ -48,6 +103,9 @@ namespace graphlab {
         data.push_back(_data);
         source_arr.push_back(source);
         target_arr.push_back(target);
+        if (spill_budget > 0 && size() * bytes_per_edge() >= spill_budget) {
+          spill();
+        }
       }
       // \brief Add edges in block to the temporary storage.
       void add_block_edges(const std::vector<lvid_type>& src_arr, 
@@ -56,14 +114,18 @@ namespace graphlab {
         data.insert(data.end(), edata_arr.begin(), edata_arr.end());
         source_arr.insert(source_arr.end(), src_arr.begin(), src_arr.end());
         target_arr.insert(target_arr.end(), dst_arr.begin(), dst_arr.end());
+        if (spill_budget > 0 && size() * bytes_per_edge() >= spill_budget) {
+          spill();
+        }
       }
       // \brief Remove all contents in the storage. 
       void clear() {
         std::vector<EdgeData>().swap(data);
         std::vector<lvid_type>().swap(source_arr);
         std::vector<lvid_type>().swap(target_arr);
+        remove_runs();
       }
-      // \brief Return the size of the storage.
+      // \brief Return the number of edges held in memory.
       size_t size() const {
         return source_arr.size();
       }
@@ -73,6 +135,287 @@ namespace graphlab {
           source_arr.capacity()*sizeof(lvid_type)*2 + 
           sizeof(data) + sizeof(source_arr)*2 + sizeof(local_edge_buffer);
       }
+
+
+      /**
+       * \brief Bounds the memory used by the buffer. Once the edges held in
+       * memory take more than budget bytes they are written to a run file in
+       * directory and released. A budget of 0 disables spilling.
+       */
+      void set_spill_budget(size_t budget, const std::string& directory) {
+        spill_budget = budget;
+        spill_directory = directory;
+      }
+
+      // \brief Returns true if some edges have been written to run files.
+      bool has_spilled() const { return !runs.empty(); }
+
+      // \brief Return the number of edges held in memory and in run files.
+      size_t total_size() const { return nspilled + size(); }
+
+      // \brief Reads all run files back into memory and removes them.
+      void unspill() {
+        if (!has_spilled()) return;
+        local_edge_buffer tail;
+        tail.data.swap(data);
+        tail.source_arr.swap(source_arr);
+        tail.target_arr.swap(target_arr);
+        reserve_exact(total_size());
+        for (size_t i = 0; i < runs.size(); ++i) {
+          std::vector<lvid_type> src, dst;
+          std::vector<EdgeData> edata;
+          load_run(i, src, dst, &edata);
+          append(src, dst, edata);
+        }
+        append(tail.source_arr, tail.target_arr, tail.data);
+        remove_runs();
+      }
+
+      /**
+       * \brief Builds the CSR and CSC index of all the edges in memory and in
+       * run files without sorting.
+       *
+       * Edges are read in two sequential passes. The first pass counts the
+       * in and out degree of every vertex. The second pass places every edge
+       * directly into its final CSR and CSC slot. Besides the outputs, only
+       * one run and the degree counters are in memory at any time.
+       *
+       * On return, edge i in CSR order has data edata[i] and target given by
+       * csr_values[i]. csc_values holds (source, edge id) pairs in CSC order.
+       * The prefix arrays hold the first CSR (CSC) slot of every source
+       * (target) vertex in the same form produced by counting_sort().
+       * The buffer is empty on return.
+       */
+      template <typename CSRValue>
+      void build_csr_csc(std::vector<edge_id_type>& src_prefix,
+                         std::vector<CSRValue>& csr_values,
+                         std::vector<edge_id_type>& dest_prefix,
+                         std::vector<std::pair<lvid_type, edge_id_type> >& csc_values,
+                         std::vector<EdgeData>& edata) {
+        const size_t nedges = total_size();
+        src_prefix.clear(); dest_prefix.clear();
+        if (nedges == 0) { clear(); return; }
+        // pass 1: count degrees
+        std::vector<lvid_type> src, dst;
+        for (size_t i = 0; i <= runs.size(); ++i) {
+          if (i < runs.size()) load_run(i, src, dst, NULL);
+          const std::vector<lvid_type>& s = (i < runs.size()) ? src : source_arr;
+          const std::vector<lvid_type>& t = (i < runs.size()) ? dst : target_arr;
+          for (size_t j = 0; j < s.size(); ++j) {
+            if (s[j] >= src_prefix.size()) src_prefix.resize(s[j] + 1, 0);
+            if (t[j] >= dest_prefix.size()) dest_prefix.resize(t[j] + 1, 0);
+            ++src_prefix[s[j]];
+            ++dest_prefix[t[j]];
+          }
+        }
+        to_exclusive_prefix(src_prefix);
+        to_exclusive_prefix(dest_prefix);
+
+        // pass 2: place edges. The cursors start at the prefix arrays.
+        std::vector<edge_id_type> src_cursor(src_prefix);
+        std::vector<edge_id_type> dest_cursor(dest_prefix);
+        csr_values.resize(nedges);
+        csc_values.resize(nedges);
+        edata.resize(nedges);
+        std::vector<EdgeData> run_data;
+        for (size_t i = 0; i <= runs.size(); ++i) {
+          if (i < runs.size()) load_run(i, src, dst, &run_data);
+          else {
+            src.swap(source_arr); dst.swap(target_arr); run_data.swap(data);
+          }
+          for (size_t j = 0; j < src.size(); ++j) {
+            const edge_id_type eid = src_cursor[src[j]]++;
+            set_csr_value(csr_values[eid], dst[j], eid);
+            edata[eid] = run_data[j];
+            csc_values[dest_cursor[dst[j]]++] = std::make_pair(src[j], eid);
+          }
+        }
+        clear();
+      }
+
+      /**
+       * \brief Adds the in and out degree of every vertex, over the edges in
+       * memory and in run files, to degree. degree is grown if an edge
+       * refers to a vertex beyond its end.
+       */
+      void count_degrees(std::vector<edge_id_type>& degree) const {
+        std::vector<lvid_type> src, dst;
+        for (size_t i = 0; i <= runs.size(); ++i) {
+          if (i < runs.size()) load_run(i, src, dst, NULL);
+          const std::vector<lvid_type>& s = (i < runs.size()) ? src : source_arr;
+          const std::vector<lvid_type>& t = (i < runs.size()) ? dst : target_arr;
+          for (size_t j = 0; j < s.size(); ++j) {
+            const size_t m = std::max(s[j], t[j]);
+            if (m >= degree.size()) degree.resize(m + 1, 0);
+            ++degree[s[j]];
+            ++degree[t[j]];
+          }
+        }
+      }
+
+      /**
+       * \brief Builds the adjacency of the graph with edge directions
+       * dropped. degree must be the output of count_degrees(). On return
+       * the neighbors of v are nbrs[prefix[v]] up to nbrs[prefix[v+1]]
+       * (or the end of nbrs for the last vertex).
+       */
+      void build_undirected_csr(const std::vector<edge_id_type>& degree,
+                                std::vector<edge_id_type>& prefix,
+                                std::vector<lvid_type>& nbrs) const {
+        prefix.assign(degree.begin(), degree.end());
+        to_exclusive_prefix(prefix);
+        nbrs.resize(2 * total_size());
+        std::vector<edge_id_type> cursor(prefix);
+        std::vector<lvid_type> src, dst;
+        for (size_t i = 0; i <= runs.size(); ++i) {
+          if (i < runs.size()) load_run(i, src, dst, NULL);
+          const std::vector<lvid_type>& s = (i < runs.size()) ? src : source_arr;
+          const std::vector<lvid_type>& t = (i < runs.size()) ? dst : target_arr;
+          for (size_t j = 0; j < s.size(); ++j) {
+            nbrs[cursor[s[j]]++] = t[j];
+            nbrs[cursor[t[j]]++] = s[j];
+          }
+        }
+      }
+
+      /**
+       * \brief Renames every vertex v to new_lvid[v], in memory and in the
+       * run files. Run files are rewritten in place.
+       */
+      void relabel(const std::vector<lvid_type>& new_lvid) {
+        relabel_array(source_arr, new_lvid);
+        relabel_array(target_arr, new_lvid);
+        std::vector<lvid_type> src, dst;
+        std::vector<EdgeData> edata;
+        for (size_t i = 0; i < runs.size(); ++i) {
+          load_run(i, src, dst, &edata);
+          relabel_array(src, new_lvid);
+          relabel_array(dst, new_lvid);
+          write_run(runs[i], src, dst, edata);
+        }
+      }
+
+    private:
+      size_t spill_budget;
+      std::string spill_directory;
+      std::vector<std::string> runs;
+      size_t nspilled;
+
+      static size_t bytes_per_edge() {
+        return sizeof(EdgeData) + 2 * sizeof(lvid_type);
+      }
+
+      static void set_csr_value(lvid_type& value, lvid_type target,
+                                edge_id_type) {
+        value = target;
+      }
+
+      static void set_csr_value(std::pair<lvid_type, edge_id_type>& value,
+                                lvid_type target, edge_id_type eid) {
+        value = std::make_pair(target, eid);
+      }
+
+      static void to_exclusive_prefix(std::vector<edge_id_type>& counts) {
+        edge_id_type sum = 0;
+        for (size_t i = 0; i < counts.size(); ++i) {
+          const edge_id_type c = counts[i];
+          counts[i] = sum;
+          sum += c;
+        }
+      }
+
+      void reserve_exact(size_t n) {
+        data.reserve(n);
+        source_arr.reserve(n);
+        target_arr.reserve(n);
+      }
+
+      void append(const std::vector<lvid_type>& src,
+                  const std::vector<lvid_type>& dst,
+                  const std::vector<EdgeData>& edata) {
+        data.insert(data.end(), edata.begin(), edata.end());
+        source_arr.insert(source_arr.end(), src.begin(), src.end());
+        target_arr.insert(target_arr.end(), dst.begin(), dst.end());
+      }
+
+      /**
+       * Writes the edges in memory to a new run file and releases them.
+       * A run stores the number of edges, the source array, the target
+       * array and then the serialized edge data.
+       */
+      void spill() {
+        if (size() == 0) return;
+        const std::string fname = spill_directory + "/graphlab_edges_" +
+          tostr(getpid()) + "_" + tostr(size_t(this)) + "_" + tostr(runs.size());
+        write_run(fname, source_arr, target_arr, data);
+        runs.push_back(fname);
+        nspilled += size();
+        // keep the capacity: the next run will use it again
+        data.clear(); source_arr.clear(); target_arr.clear();
+      }
+
+      static void write_run(const std::string& fname,
+                            const std::vector<lvid_type>& src,
+                            const std::vector<lvid_type>& dst,
+                            const std::vector<EdgeData>& edata) {
+        std::ofstream fout(fname.c_str(), std::ios_base::out | 
+                           std::ios_base::trunc | std::ios_base::binary);
+        if (!fout.good()) {
+          logstream(LOG_FATAL) << "Unable to create edge run file " << fname
+                               << std::endl;
+        }
+        const size_t n = src.size();
+        fout.write(reinterpret_cast<const char*>(&n), sizeof(size_t));
+        if (n > 0) {
+          fout.write(reinterpret_cast<const char*>(&src[0]), n * sizeof(lvid_type));
+          fout.write(reinterpret_cast<const char*>(&dst[0]), n * sizeof(lvid_type));
+        }
+        local_edge_buffer_impl::edge_data_io<EdgeData>::write(fout, edata);
+        if (fout.fail()) {
+          logstream(LOG_FATAL) << "Error writing edge run file " << fname
+                               << std::endl;
+        }
+      }
+
+      static void relabel_array(std::vector<lvid_type>& arr,
+                                const std::vector<lvid_type>& new_lvid) {
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (ssize_t i = 0; i < ssize_t(arr.size()); ++i) {
+          arr[i] = new_lvid[arr[i]];
+        }
+      }
+
+      /**
+       * Reads run i. If edata is NULL the edge data is not read.
+       */
+      void load_run(size_t i, std::vector<lvid_type>& src,
+                    std::vector<lvid_type>& dst,
+                    std::vector<EdgeData>* edata) const {
+        std::ifstream fin(runs[i].c_str(), std::ios_base::in | std::ios_base::binary);
+        size_t n = 0;
+        fin.read(reinterpret_cast<char*>(&n), sizeof(size_t));
+        src.resize(n); dst.resize(n);
+        if (n > 0) {
+          fin.read(reinterpret_cast<char*>(&src[0]), n * sizeof(lvid_type));
+          fin.read(reinterpret_cast<char*>(&dst[0]), n * sizeof(lvid_type));
+        }
+        if (edata != NULL) {
+          edata->resize(n);
+          local_edge_buffer_impl::edge_data_io<EdgeData>::read(fin, *edata);
+        }
+        if (fin.fail()) {
+          logstream(LOG_FATAL) << "Error reading edge run file " << runs[i]
+                               << std::endl;
+        }
+      }
+
+      void remove_runs() {
+        for (size_t i = 0; i < runs.size(); ++i) ::remove(runs[i].c_str());
+        runs.clear();
+        nspilled = 0;
+      }
     }; // end of class local_edge_buffer.
 } // end of namespace
 #endif
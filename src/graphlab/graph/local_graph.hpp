@@ -47,11 +47,13 @@
 
 #include <graphlab/graph/graph_basic_types.hpp>
 #include <graphlab/graph/local_edge_buffer.hpp>
+#include <graphlab/graph/vertex_ordering.hpp>
 #include <graphlab/util/random.hpp>
 #include <graphlab/util/generics/shuffle.hpp>
 #include <graphlab/util/generics/counting_sort.hpp>
 #include <graphlab/util/generics/vector_zip.hpp>
 #include <graphlab/util/generics/csr_storage.hpp>
+#include <graphlab/util/generics/delta_csr_storage.hpp>
 #include <graphlab/parallel/atomic.hpp>
 
 #include <graphlab/logger/logger.hpp>
@@ -165,12 +167,12 @@ namespace graphlab {
     // CONSTRUCTORS ============================================================>
     
     /** Create an empty local_graph. */
-    local_graph() : finalized(false) { }
+    local_graph() : finalized(false), compressed(false), csc_edge_order(false) { }
 
     /** Create a local_graph with nverts vertices. */
     local_graph(size_t nverts) :
       vertices(nverts),
-      finalized(false) { }
+      finalized(false), compressed(false), csc_edge_order(false) { }
 
     // METHODS =================================================================>
     
@@ -185,8 +187,10 @@ namespace graphlab {
       finalized = false;
       vertices.clear();
       edges.clear();
-      _csc_storage.clear();
-      _csr_storage.clear();
+      _secondary_storage.clear();
+      _primary_storage.clear();
+      _delta_csr_storage.clear();
+      _delta_csc_storage.clear();
       std::vector<VertexData>().swap(vertices);
       std::vector<EdgeData>().swap(edges);
       edge_buffer.clear();
@@ -209,50 +213,69 @@ namespace graphlab {
       std::vector<edge_id_type> permute;
       std::vector<edge_id_type> src_counting_prefix_sum;
       std::vector<edge_id_type> dest_counting_prefix_sum;
+
+      if (edge_buffer.has_spilled()) {
+        // Edges exceeded the memory budget: stream the runs straight into
+        // the CSR and CSC without holding the edge buffer and the
+        // permutation arrays in memory.
+        std::vector<lvid_type> csr_value;
+        std::vector<std::pair<lvid_type, edge_id_type> > csc_value;
+        edge_buffer.build_csr_csc(src_counting_prefix_sum, csr_value,
+                                  dest_counting_prefix_sum, csc_value, edges);
+        if (compressed) {
+          // sorting the rows moves the edges, so renumber the CSC
+          std::vector<edge_id_type> new_eid;
+          sort_csr_rows(src_counting_prefix_sum, csr_value, edges, &new_eid);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+          for (ssize_t i = 0; i < ssize_t(csc_value.size()); ++i) {
+            csc_value[i].second = new_eid[csc_value[i].second];
+          }
+        }
+        ASSERT_EQ(csr_value.size(), edges.size());
+        store_adjacency(src_counting_prefix_sum, csr_value,
+                        dest_counting_prefix_sum, csc_value, edges);
+        logstream(LOG_INFO) << "Graph finalized from spilled edges in "
+                            << mytimer.current_time() << " secs" << std::endl;
+        finalized = true;
+        return;
+      }
            
 #ifdef DEBUG_GRAPH
       logstream(LOG_DEBUG) << "Graph2 finalize: Sort by source vertex" << std::endl;
 #endif
       // Sort edges by source;
       // Begin of counting sort.
-      counting_sort(edge_buffer.source_arr, permute, &src_counting_prefix_sum);
+      parallel_counting_sort(edge_buffer.source_arr, permute, &src_counting_prefix_sum);
 
-      // Inplace permute of edge_data, edge_src, edge_target array.
+      // Permute edge_data and edge_target array by source id. The sorted
+      // source array follows directly from the prefix sum.
 #ifdef DEBUG_GRAPH
-      logstream(LOG_DEBUG) << "Graph2 finalize: Inplace permute by source id" << std::endl;
+      logstream(LOG_DEBUG) << "Graph2 finalize: Outofplace permute by source id" << std::endl;
 #endif
-      lvid_type swap_src; lvid_type swap_target; EdgeData  swap_data;
-      for (size_t i = 0; i < permute.size(); ++i) {
-        if (i != permute[i]) {
-          // Reserve the ith entry;
-          size_t j = i;
-          swap_data = edge_buffer.data[i];
-          swap_src = edge_buffer.source_arr[i];
-          swap_target = edge_buffer.target_arr[i];
-          // Begin swap cycle:
-          while (j != permute[j]) {
-            size_t next = permute[j];
-            if (next != i) {
-              edge_buffer.data[j] = edge_buffer.data[next];
-              edge_buffer.source_arr[j] = edge_buffer.source_arr[next];
-              edge_buffer.target_arr[j] = edge_buffer.target_arr[next];
-              permute[j] = j;
-              j = next;
-            } else {
-              // end of cycle
-              edge_buffer.data[j] = swap_data;
-              edge_buffer.source_arr[j] = swap_src;
-              edge_buffer.target_arr[j] = swap_target;
-              permute[j] = j;
-              break;
-            }
-          }
+      outofplace_shuffle(edge_buffer.data, permute);
+      outofplace_shuffle(edge_buffer.target_arr, permute);
+      const ssize_t nsrc = src_counting_prefix_sum.size();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif
+      for (ssize_t i = 0; i < nsrc; ++i) {
+        const size_t end = (i + 1 == nsrc) ? permute.size()
+                                           : src_counting_prefix_sum[i + 1];
+        for (size_t j = src_counting_prefix_sum[i]; j < end; ++j) {
+          edge_buffer.source_arr[j] = i;
         }
       }
+      if (compressed) {
+        // delta coding needs the targets of each source in order
+        sort_csr_rows(src_counting_prefix_sum, edge_buffer.target_arr,
+                      edge_buffer.data, NULL);
+      }
 #ifdef DEBUG_GRAPH
       logstream(LOG_DEBUG) << "Graph2 finalize: Sort by dest id" << std::endl;
 #endif
-      counting_sort(edge_buffer.target_arr, permute, &dest_counting_prefix_sum); 
+      parallel_counting_sort(edge_buffer.target_arr, permute, &dest_counting_prefix_sum);
       // Shuffle source array
 #ifdef DEBUG_GRAPH
       logstream(LOG_DEBUG) << "Graph2 finalize: Outofplace permute by dest id" << std::endl;
@@ -264,13 +287,12 @@ namespace graphlab {
       // counting_sort(edge_buffer.target_arr, permute);
 
       // warp into csr csc storage.
-      _csr_storage.wrap(src_counting_prefix_sum, edge_buffer.target_arr);
       std::vector<std::pair<lvid_type, edge_id_type> > csc_value = vector_zip(edge_buffer.source_arr, permute);
-      //ASSERT_EQ(csc_value.size(), edge_buffer.size());
-      _csc_storage.wrap(dest_counting_prefix_sum, csc_value); 
+      ASSERT_EQ(csc_value.size(), edge_buffer.target_arr.size());
+      ASSERT_EQ(csc_value.size(), edge_buffer.data.size());
+      store_adjacency(src_counting_prefix_sum, edge_buffer.target_arr,
+                      dest_counting_prefix_sum, csc_value, edge_buffer.data);
       edges.swap(edge_buffer.data);
-      ASSERT_EQ(_csr_storage.num_values(), _csc_storage.num_values());
-      ASSERT_EQ(_csr_storage.num_values(), edges.size());
 #ifdef DEBGU_GRAPH
       logstream(LOG_DEBUG) << "End of finalize." << std::endl;
 #endif
@@ -326,6 +348,70 @@ namespace graphlab {
     void reserve_edge_space(size_t n) {
       edge_buffer.reserve_edge_space(n);
     }
+
+    /**
+     * \brief Bounds the memory used to buffer edges before finalize().
+     * Edges beyond budget bytes are written to run files in directory
+     * and finalize() streams them into the CSR and CSC structures.
+     * A budget of 0 (the default) keeps all edges in memory.
+     */
+    void set_edge_buffer_budget(size_t budget, const std::string& directory) {
+      edge_buffer.set_spill_budget(budget, directory);
+    }
+
+    /**
+     * \brief Selects delta compressed adjacency storage. If enabled, the
+     * next finalize() stores neighbor lists as varint coded deltas, which
+     * are decoded on the fly by in_edges() and out_edges(). This trades
+     * iteration speed for memory: the decoding is serial and makes edge
+     * iteration up to 2.5x slower. Must be set before finalize().
+     */
+    void set_compression(bool enable) {
+      ASSERT_FALSE(finalized);
+      compressed = enable;
+    }
+
+    /** \brief Returns true if the adjacency storage is delta compressed. */
+    bool is_compressed() const { return compressed; }
+
+    /**
+     * \brief Selects the order of the edge data. By default edge data is
+     * stored in CSR order (grouped by source) so that out edges are read
+     * sequentially. If enabled, the next finalize() stores edge data in
+     * CSC order (grouped by target) instead, so that gathers over in
+     * edges stream through it; out edges then go through a CSR to CSC
+     * index. Must be set before finalize().
+     */
+    void set_csc_edge_order(bool enable) {
+      ASSERT_FALSE(finalized);
+      csc_edge_order = enable;
+    }
+
+    /** \brief Returns true if edge data is stored in CSC order. */
+    bool is_csc_edge_order() const { return csc_edge_order; }
+
+    /**
+     * \brief Renumbers the vertices to improve the locality of the edge
+     * structure (see vertex_ordering). On return new_lvid[v] is the new id
+     * of the vertex formerly numbered v. Vertex data and buffered edges are
+     * moved to the new ids. Must be called before finalize().
+     */
+    void reorder_vertices(vertex_ordering::method_type method,
+                          std::vector<lvid_type>& new_lvid) {
+      ASSERT_FALSE(finalized);
+      vertex_ordering::compute(method, edge_buffer, vertices.size(), new_lvid);
+      ASSERT_EQ(new_lvid.size(), vertices.size());
+      edge_buffer.relabel(new_lvid);
+      std::vector<VertexData> new_vertices(vertices.size());
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t i = 0; i < ssize_t(vertices.size()); ++i) {
+        new_vertices[new_lvid[i]] = vertices[i];
+      }
+      vertices.swap(new_vertices);
+    }
+
     /**
      * \brief Creates an edge connecting vertex source to vertex target.  Any
      * existing data will be cleared. Should not be called after finalization.
@@ -420,22 +506,45 @@ namespace graphlab {
     /** \brief Load the local_graph from an archive */
     void load(iarchive& arc) {
       clear();    
-      // read the vertices
+      // Archives written before the format was versioned start with the
+      // length of the vertex vector instead of the magic.
+      size_t magic = 0;
+      arc >> magic;
+      if (magic != ARCHIVE_MAGIC) {
+        load_unversioned(arc, magic);
+        return;
+      }
+      size_t version = 0;
+      arc >> version;
+      if (version != ARCHIVE_VERSION) {
+        logstream(LOG_FATAL) << "Unknown local_graph archive version "
+                             << version << std::endl;
+      }
       arc >> vertices
           >> edges 
-          >> _csr_storage
-          >> _csc_storage
-          >> finalized;
+          >> _primary_storage
+          >> _secondary_storage
+          >> finalized
+          >> compressed
+          >> _delta_csr_storage
+          >> _delta_csc_storage
+          >> csc_edge_order;
     } // end of load
 
     /** \brief Save the local_graph to an archive */
     void save(oarchive& arc) const {
+      const size_t magic = ARCHIVE_MAGIC, version = ARCHIVE_VERSION;
+      arc << magic << version;
       // Write the number of edges and vertices
       arc << vertices
           << edges
-          << _csr_storage  
-          << _csc_storage
-          << finalized;
+          << _primary_storage  
+          << _secondary_storage
+          << finalized
+          << compressed
+          << _delta_csr_storage
+          << _delta_csc_storage
+          << csc_edge_order;
     } // end of save
     
     /** swap two graphs */
@@ -443,9 +552,13 @@ namespace graphlab {
       finalized = other.finalized;
       std::swap(vertices, other.vertices);
       std::swap(edges, other.edges);
-      std::swap(_csr_storage, other._csr_storage);
-      std::swap(_csc_storage, other._csc_storage);
+      std::swap(_primary_storage, other._primary_storage);
+      std::swap(_secondary_storage, other._secondary_storage);
+      _delta_csr_storage.swap(other._delta_csr_storage);
+      _delta_csc_storage.swap(other._delta_csc_storage);
       std::swap(finalized, other.finalized);
+      std::swap(compressed, other.compressed);
+      std::swap(csc_edge_order, other.csc_edge_order);
     } // end of swap
 
 
@@ -502,7 +615,9 @@ namespace graphlab {
      * \brief Returns the number of in edges of the vertex with the given id. */
     size_t num_in_edges(const lvid_type v) const {
       ASSERT_TRUE(finalized);
-      return (_csc_storage.end(v) - _csc_storage.begin(v));
+      if (compressed) return _delta_csc_storage.num_values(v);
+      if (csc_edge_order) return (_primary_storage.end(v) - _primary_storage.begin(v));
+      return (_secondary_storage.end(v) - _secondary_storage.begin(v));
     }
 
     /** 
@@ -510,41 +625,33 @@ namespace graphlab {
      * \brief Returns the number of in edges of the vertex with the given id. */
     size_t num_out_edges(const lvid_type v) const {
       ASSERT_TRUE(finalized);
-      return (_csr_storage.end(v) - _csr_storage.begin(v));
+      if (compressed) return _delta_csr_storage.num_values(v);
+      if (csc_edge_order) return (_secondary_storage.end(v) - _secondary_storage.begin(v));
+      return (_primary_storage.end(v) - _primary_storage.begin(v));
     }
 
     /** 
      * \internal
      * \brief Returns a list of in edges of the vertex with the given id. */
     edge_list_type in_edges(lvid_type v) {
-      edge_iterator begin = edge_iterator(*this, _csc_storage.begin(v), v);
-      edge_iterator end = edge_iterator(*this, _csc_storage.end(v), v);
-      return boost::make_iterator_range(begin, end);
+      if (compressed) {
+        return boost::make_iterator_range(
+            edge_iterator(*this, _delta_csc_storage.begin(v), v, true),
+            edge_iterator(*this, _delta_csc_storage.end(v), v, true));
+      }
+      return csc_edge_order ? zipped_edges(v, true) : paired_edges(v, true);
     }
 
     /** 
      * \internal
      * \brief Returns a list of out edges of the vertex with the given id. */
     edge_list_type out_edges(lvid_type v) {
-
-      csr_type::iterator base_begin = _csr_storage.begin(v);
-      csr_type::iterator base_end = _csr_storage.end(v);
-
-      edge_id_type begin_eid = base_begin - _csr_storage.begin(0); 
-      edge_id_type end_eid = base_end - _csr_storage.begin(0); 
-
-      boost::counting_iterator<edge_id_type> counter_begin(begin_eid);
-      boost::counting_iterator<edge_id_type> counter_end(end_eid);
-
-      edge_iterator begin = 
-          edge_iterator(*this,
-              csr_edge_iterator(csr_iterator_tuple(base_begin, counter_begin)), v);
-
-      edge_iterator end = 
-          edge_iterator(*this,
-              csr_edge_iterator(csr_iterator_tuple(base_end, counter_end)), v);
-
-      return boost::make_iterator_range(begin, end);
+      if (compressed) {
+        return boost::make_iterator_range(
+            edge_iterator(*this, _delta_csr_storage.begin(v), v, false),
+            edge_iterator(*this, _delta_csr_storage.end(v), v, false));
+      }
+      return csc_edge_order ? paired_edges(v, false) : zipped_edges(v, false);
     }
 
     /** 
@@ -570,8 +677,10 @@ namespace graphlab {
     size_t estimate_sizeof() const {
       const size_t vlist_size = sizeof(vertices) + 
         sizeof(VertexData) * vertices.capacity();
-      size_t elist_size = _csr_storage.estimate_sizeof() 
-          + _csc_storage.estimate_sizeof()
+      size_t elist_size = _primary_storage.estimate_sizeof() 
+          + _secondary_storage.estimate_sizeof()
+          + _delta_csr_storage.estimate_sizeof()
+          + _delta_csc_storage.estimate_sizeof()
           + sizeof(edges) + sizeof(EdgeData)*edges.capacity();
       size_t ebuffer_size = edge_buffer.estimate_sizeof();
       // std::cerr << "local_graph: tmplist size: " << (double)elist_size/(1024*1024)
@@ -613,6 +722,9 @@ namespace graphlab {
     typedef boost::zip_iterator<csr_iterator_tuple> csr_edge_iterator;
     typedef csc_type::iterator csc_edge_iterator;
 
+    typedef delta_csr_storage<edge_id_type> delta_csr_type;
+    typedef delta_csr_type::cursor delta_edge_iterator;
+
     class edge_iterator : 
         public boost::iterator_facade <
         edge_iterator,
@@ -621,19 +733,29 @@ namespace graphlab {
         edge_type> {
          public:
            edge_iterator(local_graph& lgraph_ref, 
-                         csc_edge_iterator iter, lvid_type sourceid) 
-               : lgraph_ref(lgraph_ref), _type(CSC), csc_iter(iter), vid(sourceid) {}
+                         csc_edge_iterator iter, lvid_type vid, bool in) 
+               : lgraph_ref(lgraph_ref), _type(PAIRED), csc_iter(iter),
+                 vid(vid), in(in) {}
+           edge_iterator(local_graph& lgraph_ref,
+                         csr_edge_iterator iter, lvid_type vid, bool in) 
+               : lgraph_ref(lgraph_ref), _type(ZIPPED), csr_iter(iter),
+                 vid(vid), in(in) {}
            edge_iterator(local_graph& lgraph_ref,
-                         csr_edge_iterator iter, lvid_type destid) 
-               : lgraph_ref(lgraph_ref), _type(CSR), csr_iter(iter), vid(destid) {}
+                         delta_edge_iterator iter, lvid_type vid, bool in)
+               : lgraph_ref(lgraph_ref), _type(DELTA), delta_iter(iter),
+                 vid(vid), in(in) {}
 
          private:
            friend class boost::iterator_core_access;
 
+           /// How many entries ahead increment() prefetches
+           static const ptrdiff_t PREFETCH_DISTANCE = 8;
+
            void increment() {
              switch (_type) {
-              case CSC: ++csc_iter; break;
-              case CSR: ++csr_iter; break;
+              case PAIRED: ++csc_iter; prefetch(); break;
+              case ZIPPED: ++csr_iter; prefetch(); break;
+              case DELTA: delta_iter.next(); break;
               default: return;
              }
            }
@@ -641,8 +763,10 @@ namespace graphlab {
            {
              ASSERT_EQ(_type, other._type);
              switch (_type) {
-              case CSC: return csc_iter == other.csc_iter;
-              case CSR: return csr_iter == other.csr_iter;
+              case PAIRED: return csc_iter == other.csc_iter;
+              case ZIPPED: return csr_iter == other.csr_iter;
+              case DELTA:
+                return delta_iter.position() == other.delta_iter.position();
               default: return true;
              }
            }
@@ -651,53 +775,149 @@ namespace graphlab {
            }
            void decrement() {
              switch (_type) {
-              case CSC: --csc_iter; break;
-              case CSR: --csr_iter; break;
+              case PAIRED: --csc_iter; break;
+              case ZIPPED: --csr_iter; break;
+              case DELTA:
+                ASSERT_MSG(false, "Compressed edge lists can only be traversed forward.");
+                break;
               default: return;
              }
            }
            void advance(int n) {
              switch (_type) {
-              case CSC: csc_iter+=n; break;
-              case CSR: csr_iter+=n; break;
+              case PAIRED: csc_iter+=n; break;
+              case ZIPPED: csr_iter+=n; break;
+              case DELTA:
+                ASSERT_GE(n, 0);
+                while (n-- > 0) delta_iter.next();
+                break;
               default: return;
              }
            } 
            ptrdiff_t distance_to(const edge_iterator& other) const {
              switch (_type) {
-              case CSC: return other.csc_iter - csc_iter;
-              case CSR: return other.csr_iter - csr_iter;
+              case PAIRED: return other.csc_iter - csc_iter;
+              case ZIPPED: return other.csr_iter - csr_iter;
+              case DELTA:
+                return ptrdiff_t(other.delta_iter.position())
+                    - ptrdiff_t(delta_iter.position());
               default: return 0;
              }
            }
+
+           /**
+            * Prefetches the data of the neighbor PREFETCH_DISTANCE entries
+            * ahead, and its edge data if the edge ids are stored (and
+            * hence not sequential). The entry may belong to the next
+            * vertex, which the caller is likely to visit anyway.
+            */
+           void prefetch() const {
+             if (_type == PAIRED) {
+               const csc_edge_iterator last =
+                   lgraph_ref._secondary_storage.end(lgraph_ref._secondary_storage.num_keys());
+               if (last - csc_iter > PREFETCH_DISTANCE) {
+                 const std::pair<lvid_type, edge_id_type>& ahead =
+                     *(csc_iter + PREFETCH_DISTANCE);
+                 __builtin_prefetch(&lgraph_ref.vertices[ahead.first]);
+                 __builtin_prefetch(&lgraph_ref.edges[ahead.second]);
+               }
+             } else if (_type == ZIPPED) {
+               const csr_type::iterator base =
+                   csr_iter.get_iterator_tuple().template get<0>();
+               const csr_type::iterator last =
+                   lgraph_ref._primary_storage.end(lgraph_ref._primary_storage.num_keys());
+               if (last - base > PREFETCH_DISTANCE) {
+                 __builtin_prefetch(&lgraph_ref.vertices[*(base + PREFETCH_DISTANCE)]);
+               }
+             }
+           }
          private:
            edge_type make_value() const {
+             lvid_type nbr;
+             edge_id_type eid;
              switch (_type) {
-              case CSC: {
-                typename csc_edge_iterator::reference val
-                    = *csc_iter;
-                return edge_type(lgraph_ref, val.first, vid, val.second);
+              case PAIRED: {
+                typename csc_edge_iterator::reference val = *csc_iter;
+                nbr = val.first;
+                eid = val.second;
+                break;
               }
-              case CSR: {
-                typename csr_edge_iterator::reference val
-                    = *csr_iter;
-                return edge_type(lgraph_ref,
-                                 vid,
-                                 val.template get<0>(),
-                                 val.template get<1>());
+              case ZIPPED: {
+                typename csr_edge_iterator::reference val = *csr_iter;
+                nbr = val.template get<0>();
+                eid = val.template get<1>();
+                break;
               }
+              case DELTA:
+                nbr = delta_iter.value();
+                eid = delta_iter.id();
+                break;
               default: return edge_type(lgraph_ref, -1, -1, -1);
              }
+             return in ? edge_type(lgraph_ref, nbr, vid, eid)
+                       : edge_type(lgraph_ref, vid, nbr, eid);
            }
-           enum list_type {CSR, CSC}; 
+           /**
+            * How the entries are stored: (lvid, edge id) pairs, lvids with
+            * implicit edge ids, or delta coded.
+            */
+           enum list_type {PAIRED, ZIPPED, DELTA}; 
            local_graph& lgraph_ref;
            const list_type _type;
            csc_edge_iterator csc_iter;
            csr_edge_iterator csr_iter;
+           delta_edge_iterator delta_iter;
+           /// The vertex whose edges are listed
            const lvid_type vid;
+           /// Whether vid is the target (in edges) or the source
+           const bool in;
         }; // end of edge_iterator
 
 
+    /**
+     * First word of a versioned archive. An unversioned archive starts with
+     * the size of the vertex vector, which can never be this large.
+     */
+    static const size_t ARCHIVE_MAGIC = size_t(-1) - 1;
+    static const size_t ARCHIVE_VERSION = 1;
+
+    /**
+     * Reads the unversioned layout: vertices, edges, CSR, CSC and the
+     * finalized flag, with local ids of the width of vertex_id_type.
+     * numvertices is the vertex vector length already read by load().
+     */
+    void load_unversioned(iarchive& arc, size_t numvertices) {
+      // the rest of the vertex vector, as its serializer would read it
+      vertices.resize(numvertices);
+      if (gl_is_pod_or_scaler<VertexData>::value) {
+        if (numvertices > 0) {
+          deserialize(arc, &vertices[0], sizeof(VertexData) * numvertices);
+        }
+      } else {
+        for (size_t i = 0; i < numvertices; ++i) arc >> vertices[i];
+      }
+      typedef std::pair<vertex_id_type, vertex_id_type> old_csc_value;
+      csr_storage<vertex_id_type, vertex_id_type> old_csr;
+      csr_storage<old_csc_value, vertex_id_type> old_csc;
+      arc >> edges >> old_csr >> old_csc >> finalized;
+      // narrow the ids to lvid_type and edge_id_type
+      std::vector<vertex_id_type> old_index = old_csr.get_index();
+      std::vector<edge_id_type> index(old_index.begin(), old_index.end());
+      std::vector<vertex_id_type> old_csr_values = old_csr.get_values();
+      std::vector<lvid_type> csr_values(old_csr_values.begin(),
+                                        old_csr_values.end());
+      _primary_storage.wrap(index, csr_values);
+      old_index = old_csc.get_index();
+      index.assign(old_index.begin(), old_index.end());
+      std::vector<old_csc_value> old_csc_values = old_csc.get_values();
+      std::vector<std::pair<lvid_type, edge_id_type> >
+          csc_values(old_csc_values.begin(), old_csc_values.end());
+      _secondary_storage.wrap(index, csc_values);
+      compressed = false;
+      csc_edge_order = false;
+    }
+
+
     /**************************************************************************/
     /*                                                                        */
     /*                          PRIVATE DATA MEMBERS                          */
@@ -706,11 +926,22 @@ namespace graphlab {
     /** The vertex data is simply a vector of vertex data */
     std::vector<VertexData> vertices;
 
-    /** Stores the edge data and edge relationships. */
-    csr_type _csr_storage;
-    csc_type _csc_storage;
+    /**
+     * Stores the edge data and edge relationships. _primary_storage is in
+     * edge data order, so the edge ids of its neighbors are implicit.
+     * _secondary_storage holds the other direction with explicit edge ids.
+     * By default these are the out edges keyed by source and the in edges
+     * keyed by target. With csc_edge_order the primary storage holds the
+     * in edges and the secondary storage the out edges.
+     */
+    csr_type _primary_storage;
+    csc_type _secondary_storage;
     std::vector<EdgeData> edges;
 
+    /** Delta compressed CSR/CSC, used instead of the above if compressed. */
+    delta_csr_type _delta_csr_storage;
+    delta_csr_type _delta_csc_storage;
+
     /** The edge data is a vector of edges where each edge stores its
         source, destination, and data. Used for temporary storage. The
         data is transferred into CSR+CSC representation in
@@ -722,6 +953,165 @@ namespace graphlab {
         performance. */
     bool finalized;
 
+    /** Whether finalize() builds the delta compressed storage. */
+    bool compressed;
+
+    /** Whether finalize() stores the edge data in CSC order. */
+    bool csc_edge_order;
+
+    /**
+     * \internal
+     * Edges of v in _primary_storage, whose edge ids are implicit. These are
+     * the out edges, or the in edges with csc_edge_order.
+     */
+    edge_list_type zipped_edges(lvid_type v, bool in) {
+      csr_type::iterator base_begin = _primary_storage.begin(v);
+      csr_type::iterator base_end = _primary_storage.end(v);
+
+      edge_id_type begin_eid = base_begin - _primary_storage.begin(0); 
+      edge_id_type end_eid = base_end - _primary_storage.begin(0); 
+
+      boost::counting_iterator<edge_id_type> counter_begin(begin_eid);
+      boost::counting_iterator<edge_id_type> counter_end(end_eid);
+
+      edge_iterator begin = 
+          edge_iterator(*this,
+              csr_edge_iterator(csr_iterator_tuple(base_begin, counter_begin)), v, in);
+
+      edge_iterator end = 
+          edge_iterator(*this,
+              csr_edge_iterator(csr_iterator_tuple(base_end, counter_end)), v, in);
+
+      return boost::make_iterator_range(begin, end);
+    }
+
+    /**
+     * \internal
+     * Edges of v in _secondary_storage, which stores the edge ids. These are
+     * the in edges, or the out edges with csc_edge_order.
+     */
+    edge_list_type paired_edges(lvid_type v, bool in) {
+      edge_iterator begin = edge_iterator(*this, _secondary_storage.begin(v), v, in);
+      edge_iterator end = edge_iterator(*this, _secondary_storage.end(v), v, in);
+      return boost::make_iterator_range(begin, end);
+    }
+
+    /**
+     * \internal
+     * Sorts the targets of each CSR row and moves the edge data along.
+     * If new_eid is not NULL, (*new_eid)[e] receives the new position of
+     * the edge at position e.
+     */
+    static void sort_csr_rows(const std::vector<edge_id_type>& prefix,
+                              std::vector<lvid_type>& targets,
+                              std::vector<EdgeData>& data,
+                              std::vector<edge_id_type>* new_eid) {
+      if (new_eid != NULL) new_eid->resize(targets.size());
+      const ssize_t nrows = prefix.size();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif
+      for (ssize_t i = 0; i < nrows; ++i) {
+        const size_t begin = prefix[i];
+        const size_t end = (i + 1 == nrows) ? targets.size() : prefix[i + 1];
+        bool sorted = true;
+        for (size_t j = begin + 1; j < end && sorted; ++j) {
+          sorted = targets[j - 1] <= targets[j];
+        }
+        if (sorted) {
+          if (new_eid != NULL) {
+            for (size_t j = begin; j < end; ++j) (*new_eid)[j] = j;
+          }
+          continue;
+        }
+        std::vector<std::pair<lvid_type, edge_id_type> > order(end - begin);
+        for (size_t j = begin; j < end; ++j) {
+          order[j - begin] = std::make_pair(targets[j], edge_id_type(j));
+        }
+        std::sort(order.begin(), order.end());
+        std::vector<EdgeData> row_data(end - begin);
+        for (size_t j = 0; j < order.size(); ++j) {
+          targets[begin + j] = order[j].first;
+          row_data[j] = data[order[j].second];
+          if (new_eid != NULL) (*new_eid)[order[j].second] = begin + j;
+        }
+        std::copy(row_data.begin(), row_data.end(), data.begin() + begin);
+      }
+    }
+
+    /**
+     * \internal
+     * Moves the finalized adjacency into either the plain or the delta
+     * compressed CSR/CSC storage. data holds the edge data in CSR order
+     * and is permuted into CSC order if csc_edge_order is set. The
+     * adjacency input vectors are cleared.
+     */
+    void store_adjacency(std::vector<edge_id_type>& csr_prefix,
+                         std::vector<lvid_type>& csr_value,
+                         std::vector<edge_id_type>& csc_prefix,
+                         std::vector<std::pair<lvid_type, edge_id_type> >& csc_value,
+                         std::vector<EdgeData>& data) {
+      ASSERT_EQ(csr_value.size(), csc_value.size());
+      ASSERT_EQ(csr_value.size(), data.size());
+      const size_t nedges = csr_value.size();
+      if (compressed) {
+        // sources of each CSC row in order, for the same reason as above
+        const ssize_t nrows = csc_prefix.size();
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif
+        for (ssize_t i = 0; i < nrows; ++i) {
+          const size_t end = (i + 1 == nrows) ? nedges : csc_prefix[i + 1];
+          std::sort(csc_value.begin() + csc_prefix[i], csc_value.begin() + end);
+        }
+      }
+
+      if (csc_edge_order) {
+        // Move the edge data of each edge to its CSC position. The in
+        // edges then only need their sources, while the out edges record
+        // where their data went.
+        std::vector<edge_id_type> csc_eid(nedges);
+        std::vector<lvid_type> csc_source(nedges);
+        std::vector<std::pair<lvid_type, edge_id_type> > csr_pair(nedges);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+        for (ssize_t i = 0; i < ssize_t(nedges); ++i) {
+          const edge_id_type eid = csc_value[i].second;
+          csc_eid[i] = eid;
+          csc_source[i] = csc_value[i].first;
+          csr_pair[eid] = std::make_pair(csr_value[eid], edge_id_type(i));
+        }
+        std::vector<lvid_type>().swap(csr_value);
+        std::vector<std::pair<lvid_type, edge_id_type> >().swap(csc_value);
+        outofplace_shuffle(data, csc_eid);
+        if (compressed) {
+          _delta_csr_storage.encode(csr_prefix, csr_pair);
+          _delta_csc_storage.encode(csc_prefix, csc_source);
+        } else {
+          _primary_storage.wrap(csc_prefix, csc_source);
+          _secondary_storage.wrap(csr_prefix, csr_pair);
+        }
+      } else if (compressed) {
+        _delta_csr_storage.encode(csr_prefix, csr_value);
+        _delta_csc_storage.encode(csc_prefix, csc_value);
+      } else {
+        _primary_storage.wrap(csr_prefix, csr_value);
+        _secondary_storage.wrap(csc_prefix, csc_value);
+        return;
+      }
+      if (compressed) {
+        logstream(LOG_INFO) << "Compressed adjacency: "
+                            << nedges << " edges in "
+                            << _delta_csr_storage.num_bytes() << " CSR bytes and "
+                            << _delta_csc_storage.num_bytes() << " CSC bytes"
+                            << std::endl;
+      }
+      std::vector<edge_id_type>().swap(csr_prefix);
+      std::vector<lvid_type>().swap(csr_value);
+      std::vector<edge_id_type>().swap(csc_prefix);
+      std::vector<std::pair<lvid_type, edge_id_type> >().swap(csc_value);
+    }
 
     /**************************************************************************/
     /*                                                                        */
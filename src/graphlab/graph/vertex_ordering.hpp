@@ -0,0 +1,154 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_GRAPH_VERTEX_ORDERING_HPP
+#define GRAPHLAB_GRAPH_VERTEX_ORDERING_HPP
+
+#ifndef __NO_OPENMP__
+#include <omp.h>
+#endif
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+
+#include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/util/generics/counting_sort.hpp>
+#include <graphlab/logger/logger.hpp>
+
+namespace graphlab {
+
+  /**
+   * \internal
+   * Relabeling of local vertex ids to improve the cache locality of the
+   * local graph. Each method produces new_lvid, a permutation with
+   * new_lvid[old lvid] = new lvid.
+   */
+  namespace vertex_ordering {
+
+    enum method_type {
+      NONE,    ///< keep the arrival order
+      DEGREE,  ///< decreasing total degree, so hubs share cache lines
+      RCM      ///< reverse Cuthill-McKee, which keeps neighbors close
+    };
+
+    /// Parses "none", "degree" or "rcm". Fails on anything else.
+    inline method_type parse(const std::string& name) {
+      if (name == "none") return NONE;
+      if (name == "degree") return DEGREE;
+      if (name == "rcm") return RCM;
+      logstream(LOG_FATAL) << "Unknown vertex order: " << name << std::endl;
+      return NONE;
+    }
+
+    /**
+     * Orders vertices by decreasing degree. Vertices with the same degree
+     * keep their relative order.
+     */
+    inline void degree_order(const std::vector<edge_id_type>& degree,
+                             std::vector<lvid_type>& new_lvid) {
+      new_lvid.resize(degree.size());
+      if (degree.empty()) return;
+      const edge_id_type maxdeg = *std::max_element(degree.begin(), degree.end());
+      std::vector<edge_id_type> key(degree.size());
+      for (size_t i = 0; i < degree.size(); ++i) key[i] = maxdeg - degree[i];
+      std::vector<lvid_type> order;
+      parallel_counting_sort(key, order);
+#ifdef _OPENMP
+#pragma omp parallel for
+#endif
+      for (ssize_t i = 0; i < ssize_t(order.size()); ++i) {
+        new_lvid[order[i]] = i;
+      }
+    }
+
+    /**
+     * Reverse Cuthill-McKee ordering of an undirected graph given as a
+     * CSR index (prefix[v] is the first neighbor of v in nbrs). Each
+     * connected component is traversed breadth first from its lowest
+     * degree vertex, visiting the neighbors of a vertex by increasing
+     * degree. The resulting order is reversed.
+     */
+    inline void rcm_order(const std::vector<edge_id_type>& degree,
+                          const std::vector<edge_id_type>& prefix,
+                          const std::vector<lvid_type>& nbrs,
+                          std::vector<lvid_type>& new_lvid) {
+      const size_t nverts = degree.size();
+      new_lvid.assign(nverts, lvid_type(-1));
+      // candidate roots by increasing degree
+      std::vector<lvid_type> roots;
+      parallel_counting_sort(degree, roots);
+      std::vector<lvid_type> order;
+      order.reserve(nverts);
+      std::vector<std::pair<edge_id_type, lvid_type> > frontier;
+      for (size_t r = 0; r < roots.size(); ++r) {
+        if (new_lvid[roots[r]] != lvid_type(-1)) continue;
+        size_t head = order.size();
+        new_lvid[roots[r]] = 0;
+        order.push_back(roots[r]);
+        while (head < order.size()) {
+          const lvid_type v = order[head++];
+          const size_t end = (v + 1 < prefix.size()) ? prefix[v + 1] : nbrs.size();
+          frontier.clear();
+          for (size_t i = prefix[v]; i < end; ++i) {
+            const lvid_type u = nbrs[i];
+            if (new_lvid[u] != lvid_type(-1)) continue;
+            new_lvid[u] = 0;  // mark visited
+            frontier.push_back(std::make_pair(degree[u], u));
+          }
+          std::sort(frontier.begin(), frontier.end());
+          for (size_t i = 0; i < frontier.size(); ++i) {
+            order.push_back(frontier[i].second);
+          }
+        }
+      }
+      ASSERT_EQ(order.size(), nverts);
+      for (size_t i = 0; i < nverts; ++i) new_lvid[order[i]] = nverts - 1 - i;
+    }
+
+    /**
+     * Computes new_lvid for the nverts vertices of a local graph whose
+     * edges are still held in edge_buffer (a local_edge_buffer).
+     */
+    template <typename EdgeBuffer>
+    void compute(method_type method, const EdgeBuffer& edge_buffer,
+                 size_t nverts, std::vector<lvid_type>& new_lvid) {
+      std::vector<edge_id_type> degree(nverts, 0);
+      edge_buffer.count_degrees(degree);
+      if (method == DEGREE) {
+        degree_order(degree, new_lvid);
+      } else if (method == RCM) {
+        std::vector<edge_id_type> prefix;
+        std::vector<lvid_type> nbrs;
+        edge_buffer.build_undirected_csr(degree, prefix, nbrs);
+        rcm_order(degree, prefix, nbrs, new_lvid);
+      } else {
+        new_lvid.resize(nverts);
+        for (size_t i = 0; i < nverts; ++i) new_lvid[i] = i;
+      }
+    }
+
+  } // end of namespace vertex_ordering
+} // end of namespace graphlab
+#endif
@@ -272,7 +272,10 @@ size_t fiber_control::launch(boost::function<void(void)> fn,
   // allocate a stack
   fiber* fib = new fiber;
   fib->parent = this;
-  fib->stack = malloc(stacksize);
+  fib->stack = stack_pool.allocate(stacksize);
+  fib->stacksize = stacksize;
+  // the pool rounds up to whole pages
+  stacksize = stack_pool.usable_size(stacksize);
   fib->id = fiber_id_counter.inc();
   foreach(size_t b, affinity) {
     if (b < nworkers) fib->affinity_array.push_back((unsigned char)b);
@@ -404,7 +407,7 @@ void fiber_control::reschedule_fiber(size_t workerid, fiber* fib) {
   } else if (fib->terminate) {
     fib->lock.unlock();
     // previous fiber is dead. destroy it
-    free(fib->stack);
+    stack_pool.deallocate(fib->stack, fib->stacksize);
     //VALGRIND_STACK_DEREGISTER(fib->stack);
     // delete the fiber local storage if any
     if (fib->fls && flsdeleter) flsdeleter(fib->fls);
@@ -31,6 +31,7 @@
 #include <graphlab/util/inplace_lf_queue2.hpp>
 #include <graphlab/parallel/pthread_tools.hpp>
 #include <graphlab/parallel/atomic.hpp>
+#include <graphlab/parallel/fiber_stack_pool.hpp>
 namespace graphlab {
 
 /**
@@ -47,6 +48,7 @@ class fiber_control {
     fiber_control* parent;
     boost::context::fcontext_t* context;
     void* stack;
+    size_t stacksize; // the size requested from the stack pool
     size_t id;
     affinity_type affinity;
     std::vector<unsigned char> affinity_array;
@@ -103,6 +105,8 @@ class fiber_control {
 
   thread_group workers;
 
+  // recycles guard paged fiber stacks
+  fiber_stack_pool stack_pool;
 
   // locks must be acquired outside the call
   void active_queue_insert_head(size_t workerid, fiber* value);
@@ -189,6 +193,21 @@ class fiber_control {
   inline size_t total_threads_created() {
     return fiber_id_counter.value;
   }
+
+  /**
+   * Returns the number of fiber launches whose stack was recycled
+   * from a previously terminated fiber
+   */
+  inline size_t stack_pool_hits() const {
+    return stack_pool.hits();
+  }
+
+  /**
+   * Returns the number of fiber launches which had to map a new stack
+   */
+  inline size_t stack_pool_misses() const {
+    return stack_pool.misses();
+  }
   /**
    * Sets the TLS deletion function. The deletion function will be called
    * on every non-NULL TLS value.
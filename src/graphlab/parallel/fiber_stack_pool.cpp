@@ -0,0 +1,152 @@
+/*  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <sys/mman.h>
+#include <unistd.h>
+#include <cerrno>
+#include <graphlab/parallel/fiber_stack_pool.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/logger/assertions.hpp>
+
+namespace graphlab {
+
+#ifdef MADV_FREE
+// cleared the first time the kernel rejects MADV_FREE (older than 4.5)
+static volatile bool madv_free_supported = true;
+#endif
+static volatile bool guard_failure_reported = false;
+
+fiber_stack_pool::fiber_stack_pool(size_t warm_bytes,
+                                   size_t max_cached_bytes)
+    :pagesize(sysconf(_SC_PAGESIZE)),
+    warm_bytes(warm_bytes),
+    max_cached_bytes(max_cached_bytes),
+    ncached_bytes(0) { }
+
+
+fiber_stack_pool::~fiber_stack_pool() {
+  std::map<size_t, free_list>::iterator iter = free_stacks.begin();
+  while (iter != free_stacks.end()) {
+    for (size_t i = 0;i < iter->second.stacks.size(); ++i) {
+      unmap(iter->second.stacks[i], iter->first);
+    }
+    ++iter;
+  }
+  free_stacks.clear();
+  ncached_bytes = 0;
+}
+
+
+size_t fiber_stack_pool::usable_size(size_t stacksize) const {
+  if (stacksize == 0) stacksize = 1;
+  return ((stacksize + pagesize - 1) / pagesize) * pagesize;
+}
+
+
+void* fiber_stack_pool::allocate(size_t stacksize) {
+  const size_t usable = usable_size(stacksize);
+  lock.lock();
+  std::map<size_t, free_list>::iterator iter = free_stacks.find(usable);
+  if (iter != free_stacks.end() && !iter->second.stacks.empty()) {
+    // warm stacks first
+    void* stack = iter->second.stacks.back();
+    iter->second.stacks.pop_back();
+    if (iter->second.nwarm > 0) --iter->second.nwarm;
+    ncached_bytes -= usable;
+    lock.unlock();
+    nhits.inc();
+    return stack;
+  }
+  lock.unlock();
+  nmisses.inc();
+
+  // one guard page below the stack. MAP_NORESERVE since most of the
+  // stack is never touched.
+  void* base = mmap(NULL, usable + pagesize, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+  if (base == MAP_FAILED) {
+    logstream(LOG_FATAL) << "Unable to map a fiber stack of " << usable
+                         << " bytes: errno " << errno << std::endl;
+  }
+  // Each guard page splits the mapping in two, so very many fibers can
+  // run into vm.max_map_count. Carry on without the guard in that case.
+  if (mprotect(base, pagesize, PROT_NONE) != 0 && !guard_failure_reported) {
+    guard_failure_reported = true;
+    logstream(LOG_WARNING) << "Unable to protect fiber stack guard page: errno "
+                           << errno << ". Stacks are left unguarded while "
+                           << "this persists. Consider raising "
+                           << "vm.max_map_count." << std::endl;
+  }
+  return (char*)base + pagesize;
+}
+
+
+void fiber_stack_pool::deallocate(void* stack, size_t stacksize) {
+  if (stack == NULL) return;
+  const size_t usable = usable_size(stacksize);
+  lock.lock();
+  if (ncached_bytes + usable > max_cached_bytes) {
+    lock.unlock();
+    unmap(stack, usable);
+    return;
+  }
+  free_list& fl = free_stacks[usable];
+  if ((fl.nwarm + 1) * usable <= warm_bytes) {
+    fl.stacks.push_back(stack);
+    ++fl.nwarm;
+    ncached_bytes += usable;
+    lock.unlock();
+    return;
+  }
+  lock.unlock();
+  // Enough warm stacks of this size. No one else can see this stack
+  // yet, so release its pages outside of the lock.
+  release_pages(stack, usable);
+  lock.lock();
+  free_stacks[usable].stacks.push_front(stack);
+  ncached_bytes += usable;
+  lock.unlock();
+}
+
+
+void fiber_stack_pool::release_pages(void* stack, size_t usable) {
+  // The topmost page holds the initial context and is touched by every
+  // fiber, so there is no point giving it back.
+  const size_t len = usable - pagesize;
+  if (len == 0) return;
+#ifdef MADV_FREE
+  if (madv_free_supported) {
+    if (madvise(stack, len, MADV_FREE) == 0) return;
+    if (errno == EINVAL) madv_free_supported = false;
+  }
+#endif
+  madvise(stack, len, MADV_DONTNEED);
+}
+
+
+void fiber_stack_pool::unmap(void* stack, size_t usable) {
+  munmap((char*)stack - pagesize, usable + pagesize);
+}
+
+} // namespace graphlab
@@ -0,0 +1,116 @@
+/*  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_FIBER_STACK_POOL_HPP
+#define GRAPHLAB_FIBER_STACK_POOL_HPP
+#include <cstddef>
+#include <map>
+#include <deque>
+#include <boost/noncopyable.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/atomic.hpp>
+
+namespace graphlab {
+
+/**
+ * \ingroup threading
+ * A recycling allocator for fiber stacks.
+ *
+ * Every stack is an anonymous private mapping whose lowest page is
+ * mapped PROT_NONE, so a fiber which overflows its stack faults
+ * immediately instead of silently corrupting the heap. Pages are only
+ * committed by the kernel when the fiber first touches them.
+ *
+ * Released stacks are kept on a free list keyed by their page rounded
+ * size and handed back out by the next allocation of the same size,
+ * avoiding the mmap / mprotect / munmap round trip. Up to warm_bytes of
+ * each size are cached as is and reused first. Stacks released beyond
+ * that have their pages (all but the topmost, which every fiber
+ * touches) returned to the kernel with MADV_FREE, falling back to
+ * MADV_DONTNEED on kernels without it. Once more than max_cached_bytes
+ * of stacks are cached, further released stacks are unmapped.
+ */
+class fiber_stack_pool : boost::noncopyable {
+ public:
+  fiber_stack_pool(size_t warm_bytes = 16 * 1024 * 1024,
+                   size_t max_cached_bytes = 1024 * 1024 * 1024);
+
+  /// Unmaps all cached stacks. Outstanding stacks are not tracked.
+  ~fiber_stack_pool();
+
+  /**
+   * Returns the lowest usable address of a stack of at least stacksize
+   * bytes. The usable size is stacksize rounded up to a multiple of the
+   * page size (see usable_size()). Fails fatally if the stack cannot be
+   * mapped.
+   */
+  void* allocate(size_t stacksize);
+
+  /**
+   * Returns a stack obtained from allocate(stacksize) to the pool.
+   * stacksize must be the same value passed to allocate().
+   */
+  void deallocate(void* stack, size_t stacksize);
+
+  /// The number of usable bytes allocate(stacksize) provides
+  size_t usable_size(size_t stacksize) const;
+
+  /// Number of allocations satisfied from the free list
+  size_t hits() const { return nhits.value; }
+
+  /// Number of allocations which had to map a new stack
+  size_t misses() const { return nmisses.value; }
+
+  /// Number of bytes of stack (excluding guard pages) currently cached
+  size_t cached_bytes() const { return ncached_bytes; }
+
+ private:
+  size_t pagesize;
+  size_t warm_bytes;
+  size_t max_cached_bytes;
+
+  // Stacks whose pages have been released are at the front, the
+  // remaining nwarm stacks at the back.
+  struct free_list {
+    free_list():nwarm(0) { }
+    std::deque<void*> stacks;
+    size_t nwarm;
+  };
+
+  mutex lock;
+  // free stacks, keyed by usable size. Protected by lock.
+  std::map<size_t, free_list> free_stacks;
+  size_t ncached_bytes;
+
+  atomic<size_t> nhits;
+  atomic<size_t> nmisses;
+
+  /// Returns the pages below the top page of a cached stack to the kernel
+  void release_pages(void* stack, size_t usable);
+  /// Unmaps a stack and its guard page
+  void unmap(void* stack, size_t usable);
+}; // end of fiber_stack_pool
+
+} // namespace graphlab
+#endif
@@ -277,7 +277,7 @@ namespace graphlab {
       timeout.tv_nsec += (suseconds_t)ns;
       timeout.tv_sec += (time_t)s;
       // shift the nsec to sec if overflow
-      if (timeout.tv_nsec > 1000000000) {
+      if (timeout.tv_nsec >= 1000000000) {
         timeout.tv_sec ++;
         timeout.tv_nsec -= 1000000000;
       }
@@ -290,8 +290,8 @@ namespace graphlab {
       gettimeofday(&tv, NULL);
       assert(ns > 0);
       // convert ns to s and ns
-      size_t s = ns / 1000000;
-      ns = ns % 1000000;
+      size_t s = ns / 1000000000;
+      ns = ns % 1000000000;
 
       // convert timeval to timespec
       timeout.tv_nsec = tv.tv_usec * 1000;
@@ -301,7 +301,7 @@ namespace graphlab {
       timeout.tv_nsec += (suseconds_t)ns;
       timeout.tv_sec += (time_t)s;
       // shift the nsec to sec if overflow
-      if (timeout.tv_nsec > 1000000000) {
+      if (timeout.tv_nsec >= 1000000000) {
         timeout.tv_sec ++;
         timeout.tv_nsec -= 1000000000;
       }
@@ -0,0 +1,145 @@
+/*  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#ifndef GRAPHLAB_PARALLEL_WORK_STEALING_DEQUE_HPP
+#define GRAPHLAB_PARALLEL_WORK_STEALING_DEQUE_HPP
+#include <sys/types.h>
+#include <vector>
+#include <graphlab/parallel/atomic_ops.hpp>
+
+namespace graphlab {
+
+/**
+ * A Chase-Lev work stealing deque.
+ * (D. Chase, Y. Lev. Dynamic Circular Work-Stealing Deque. SPAA 2005)
+ *
+ * The owning thread pushes and pops at the bottom of the deque while any
+ * other thread may steal from the top. push_bottom() and pop_bottom() must
+ * only be called by one thread at a time. steal() is safe from anywhere.
+ * The deque grows as needed. Arrays which have been outgrown are kept
+ * until destruction since a concurrent steal() may still be reading them.
+ */
+template <typename T>
+class work_stealing_deque {
+ private:
+  struct circular_array {
+    size_t mask;
+    T* data;
+    explicit circular_array(size_t size): mask(size - 1), data(new T[size]) { }
+    ~circular_array() { delete [] data; }
+    size_t size() const { return mask + 1; }
+    T& operator[](ssize_t i) { return data[size_t(i) & mask]; }
+  };
+
+  volatile ssize_t top;
+  char pad0[64 - sizeof(ssize_t)];
+  volatile ssize_t bottom;
+  circular_array* volatile array;
+  char pad1[64 - sizeof(ssize_t) - sizeof(circular_array*)];
+  /// outgrown arrays. Only touched by the owner
+  std::vector<circular_array*> retired;
+
+  void grow(ssize_t b, ssize_t t) {
+    circular_array* a = array;
+    circular_array* newarray = new circular_array(a->size() * 2);
+    for (ssize_t i = t; i < b; ++i) (*newarray)[i] = (*a)[i];
+    retired.push_back(a);
+    __sync_synchronize();
+    array = newarray;
+  }
+
+  // not copyable
+  work_stealing_deque(const work_stealing_deque&);
+  void operator=(const work_stealing_deque&);
+
+ public:
+  /// Constructs a deque. initial_size must be a power of 2
+  explicit work_stealing_deque(size_t initial_size = 256):
+      top(0), bottom(0), array(new circular_array(initial_size)) { }
+
+  ~work_stealing_deque() {
+    delete array;
+    for (size_t i = 0; i < retired.size(); ++i) delete retired[i];
+  }
+
+  /// Pushes an element to the bottom. Owner only.
+  void push_bottom(const T& t) {
+    ssize_t b = bottom;
+    ssize_t tp = top;
+    if (b - tp >= ssize_t(array->size()) - 1) grow(b, tp);
+    (*array)[b] = t;
+    __sync_synchronize();
+    bottom = b + 1;
+  }
+
+  /**
+   * Pops an element from the bottom. Owner only.
+   * Returns false if the deque is empty.
+   */
+  bool pop_bottom(T& ret) {
+    ssize_t b = bottom - 1;
+    circular_array* a = array;
+    bottom = b;
+    __sync_synchronize();
+    ssize_t t = top;
+    if (b < t) {
+      // empty
+      bottom = b + 1;
+      return false;
+    }
+    ret = (*a)[b];
+    if (b > t) return true;
+    // last element. race against the thieves for it
+    bool success = atomic_compare_and_swap(top, t, t + 1);
+    bottom = t + 1;
+    return success;
+  }
+
+  /**
+   * Steals an element from the top. Safe to call from any thread.
+   * Returns false if the deque is empty or if another thread won the
+   * race for the element.
+   */
+  bool steal(T& ret) {
+    ssize_t t = top;
+    __sync_synchronize();
+    ssize_t b = bottom;
+    if (t >= b) return false;
+    circular_array* a = array;
+    ret = (*a)[t];
+    return atomic_compare_and_swap(top, t, t + 1);
+  }
+
+  /// Approximate number of elements in the deque
+  size_t size() const {
+    ssize_t s = bottom - top;
+    return s > 0 ? size_t(s) : 0;
+  }
+
+  /// Returns true if the deque is empty. Need not be consistent.
+  bool empty() const {
+    return size() == 0;
+  }
+};
+
+} // namespace graphlab
+#endif
@@ -0,0 +1,231 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_BATCHED_REMOTE_CALL_HPP
+#define GRAPHLAB_BATCHED_REMOTE_CALL_HPP
+
+#include <vector>
+#include <boost/function.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/rpc/dc.hpp>
+#include <graphlab/rpc/dc_dist_object.hpp>
+
+
+namespace graphlab {
+
+  /**
+   * \ingroup rpc
+   *
+   * Coalesces many small calls of the same kind into a few large messages.
+   *
+   * Each remote_call is deserialized and dispatched on its own, which
+   * dominates the cost of workloads issuing millions of tiny identical
+   * calls. A batched_remote_call instead accumulates the arguments of
+   * calls to one handler in per thread, per target buffers, ships each
+   * buffer as a single message and invokes the handler once per message
+   * with the whole vector of arguments.
+   *
+   * For instance, to signal vertices on remote machines:
+   * \code
+   * struct signaller {
+   *   batched_remote_call<std::pair<vertex_id_type, double> > signal_rpc;
+   *
+   *   signaller(distributed_control& dc, size_t nthreads):
+   *     signal_rpc(dc, boost::bind(&signaller::signal_batch, this, _1, _2),
+   *                nthreads) { }
+   *
+   *   void signal_batch(procid_t src,
+   *                     std::vector<std::pair<vertex_id_type, double> >& calls) {
+   *     for (size_t i = 0;i < calls.size(); ++i) ... signal calls[i] ...
+   *   }
+   * };
+   *
+   * .. In parallel .. {
+   *   s.signal_rpc.call([target machine], [argument], [thread id]);
+   *   ...
+   *   s.signal_rpc.partial_flush([thread id]);
+   * }
+   * \endcode
+   *
+   * Calls are sent when a buffer reaches max_batch_size bytes or when it
+   * is flushed, so a call may wait arbitrarily long in its buffer unless
+   * partial_flush() or flush() is called. The calls of a batch reach
+   * the handler in the order they were made, but there is no ordering
+   * between batches, even between two batches from the same thread id
+   * to the same target: the handler may be invoked by several RPC
+   * handler threads at once.
+   *
+   * Like all distributed objects, the batched_remote_call must be
+   * constructed in the same order on all machines. The constructor
+   * performs a barrier.
+   *
+   * \see graphlab::buffered_exchange
+   */
+  template<typename ArgType>
+  class batched_remote_call {
+  public:
+    typedef std::vector<ArgType> batch_type;
+    /// Receives the calls made by the machine in the first argument
+    typedef boost::function<void (procid_t, batch_type&)> handler_type;
+
+  private:
+    /** The rpc interface for this class */
+    mutable dc_dist_object<batched_remote_call> rpc;
+
+    handler_type handler;
+
+    struct send_record {
+      oarchive* oarc;
+      size_t numcalls;
+    };
+
+    std::vector<send_record> send_buffers;
+    std::vector<mutex> send_locks;
+    const size_t num_threads;
+    const size_t max_batch_size;
+
+  public:
+    /**
+     * Constructs a batched remote call.
+     *
+     * \param dc The master distributed_control object
+     * \param handler Invoked on the target machine once for every batch
+     *                of calls received.
+     * \param num_threads The number of threads to support. Each thread id
+     *                    gets its own send buffer to every machine.
+     * \param max_batch_size Size in bytes of the serialized arguments at
+     *                       which a batch is sent.
+     */
+    batched_remote_call(distributed_control& dc,
+                        handler_type handler,
+                        const size_t num_threads = 1,
+                        const size_t max_batch_size = DEFAULT_BATCHED_CALL_SIZE) :
+      rpc(dc, this),
+      handler(handler),
+      send_buffers(num_threads * dc.numprocs()),
+      send_locks(num_threads * dc.numprocs()),
+      num_threads(num_threads),
+      max_batch_size(max_batch_size) {
+      for (size_t i = 0;i < send_buffers.size(); ++i) {
+        send_buffers[i].oarc = NULL;
+        send_buffers[i].numcalls = 0;
+      }
+      rpc.barrier();
+    }
+
+    ~batched_remote_call() {
+      for (size_t i = 0;i < send_buffers.size(); ++i) {
+        if (send_buffers[i].oarc != NULL) {
+          rpc.split_call_cancel(send_buffers[i].oarc);
+        }
+      }
+    }
+
+    /**
+     * Queues a call of the handler on machine target with argument arg,
+     * using the send buffer owned by thread_id.
+     */
+    void call(const procid_t target, const ArgType& arg,
+              const size_t thread_id = 0) {
+      ASSERT_LT(target, rpc.numprocs());
+      ASSERT_LT(thread_id, num_threads);
+      const size_t index = thread_id * rpc.numprocs() + target;
+      send_locks[index].lock();
+      send_record& rec = send_buffers[index];
+      if (rec.oarc == NULL) {
+        rec.oarc = rpc.split_call_begin(&batched_remote_call::rpc_recv);
+        (*rec.oarc) << rpc.procid();
+      }
+      (*rec.oarc) << arg;
+      ++rec.numcalls;
+      if (rec.oarc->off >= max_batch_size) {
+        oarchive* oarc = take_buffer(index);
+        send_locks[index].unlock();
+        rpc.split_call_end(target, oarc);
+      } else {
+        send_locks[index].unlock();
+      }
+    }
+
+    /**
+     * Sends the calls buffered by thread_id to all machines.
+     */
+    void partial_flush(const size_t thread_id) {
+      ASSERT_LT(thread_id, num_threads);
+      for (procid_t target = 0; target < rpc.numprocs(); ++target) {
+        flush_buffer(thread_id * rpc.numprocs() + target);
+      }
+    }
+
+    /**
+     * Sends all buffered calls. This is not a collective operation:
+     * use distributed_control::full_barrier() to wait for the calls
+     * of all machines to complete.
+     */
+    void flush() {
+      for (size_t i = 0;i < send_buffers.size(); ++i) flush_buffer(i);
+    }
+
+  private:
+    void rpc_recv(size_t len, wild_pointer w) {
+      iarchive iarc(reinterpret_cast<const char*>(w.ptr), len);
+      procid_t src_proc; iarc >> src_proc;
+      ASSERT_LT(src_proc, rpc.numprocs());
+      // the number of calls is stored in the last size_t bytes
+      size_t numcalls = 0;
+      memcpy(&numcalls,
+             reinterpret_cast<const char*>(w.ptr) + len - sizeof(size_t),
+             sizeof(size_t));
+      batch_type calls(numcalls);
+      for (size_t i = 0;i < numcalls; ++i) iarc >> calls[i];
+      handler(src_proc, calls);
+    }
+
+    // detaches the archive of send_buffers[index], finishing it with the
+    // number of calls. Must be called with the lock held
+    oarchive* take_buffer(size_t index) {
+      oarchive* oarc = send_buffers[index].oarc;
+      oarc->write(reinterpret_cast<char*>(&send_buffers[index].numcalls),
+                  sizeof(size_t));
+      send_buffers[index].oarc = NULL;
+      send_buffers[index].numcalls = 0;
+      return oarc;
+    }
+
+    void flush_buffer(size_t index) {
+      const procid_t target = index % rpc.numprocs();
+      send_locks[index].lock();
+      oarchive* oarc = NULL;
+      if (send_buffers[index].numcalls > 0) oarc = take_buffer(index);
+      send_locks[index].unlock();
+      if (oarc != NULL) {
+        rpc.split_call_end(target, oarc);
+        rpc.dc().flush_soon(target);
+      }
+    }
+  }; // end of batched_remote_call
+
+}; // end of graphlab namespace
+
+#endif
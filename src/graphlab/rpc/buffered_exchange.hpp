@@ -24,6 +24,10 @@
 #ifndef GRAPHLAB_BUFFERED_EXCHANGE_HPP
 #define GRAPHLAB_BUFFERED_EXCHANGE_HPP
 
+#include <unistd.h>
+#include <cstdlib>
+#include <string>
+#include <deque>
 #include <graphlab/parallel/pthread_tools.hpp>
 #include <graphlab/parallel/fiber_control.hpp>
 #include <graphlab/rpc/dc.hpp>
@@ -63,6 +67,9 @@ namespace graphlab {
    * \note The buffered exchange sends data in the background, so recv can be
    * called even before the flush calls.
    *
+   * \note Received buffers are held in memory until recv() is called. See
+   * set_spill_budget() to bound that memory.
+   *
    * \see graphlab::fiber_buffered_exchange
    */
   template<typename T>
@@ -74,16 +81,34 @@ namespace graphlab {
     struct buffer_record {
       procid_t proc;
       buffer_type buffer;
-      buffer_record() : proc(-1)  { }
+      /// The size of the message the buffer was read from
+      size_t bytes;
+      buffer_record() : proc(-1), bytes(0)  { }
     }; // end of buffer record
 
+    /// A received message written to the spill file unread
+    struct spilled_record {
+      size_t offset;
+      size_t bytes;
+      size_t numel;
+    };
 
 
     /** The rpc interface for this class */
     mutable dc_dist_object<buffered_exchange> rpc;
 
     std::deque< buffer_record > recv_buffers;
-    mutex recv_lock;
+    mutable mutex recv_lock;
+
+    /** Receive side spilling. All guarded by recv_lock. */
+    size_t spill_budget;
+    std::string spill_directory;
+    /// Bytes of the messages held in recv_buffers
+    size_t recv_bytes;
+    std::deque< spilled_record > spilled_buffers;
+    /// The spill file, unlinked once created. -1 if none.
+    int spill_fd;
+    size_t spill_end;
 
 
     struct send_record {
@@ -111,15 +136,21 @@ namespace graphlab {
      *                  the exchange process, but there are performance / contention
      *                  advantages if this matches.
      * \ref max_buffer_size The size of the per thread and per target send buffer.
+     *                      If 0, the buffers are sized by the flush controller
+     *                      of the distributed_control from the measured
+     *                      throughput to each target and a process wide memory
+     *                      budget (see the "exchange_budget_mb" option of
+     *                      dc_init_param::initstring).
      */
     buffered_exchange(distributed_control& dc,
                       const size_t num_threads = 1,
-                      const size_t max_buffer_size = DEFAULT_BUFFERED_EXCHANGE_SIZE) :
+                      const size_t max_buffer_size = 0) :
       rpc(dc, this),
       send_buffers(num_threads *  dc.numprocs()),
       send_locks(num_threads *  dc.numprocs()),
       num_threads(num_threads),
-      max_buffer_size(max_buffer_size) {
+      max_buffer_size(max_buffer_size),
+      spill_budget(0), recv_bytes(0), spill_fd(-1), spill_end(0) {
        //
        for (size_t i = 0;i < send_buffers.size(); ++i) {
          // initialize the split call
@@ -128,6 +159,9 @@ namespace graphlab {
          // begin by writing the src proc.
          (*(send_buffers[i].oarc)) << rpc.procid();
        }
+       if (max_buffer_size == 0) {
+         rpc.dc().flush_control().register_buffers(send_buffers.size());
+       }
        rpc.barrier();
       }
 
@@ -137,6 +171,24 @@ namespace graphlab {
       for (size_t i = 0;i < send_buffers.size(); ++i) {
         rpc.split_call_cancel(send_buffers[i].oarc);
       }
+      if (max_buffer_size == 0) {
+        rpc.dc().flush_control().unregister_buffers(send_buffers.size());
+      }
+      if (spill_fd >= 0) ::close(spill_fd);
+    }
+
+    /**
+     * Bounds the memory used by received buffers which have not been
+     * recv()'d yet. Messages arriving while more than budget bytes are
+     * held are written, still serialized, to a file in directory and read
+     * back by recv() once the buffers in memory are consumed. A budget of
+     * 0 (the default) keeps everything in memory.
+     */
+    void set_spill_budget(size_t budget, const std::string& directory) {
+      recv_lock.lock();
+      spill_budget = budget;
+      spill_directory = directory;
+      recv_lock.unlock();
     }
     // buffered_exchange(distributed_control& dc, handler_type recv_handler,
     //                   size_t buffer_size = 1000) :
@@ -158,7 +210,7 @@ namespace graphlab {
       (*(send_buffers[index].oarc)) << value;
       ++send_buffers[index].numinserts;
 
-      if(send_buffers[index].oarc->off >= max_buffer_size) {
+      if(send_buffers[index].oarc->off >= buffer_limit(proc)) {
         oarchive* prevarc = swap_buffer(index);
         send_locks[index].unlock();
         // complete the send
@@ -227,7 +279,7 @@ namespace graphlab {
       dc_impl::blob read_buffer;
       bool has_lock = false;
       if(try_lock) {
-        if (recv_buffers.empty()) return false;
+        if (empty()) return false;
         has_lock = recv_lock.try_lock();
       } else {
         recv_lock.lock();
@@ -242,9 +294,20 @@ namespace graphlab {
           ret_proc = rec.proc;
           ret_buffer.swap(rec.buffer);
           ASSERT_LT(ret_proc, rpc.numprocs());
+          recv_bytes -= rec.bytes;
           recv_buffers.pop_front();
+        } else if (!spilled_buffers.empty()) {
+          success = true;
+          read_spilled(spilled_buffers.front(), read_buffer);
+          spilled_buffers.pop_front();
+          // reuse the file once everything in it has been read
+          if (spilled_buffers.empty()) spill_end = 0;
         }
         recv_lock.unlock();
+        if (read_buffer.c != NULL) {
+          decode(read_buffer.c, read_buffer.len, ret_proc, ret_buffer);
+          read_buffer.free();
+        }
       }
 
       return success;
@@ -262,6 +325,9 @@ namespace graphlab {
       foreach(const buffer_record& rec, recv_buffers) {
         count += rec.buffer.size();
       }
+      foreach(const spilled_record& rec, spilled_buffers) {
+        count += rec.numel;
+      }
       recv_lock.unlock();
       return count;
     } // end of size
@@ -269,38 +335,114 @@ namespace graphlab {
     /**
      * Returns true if there are no elements available for receiving.
      */
-    bool empty() const { return recv_buffers.empty(); }
+    bool empty() const {
+      return recv_buffers.empty() && spilled_buffers.empty();
+    }
 
     void clear() { }
 
     void barrier() { rpc.barrier(); }
   private:
     void rpc_recv(size_t len, wild_pointer w) {
-      buffer_type tmp;
-      iarchive iarc(reinterpret_cast<const char*>(w.ptr), len);
-      // first desrialize the source process
-      procid_t src_proc; iarc >> src_proc;
-      ASSERT_LT(src_proc, rpc.numprocs());
-      // create an iarchive which just points to the last size_t bytes
-      // to get the number of elements
-      iarchive numel_iarc(reinterpret_cast<const char*>(w.ptr) + len - sizeof(size_t),
-                          sizeof(size_t));
-      size_t numel = 0; 
-      numel_iarc.read(reinterpret_cast<char*>(&numel), sizeof(size_t));
-      //std::cout << "Receiving: " << numel << "\n";
-      tmp.resize(numel);
-      for (size_t i = 0;i < numel; ++i) {
-        iarc >> tmp[i];
+      const char* ptr = reinterpret_cast<const char*>(w.ptr);
+      recv_lock.lock();
+      if (spill_budget > 0 && recv_bytes + len > spill_budget) {
+        write_spilled(ptr, len);
+        recv_lock.unlock();
+        return;
       }
+      // reserve the memory before decoding so concurrent receives see it
+      recv_bytes += len;
+      recv_lock.unlock();
+
+      buffer_type tmp;
+      procid_t src_proc;
+      decode(ptr, len, src_proc, tmp);
 
       recv_lock.lock();
       recv_buffers.push_back(buffer_record());
       buffer_record& rec = recv_buffers.back();
       rec.proc = src_proc;
       rec.buffer.swap(tmp);
+      rec.bytes = len;
       recv_lock.unlock();
     } // end of rpc rcv
 
+    /// The number of elements in a message, stored in its last size_t bytes
+    static size_t message_numel(const char* ptr, size_t len) {
+      size_t numel = 0;
+      memcpy(&numel, ptr + len - sizeof(size_t), sizeof(size_t));
+      return numel;
+    }
+
+    /// Deserializes a message written by send()
+    void decode(const char* ptr, size_t len,
+                procid_t& src_proc, buffer_type& buffer) {
+      iarchive iarc(ptr, len);
+      // first desrialize the source process
+      iarc >> src_proc;
+      ASSERT_LT(src_proc, rpc.numprocs());
+      const size_t numel = message_numel(ptr, len);
+      //std::cout << "Receiving: " << numel << "\n";
+      buffer.resize(numel);
+      for (size_t i = 0;i < numel; ++i) {
+        iarc >> buffer[i];
+      }
+    }
+
+    /// Appends a message to the spill file. recv_lock must be held.
+    void write_spilled(const char* ptr, size_t len) {
+      if (spill_fd < 0) {
+        std::string fname = spill_directory + "/graphlab_exchange_XXXXXX";
+        std::vector<char> name(fname.begin(), fname.end());
+        name.push_back(0);
+        spill_fd = mkstemp(&name[0]);
+        if (spill_fd < 0) {
+          logstream(LOG_FATAL) << "Unable to create exchange spill file in "
+                               << spill_directory << std::endl;
+        }
+        ::unlink(&name[0]);
+      }
+      spilled_record rec;
+      rec.offset = spill_end;
+      rec.bytes = len;
+      rec.numel = message_numel(ptr, len);
+      size_t written = 0;
+      while (written < len) {
+        ssize_t ret = pwrite(spill_fd, ptr + written, len - written,
+                             rec.offset + written);
+        if (ret <= 0) {
+          logstream(LOG_FATAL) << "Error writing the exchange spill file"
+                               << std::endl;
+        }
+        written += ret;
+      }
+      spill_end += len;
+      spilled_buffers.push_back(rec);
+    }
+
+    /// Reads a spilled message into a new blob. recv_lock must be held.
+    void read_spilled(const spilled_record& rec, dc_impl::blob& out) {
+      out.c = (char*)malloc(rec.bytes);
+      out.len = rec.bytes;
+      size_t nread = 0;
+      while (nread < rec.bytes) {
+        ssize_t ret = pread(spill_fd, out.c + nread, rec.bytes - nread,
+                            rec.offset + nread);
+        if (ret <= 0) {
+          logstream(LOG_FATAL) << "Error reading the exchange spill file"
+                               << std::endl;
+        }
+        nread += ret;
+      }
+    }
+
+
+    /// the size at which the buffers to the given target are sent
+    inline size_t buffer_limit(procid_t proc) {
+      if (max_buffer_size > 0) return max_buffer_size;
+      return rpc.dc().flush_control().buffer_size(proc);
+    }
 
     // create a new buffer for send_buffer[index], returning the old buffer
     oarchive* swap_buffer(size_t index) {
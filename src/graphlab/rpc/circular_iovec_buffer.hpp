@@ -25,6 +25,7 @@
 #define GRAPHLAB_RPC_CIRCULAR_IOVEC_BUFFER_HPP
 #include <vector>
 #include <sys/socket.h>
+#include <graphlab/rpc/dc_internal_types.hpp>
 
 namespace graphlab{
 namespace dc_impl {
@@ -35,12 +36,15 @@ namespace dc_impl {
  * A circular buffer which maintains a parallel sequence of iovecs.
  * One sequence is basic iovecs
  * The other sequence is used for storing the original unomidifed pointers
+ * A third sequence holds the owner of entries which point into caller
+ * owned memory (see zero_copy_buffer). These are released instead of freed.
  * This is minimally checked. length must be a power of 2
  */
 struct circular_iovec_buffer {
   inline circular_iovec_buffer(size_t len = 4096) {
     v.resize(4096);
     parallel_v.resize(4096);
+    pinned.resize(4096, NULL);
     head = 0;
     tail = 0;
     numel = 0;
@@ -64,6 +68,7 @@ struct circular_iovec_buffer {
 
     v.resize(n);
     parallel_v.resize(n);
+    pinned.resize(n, NULL);
     if (head >= tail && numel > 0) {
       // there is a loop around
       // we need to fix the shift
@@ -71,6 +76,7 @@ struct circular_iovec_buffer {
       for (size_t i = 0;i < tail; ++i) {
         v[newtail] = v[i];
         parallel_v[newtail] = parallel_v[i];
+        pinned[newtail] = pinned[i];
         ++newtail;
       }
       tail = newtail;
@@ -82,6 +88,7 @@ struct circular_iovec_buffer {
     for (size_t i = 0;i < nwrite; ++i) {
       v[tail] = other[i];
       parallel_v[tail] = other[i];
+      pinned[tail] = NULL;
       tail = (tail + 1) & (v.size() - 1);
     }
     numel += nwrite;
@@ -99,6 +106,24 @@ struct circular_iovec_buffer {
 
     v[tail] = entry;
     parallel_v[tail] = entry;
+    pinned[tail] = NULL;
+    tail = (tail + 1) & (v.size() - 1); ++numel;
+  }
+
+
+  /**
+   * Writes an entry pointing into caller owned memory, resizing the buffer
+   * if necessary. Once sent, the entry is released through owner
+   * instead of being freed.
+   */
+  inline void write(const iovec &entry, zero_copy_state* owner) {
+    if (numel == v.size()) {
+      reserve(2 * numel);
+    }
+
+    v[tail] = entry;
+    parallel_v[tail] = entry;
+    pinned[tail] = owner;
     tail = (tail + 1) & (v.size() - 1); ++numel;
   }
 
@@ -117,6 +142,7 @@ struct circular_iovec_buffer {
 
     v[tail] = actual_ptr_entry;
     parallel_v[tail] = entry;
+    pinned[tail] = NULL;
     tail = (tail + 1) & (v.size() - 1); ++numel;
   }
 
@@ -125,7 +151,12 @@ struct circular_iovec_buffer {
    * Erases a single iovec from the head and free the pointer
    */
   inline void erase_from_head_and_free() {
-    free(v[head].iov_base);
+    if (pinned[head] != NULL) {
+      pinned[head]->decref();
+      pinned[head] = NULL;
+    } else {
+      free(v[head].iov_base);
+    }
     head = (head + 1) & (v.size() - 1);
     --numel;
   }
@@ -161,6 +192,7 @@ struct circular_iovec_buffer {
 
   std::vector<struct iovec> v;
   std::vector<struct iovec> parallel_v;
+  std::vector<zero_copy_state*> pinned;
   size_t head;
   size_t tail;
   size_t numel;
@@ -42,11 +42,13 @@
 
 #include <graphlab/rpc/dc.hpp>
 #include <graphlab/rpc/dc_tcp_comm.hpp>
+#include <graphlab/rpc/dc_shm_comm.hpp>
 //#include <graphlab/rpc/dc_sctp_comm.hpp>
 #include <graphlab/rpc/dc_buffered_stream_send2.hpp>
 #include <graphlab/rpc/dc_stream_receive.hpp>
 #include <graphlab/rpc/request_reply_handler.hpp>
 #include <graphlab/rpc/dc_services.hpp>
+#include <graphlab/parallel/fiber_remote_request.hpp>
 
 #include <graphlab/rpc/dc_init_from_env.hpp>
 #include <graphlab/rpc/dc_init_from_mpi.hpp>
@@ -136,6 +138,16 @@ distributed_control::distributed_control() {
     initparam.numhandlerthreads = RPC_DEFAULT_NUMHANDLERTHREADS;
     initparam.commtype = RPC_DEFAULT_COMMTYPE;
   }
+  // GRAPHLAB_COMM=shm selects the shared memory communication layer
+  char* commname = getenv("GRAPHLAB_COMM");
+  if (commname != NULL && std::string(commname) == "shm") {
+    initparam.commtype = SHM_COMM;
+  }
+  // GRAPHLAB_RPC_COMPRESS=lz4 enables block compression
+  char* compressname = getenv("GRAPHLAB_RPC_COMPRESS");
+  if (compressname != NULL) {
+    initparam.initstring += std::string(" compress=") + compressname + " ";
+  }
   init(initparam.machines,
         initparam.initstring,
         initparam.curmachineid,
@@ -166,6 +178,9 @@ distributed_control::~distributed_control() {
   logstream(LOG_INFO) << "Shutting down distributed control " << std::endl;
   FREE_CALLBACK_EVENT(EVENT_NETWORK_BYTES);
   FREE_CALLBACK_EVENT(EVENT_RPC_CALLS);
+  FREE_CALLBACK_EVENT(EVENT_EXCHANGE_BUFFER_SIZE);
+  FREE_CALLBACK_EVENT(EVENT_EXCHANGE_MEMORY);
+  FREE_CALLBACK_EVENT(EVENT_SEND_POLL_INTERVAL);
   // call all deletion callbacks
   for (size_t i = 0; i < deletion_callbacks.size(); ++i) {
     deletion_callbacks[i]();
@@ -202,7 +217,7 @@ distributed_control::~distributed_control() {
   logstream(LOG_INFO) << "Calls Received: " << calls_received() << std::endl;
 
   delete comm;
-
+  delete flushcontrol;
 }
 
 
@@ -213,6 +228,11 @@ void distributed_control::exec_function_call(procid_t source,
   BEGIN_TRACEPOINT(dc_call_dispatch);
   // extract the dispatch function
   iarchive arc(data, len);
+  if (packet_type_mask & INLINE_CALL) {
+    // skip the id of the target object
+    size_t objid;
+    arc >> objid;
+  }
   size_t f;
   arc >> f;
   // a regular funcion call
@@ -405,6 +425,194 @@ void distributed_control::process_fcall_block(fcallqueue_entry &fcallblock) {
 #endif
 }
 
+size_t distributed_control::register_memory_region(void* ptr, size_t len) {
+  ASSERT_NE(ptr, (void*)NULL);
+  memory_region region;
+  region.ptr = reinterpret_cast<char*>(ptr);
+  region.len = len;
+  memory_regions_lock.writelock();
+  memory_regions.push_back(region);
+  size_t id = memory_regions.size() - 1;
+  memory_regions_lock.wrunlock();
+  return id;
+}
+
+void distributed_control::unregister_memory_region(size_t region) {
+  memory_regions_lock.writelock();
+  ASSERT_LT(region, memory_regions.size());
+  memory_regions[region].ptr = NULL;
+  memory_regions[region].len = 0;
+  memory_regions_lock.wrunlock();
+}
+
+char* distributed_control::one_sided_address(const dc_impl::one_sided_hdr& hdr) {
+  if (hdr.region >= memory_regions.size() ||
+      memory_regions[hdr.region].ptr == NULL) {
+    logstream(LOG_WARNING) << "One-sided access to unregistered memory region "
+                           << hdr.region << std::endl;
+    return NULL;
+  }
+  const memory_region& region = memory_regions[hdr.region];
+  if (hdr.offset > region.len || hdr.len > region.len - hdr.offset) {
+    logstream(LOG_WARNING) << "One-sided access to bytes [" << hdr.offset
+                           << ", " << hdr.offset + hdr.len << ") of memory region "
+                           << hdr.region << " of length " << region.len << std::endl;
+    return NULL;
+  }
+  return region.ptr + hdr.offset;
+}
+
+void distributed_control::send_one_sided(procid_t target,
+                                         const dc_impl::one_sided_hdr& hdr,
+                                         const char* data, size_t datalen) {
+  size_t bodylen = sizeof(dc_impl::one_sided_hdr) + datalen;
+  ASSERT_LT(bodylen, size_t(uint32_t(-1)));
+  char* buf = (char*)malloc(sizeof(dc_impl::packet_hdr) + bodylen);
+  dc_impl::packet_hdr* packet = reinterpret_cast<dc_impl::packet_hdr*>(buf);
+  packet->len = bodylen;
+  packet->src = procid();
+  packet->packet_type_mask = ONE_SIDED_PACKET | CONTROL_PACKET;
+  packet->sequentialization_key = 0;
+  char* body = buf + sizeof(dc_impl::packet_hdr);
+  memcpy(body, &hdr, sizeof(dc_impl::one_sided_hdr));
+  if (datalen > 0) {
+    memcpy(body + sizeof(dc_impl::one_sided_hdr), data, datalen);
+  }
+  // bypass the thread local buffers: the receiving threads have none,
+  // and the operation should go out at once
+  senders[target]->write_to_buffer(buf, sizeof(dc_impl::packet_hdr) + bodylen);
+  senders[target]->flush();
+}
+
+request_future<bool> distributed_control::remote_get(procid_t target,
+                                                     size_t region,
+                                                     size_t offset,
+                                                     void* dst, size_t len) {
+  ASSERT_LT(target, numprocs());
+  dc_impl::one_sided_hdr hdr;
+  hdr.op = dc_impl::ONE_SIDED_GET;
+  hdr.region = region;
+  hdr.offset = offset;
+  hdr.len = len;
+  hdr.dst = reinterpret_cast<size_t>(dst);
+  if (target == procid()) {
+    memory_regions_lock.readlock();
+    const char* src = one_sided_address(hdr);
+    if (src != NULL) memcpy(dst, src, len);
+    memory_regions_lock.rdunlock();
+    return request_future<bool>(src != NULL);
+  }
+  fiber_reply_container* reply = new fiber_reply_container;
+  request_future<bool> ret(reply);
+  hdr.handle = reinterpret_cast<size_t>(reply);
+  send_one_sided(target, hdr, NULL, 0);
+  return ret;
+}
+
+request_future<bool> distributed_control::remote_put(procid_t target,
+                                                     size_t region,
+                                                     size_t offset,
+                                                     const void* src,
+                                                     size_t len) {
+  ASSERT_LT(target, numprocs());
+  dc_impl::one_sided_hdr hdr;
+  hdr.op = dc_impl::ONE_SIDED_PUT;
+  hdr.region = region;
+  hdr.offset = offset;
+  hdr.len = len;
+  hdr.dst = 0;
+  if (target == procid()) {
+    memory_regions_lock.readlock();
+    char* dst = one_sided_address(hdr);
+    if (dst != NULL) memcpy(dst, src, len);
+    memory_regions_lock.rdunlock();
+    return request_future<bool>(dst != NULL);
+  }
+  fiber_reply_container* reply = new fiber_reply_container;
+  request_future<bool> ret(reply);
+  hdr.handle = reinterpret_cast<size_t>(reply);
+  send_one_sided(target, hdr, reinterpret_cast<const char*>(src), len);
+  return ret;
+}
+
+void distributed_control::exec_one_sided(procid_t source,
+                                         const char* data, size_t len) {
+  ASSERT_GE(len, sizeof(dc_impl::one_sided_hdr));
+  dc_impl::one_sided_hdr hdr;
+  memcpy(&hdr, data, sizeof(dc_impl::one_sided_hdr));
+  const char* payload = data + sizeof(dc_impl::one_sided_hdr);
+  if (hdr.op == dc_impl::ONE_SIDED_GET) {
+    dc_impl::one_sided_hdr reply = hdr;
+    memory_regions_lock.readlock();
+    const char* src = one_sided_address(hdr);
+    if (src != NULL) {
+      reply.op = dc_impl::ONE_SIDED_GET_REPLY;
+      // send_one_sided copies the data before it returns
+      send_one_sided(source, reply, src, hdr.len);
+    } else {
+      reply.op = dc_impl::ONE_SIDED_ERROR;
+      send_one_sided(source, reply, NULL, 0);
+    }
+    memory_regions_lock.rdunlock();
+  } else if (hdr.op == dc_impl::ONE_SIDED_PUT) {
+    ASSERT_EQ(len, sizeof(dc_impl::one_sided_hdr) + hdr.len);
+    memory_regions_lock.readlock();
+    char* dst = one_sided_address(hdr);
+    if (dst != NULL) memcpy(dst, payload, hdr.len);
+    memory_regions_lock.rdunlock();
+    dc_impl::one_sided_hdr reply = hdr;
+    reply.op = (dst != NULL) ? dc_impl::ONE_SIDED_PUT_ACK
+                             : dc_impl::ONE_SIDED_ERROR;
+    send_one_sided(source, reply, NULL, 0);
+  } else {
+    if (hdr.op == dc_impl::ONE_SIDED_GET_REPLY) {
+      ASSERT_EQ(len, sizeof(dc_impl::one_sided_hdr) + hdr.len);
+      memcpy(reinterpret_cast<char*>(hdr.dst), payload, hdr.len);
+    }
+    // complete the request_future<bool>
+    oarchive oarc;
+    oarc << bool(hdr.op != dc_impl::ONE_SIDED_ERROR);
+    dc_impl::ireply_container* container =
+        reinterpret_cast<dc_impl::ireply_container*>(hdr.handle);
+    container->receive(source, dc_impl::blob(oarc.buf, oarc.off));
+  }
+}
+
+bool distributed_control::inline_call_target_ready(const char* data,
+                                                   size_t len) {
+  iarchive arc(data, len);
+  size_t objid;
+  arc >> objid;
+  return objid == dc_impl::NO_OBJECT_ID || is_registered_object(objid);
+}
+
+void distributed_control::process_receive_thread_packets(char* buf, size_t& len) {
+  // the remaining packets are moved to the front of the chunk
+  size_t kept = 0;
+  size_t offset = 0;
+  while (offset < len) {
+    dc_impl::packet_hdr* hdr = reinterpret_cast<dc_impl::packet_hdr*>(buf + offset);
+    size_t packetlen = sizeof(dc_impl::packet_hdr) + hdr->len;
+    if (hdr->packet_type_mask & ONE_SIDED_PACKET) {
+      exec_one_sided(hdr->src, buf + offset + sizeof(dc_impl::packet_hdr),
+                     hdr->len);
+    } else if ((hdr->packet_type_mask & INLINE_CALL) &&
+               inline_call_target_ready(buf + offset + sizeof(dc_impl::packet_hdr),
+                                        hdr->len)) {
+      if (!(hdr->packet_type_mask & CONTROL_PACKET)) {
+        global_bytes_received[hdr->src].inc(hdr->len);
+      }
+      exec_function_call(hdr->src, hdr->packet_type_mask,
+                         buf + offset + sizeof(dc_impl::packet_hdr), hdr->len);
+    } else {
+      if (kept != offset) memmove(buf + kept, buf + offset, packetlen);
+      kept += packetlen;
+    }
+    offset += packetlen;
+  }
+  len = kept;
+}
+
 void distributed_control::stop_handler_threads(size_t threadid,
                                                 size_t total_threadid) {
   stop_handler_threads_no_wait(threadid, total_threadid);
@@ -531,6 +739,8 @@ void distributed_control::init(const std::vector<std::string> &machines,
 
   if (commtype == TCP_COMM) {
     comm = new dc_impl::dc_tcp_comm();
+  } else if (commtype == SHM_COMM) {
+    comm = new dc_impl::dc_shm_comm();
   } else {
     ASSERT_MSG(false, "Unexpected value for comm type");
   }
@@ -538,6 +748,19 @@ void distributed_control::init(const std::vector<std::string> &machines,
     receivers.push_back(new dc_impl::dc_stream_receive(this, i));
     senders.push_back(new dc_impl::dc_buffered_stream_send2(this, comm, i));
   }
+  size_t exchange_budget = RPC_EXCHANGE_MEMORY_BUDGET;
+  if (!options["exchange_budget_mb"].empty()) {
+    int budget_mb = atoi(options["exchange_budget_mb"].c_str());
+    if (budget_mb > 0) {
+      exchange_budget = size_t(budget_mb) * 1024 * 1024;
+    } else {
+      logstream(LOG_WARNING) << "Invalid exchange_budget_mb \""
+                             << options["exchange_budget_mb"]
+                             << "\". Using the default." << std::endl;
+    }
+  }
+  flushcontrol = new dc_impl::flush_controller(senders, exchange_budget);
+  comm->set_flush_controller(flushcontrol);
   // create the handler threads
   // store the threads in the threadgroup
   fcall_handler_active.resize(numhandlerthreads);
@@ -568,7 +791,11 @@ void distributed_control::init(const std::vector<std::string> &machines,
 
   comm->init(machines, options, curmachineid,
               receivers, senders);
-  logstream(LOG_INFO) << "TCP Communication layer constructed." << std::endl;
+  if (commtype == SHM_COMM) {
+    logstream(LOG_INFO) << "Shared memory Communication layer constructed." << std::endl;
+  } else {
+    logstream(LOG_INFO) << "TCP Communication layer constructed." << std::endl;
+  }
   if (localprocid == 0) {
     logstream(LOG_EMPH) << "Cluster of " << machines.size() << " instances created." << std::endl;
     // check for duplicate IP addresses
@@ -605,6 +832,7 @@ void distributed_control::init(const std::vector<std::string> &machines,
   last_dc_procid = localprocid;
 
   barrier();
+  negotiate_compression(options, commtype);
   // initialize the empty stream
   nullstrm.open(boost::iostreams::null_sink());
 
@@ -615,10 +843,50 @@ void distributed_control::init(const std::vector<std::string> &machines,
       "MB", boost::bind(&distributed_control::network_megabytes_sent, this));
   ADD_CUMULATIVE_CALLBACK_EVENT(EVENT_RPC_CALLS, "RPC Calls",
       "Calls", boost::bind(&distributed_control::calls_sent, this));
+  ADD_INSTANTANEOUS_CALLBACK_EVENT(EVENT_EXCHANGE_BUFFER_SIZE,
+      "Exchange Buffer Size", "KB",
+      boost::bind(&dc_impl::flush_controller::mean_buffer_size_kb, flushcontrol));
+  ADD_INSTANTANEOUS_CALLBACK_EVENT(EVENT_EXCHANGE_MEMORY,
+      "Exchange Buffer Memory", "MB",
+      boost::bind(&dc_impl::flush_controller::buffer_memory_mb, flushcontrol));
+  ADD_INSTANTANEOUS_CALLBACK_EVENT(EVENT_SEND_POLL_INTERVAL,
+      "Send Poll Interval", "ms",
+      boost::bind(&dc_impl::flush_controller::send_poll_timeout_ms, flushcontrol));
 }
 
 
 
+void distributed_control::negotiate_compression(
+    std::map<std::string, std::string>& options, dc_comm_type commtype) {
+  std::string value = options["compress"];
+  bool wants_compression = (value == "lz4" || value == "yes" ||
+                            value == "true" || value == "1");
+  if (!value.empty() && !wants_compression && value != "no" &&
+      value != "false" && value != "0") {
+    logstream(LOG_WARNING) << "Unknown compression \"" << value
+                           << "\". Compression disabled." << std::endl;
+  }
+  std::vector<int> procs_want_compression(numprocs(), 0);
+  procs_want_compression[procid()] = wants_compression;
+  all_gather(procs_want_compression, true);
+
+  size_t ncompressed = 0;
+  for (procid_t i = 0;i < numprocs(); ++i) {
+    if (i == procid() || !wants_compression || !procs_want_compression[i]) {
+      continue;
+    }
+    // shared memory links are not worth compressing
+    if (commtype == SHM_COMM &&
+        static_cast<dc_impl::dc_shm_comm*>(comm)->is_local(i)) continue;
+    senders[i]->set_option("compress", 1);
+    ++ncompressed;
+  }
+  if (ncompressed > 0) {
+    logstream(LOG_INFO) << "LZ4 block compression enabled to "
+                        << ncompressed << " peers" << std::endl;
+  }
+}
+
 void distributed_control::barrier() {
   distributed_services->barrier();
 }
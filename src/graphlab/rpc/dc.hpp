@@ -40,6 +40,7 @@
 #include <graphlab/rpc/dc_receive.hpp>
 #include <graphlab/rpc/dc_send.hpp>
 #include <graphlab/rpc/dc_comm_base.hpp>
+#include <graphlab/rpc/flush_controller.hpp>
 #include <graphlab/rpc/dc_dist_object_base.hpp>
 
 #include <graphlab/rpc/is_rpc_call.hpp>
@@ -50,6 +51,7 @@
 #include <graphlab/rpc/function_ret_type.hpp>
 #include <graphlab/rpc/dc_compile_parameters.hpp>
 #include <graphlab/rpc/thread_local_send_buffer.hpp>
+#include <graphlab/rpc/zero_copy_buffer.hpp>
 #include <graphlab/util/tracepoint.hpp>
 #include <graphlab/rpc/distributed_event_log.hpp>
 #include <boost/preprocessor.hpp>
@@ -85,7 +87,32 @@ struct dc_init_param{
   /** Additional construction options of the form
     "key1=value1,key2=value2".
 
-    There are no available options at this time.
+    Available options:
+    \li \b compress=lz4 Compresses outgoing buffers of at least
+                         RPC_COMPRESSION_THRESHOLD bytes with LZ4. This
+                         helps on slow networks with compressible
+                         (e.g. text or sparse numeric) payloads. It is
+                         negotiated per connection: only the links between
+                         two processes which both pass this option are
+                         compressed. "yes", "true" and "1" are accepted as
+                         well. Setting the environment variable
+                         GRAPHLAB_RPC_COMPRESS=lz4 has the same effect for
+                         the default constructor.
+    \li \b sockets_per_peer=N Opens N TCP connections to every machine
+                         and stripes outgoing blocks across them. Calls
+                         made with a sequentialization key always travel
+                         on the first connection, so their ordering is
+                         unaffected. All machines must pass the same
+                         value. Defaults to 1.
+    \li \b comm_threads=N Number of TCP send threads and of receive
+                         threads, each running its own event loop.
+                         Connections are spread across them. Defaults to
+                         sockets_per_peer.
+    \li \b exchange_budget_mb=N Total memory in MB the send buffers of
+                         all buffered_exchange objects may use. Buffers are
+                         sized from this budget and the measured throughput
+                         to each machine. Defaults to
+                         RPC_EXCHANGE_MEMORY_BUDGET.
 
     Internal options which should not be used
     \li \b __socket__=NUMBER Forces TCP comm to use this socket number for its
@@ -107,8 +134,12 @@ struct dc_init_param{
    * \param numhandlerthreads Optional Argument. The number of handler
    *                          threads to create. Defaults to
    *                          \ref RPC_DEFAULT_NUMHANDLERTHREADS
-   * \param commtype The Communication type. The only accepted value now is
-   *                 TCP_COMM
+   * \param commtype The Communication type. May be TCP_COMM, or
+   *                 SHM_COMM which connects the processes on the same host
+   *                 through shared memory and all others through TCP. The
+   *                 default constructor of distributed_control selects
+   *                 SHM_COMM if the environment variable GRAPHLAB_COMM is
+   *                 set to "shm".
    */
   dc_init_param(size_t numhandlerthreads = RPC_DEFAULT_NUMHANDLERTHREADS,
                 dc_comm_type commtype = RPC_DEFAULT_COMMTYPE):
@@ -227,6 +258,9 @@ class distributed_control{
   std::vector<dc_impl::dc_receive*> receivers;
   std::vector<dc_impl::dc_send*> senders;
 
+  /// sizes the exchange buffers and picks the send poll interval
+  dc_impl::flush_controller* flushcontrol;
+
   /// A thread group of function call handlers
   fiber_group fcallhandlers;
   std::vector<atomic<size_t> > fcall_handler_active;
@@ -278,6 +312,50 @@ class distributed_control{
 
   std::map<std::string, std::string> parse_options(std::string initstring);
 
+  /// Enables block compression on the links where both ends ask for it
+  void negotiate_compression(std::map<std::string, std::string>& options,
+                             dc_comm_type commtype);
+
+  /// A memory region registered for one-sided access
+  struct memory_region {
+    char* ptr;
+    size_t len;
+  };
+  std::vector<memory_region> memory_regions;
+  rwlock memory_regions_lock;
+
+  /**
+   * Returns the address a one-sided operation on this machine accesses,
+   * or NULL if it is not within a registered region.
+   * memory_regions_lock must be held.
+   */
+  char* one_sided_address(const dc_impl::one_sided_hdr& hdr);
+
+  /// Sends a ONE_SIDED_PACKET followed by datalen bytes of data
+  void send_one_sided(procid_t target, const dc_impl::one_sided_hdr& hdr,
+                      const char* data, size_t datalen);
+
+  /// Executes the body of a ONE_SIDED_PACKET
+  void exec_one_sided(procid_t source, const char* data, size_t len);
+
+  /**
+   * Services the ONE_SIDED_PACKETs and executes the INLINE_CALLs in a
+   * chunk of complete packets, removing them from it. Called by the
+   * receiving thread before the chunk is passed to
+   * deferred_function_call_chunk(). len is updated to the length of the
+   * remaining packets. An inline call to an object which is not yet
+   * registered is left in the chunk, since waiting for the object here
+   * would stop the receiving thread.
+   */
+  void process_receive_thread_packets(char* buf, size_t& len);
+
+  /**
+   * Returns true if the object an INLINE_CALL is addressed to exists,
+   * i.e. the call can run without waiting. data and len describe the
+   * packet body.
+   */
+  bool inline_call_target_ready(const char* data, size_t len);
+
   volatile inline size_t num_registered_objects() {
     return registered_objects.size();
   }
@@ -290,6 +368,9 @@ class distributed_control{
 
   DECLARE_EVENT(EVENT_NETWORK_BYTES);
   DECLARE_EVENT(EVENT_RPC_CALLS);
+  DECLARE_EVENT(EVENT_EXCHANGE_BUFFER_SIZE);
+  DECLARE_EVENT(EVENT_EXCHANGE_MEMORY);
+  DECLARE_EVENT(EVENT_SEND_POLL_INTERVAL);
  public:
 
   /**
@@ -474,8 +555,10 @@ class distributed_control{
   Generates the interface functions. 3rd argument is a tuple (interface name, issue name, flags)
   */
   BOOST_PP_REPEAT(6, RPC_INTERFACE_GENERATOR, (remote_call, dc_impl::remote_call_issue, STANDARD_CALL) )
-  BOOST_PP_REPEAT(6, RPC_INTERFACE_GENERATOR, (reply_remote_call,dc_impl::remote_call_issue, STANDARD_CALL | FLUSH_PACKET) )
+  BOOST_PP_REPEAT(6, RPC_INTERFACE_GENERATOR, (reply_remote_call,dc_impl::remote_call_issue, STANDARD_CALL | INLINE_CALL | FLUSH_PACKET) )
   BOOST_PP_REPEAT(6, RPC_INTERFACE_GENERATOR, (control_call, dc_impl::remote_call_issue, (STANDARD_CALL | CONTROL_PACKET)) )
+  BOOST_PP_REPEAT(6, RPC_INTERFACE_GENERATOR, (inline_call, dc_impl::remote_call_issue, (STANDARD_CALL | INLINE_CALL | FLUSH_PACKET)) )
+  BOOST_PP_REPEAT(6, RPC_INTERFACE_GENERATOR, (reply_control_call, dc_impl::remote_call_issue, (STANDARD_CALL | CONTROL_PACKET | INLINE_CALL | FLUSH_PACKET)) )
 
 
 #define BROADCAST_INTERFACE_GENERATOR(Z,N,FNAME_AND_CALL) \
@@ -587,6 +670,31 @@ class distributed_control{
 
 
 
+/**
+ * \brief Performs a non-blocking RPC call which the target machine
+ * executes on its receiving thread.
+ *
+ * Behaves like remote_call(), except that the call does not wait in the
+ * queue of a function call handler: the thread which receives it from
+ * the network runs it right away. The call is also flushed immediately.
+ * For tiny calls, this saves the cost of the handoff and of waking up a
+ * handler, which can be larger than the cost of the call itself.
+ *
+ * Only use this for functions which are short and never block or
+ * yield: while the function runs, nothing else is received from the
+ * calling machine. The function does not run in a fiber. Inline calls
+ * are not ordered with respect to the other calls from the same machine,
+ * even when a sequentialization key is set.
+ *
+ * \param targetmachine The ID of the machine to run the function on
+ * \param fn The function to run on the target machine
+ * \param ... The arguments to send to Fn. Arguments must be serializable.
+ *            and must be castable to the target types.
+ */
+  void inline_call(procid_t targetmachine, Fn fn, ...);
+
+
+
 /**
  * \brief Performs a non-blocking RPC call to a collection of machines
  * to run the provided function pointer.
@@ -942,6 +1050,99 @@ class distributed_control{
     return ret;
   }
 
+  /** \brief Returns the block compression counters of the connection
+   * to the given peer. See the "compress" option of
+   * dc_init_param::initstring.
+   */
+  inline dc_compression_stats compression_stats(procid_t peer) const {
+    dc_compression_stats stats;
+    senders[peer]->get_compression_stats(stats);
+    receivers[peer]->get_compression_stats(stats);
+    return stats;
+  }
+
+  /** \brief Returns the block compression counters summed over all
+   * connections.
+   */
+  inline dc_compression_stats compression_stats() const {
+    dc_compression_stats stats;
+    for (size_t i = 0;i < senders.size(); ++i) {
+      senders[i]->get_compression_stats(stats);
+      receivers[i]->get_compression_stats(stats);
+    }
+    return stats;
+  }
+
+  /** \brief Returns the controller which sizes the buffers of
+   * buffered_exchange and picks the poll interval of the send threads.
+   * See the "exchange_budget_mb" option of dc_init_param::initstring.
+   */
+  inline dc_impl::flush_controller& flush_control() {
+    return *flushcontrol;
+  }
+
+  /**
+   * \brief Registers a memory region for one-sided access by other
+   * machines, returning its id.
+   *
+   * Regions are numbered in the order they are registered, so when all
+   * machines register their regions in the same order, an id names the
+   * corresponding region on every machine. A region must be registered
+   * on the target before it is accessed, for instance by calling
+   * barrier() after registering it.
+   *
+   * One-sided operations (remote_get() and remote_put()) are serviced by
+   * the receiving thread of the target as soon as they arrive, without
+   * going through the function call handlers. They are not synchronized
+   * with local accesses to the region: as with RDMA, the application must
+   * ensure the region is not modified while remote machines read it.
+   * On the TCP and shared memory comms they are emulated with messages.
+   *
+   * demoapps/rpc/rpc_example11.cpp shows the usage.
+   */
+  size_t register_memory_region(void* ptr, size_t len);
+
+  /**
+   * \brief Stops one-sided access to a region. One-sided operations
+   * on it which arrive later fail.
+   */
+  void unregister_memory_region(size_t region);
+
+  /**
+   * \brief Reads len bytes at offset of the given registered region of
+   * machine target into dst.
+   *
+   * Returns immediately. The data is in dst once the returned future is
+   * ready, and dst must remain valid until then. Waiting on the future
+   * from within a fiber deschedules the fiber. The future's value is
+   * false, and dst is left unchanged, if the bytes are not all within
+   * the region, or the region is not registered on target.
+   *
+   * \code
+   * // every machine exposes its local array
+   * size_t region = dc.register_memory_region(&local[0],
+   *                                           local.size() * sizeof(double));
+   * dc.barrier();
+   * double d;
+   * bool ok = dc.remote_get(1, region, 10 * sizeof(double),
+   *                         &d, sizeof(double))();
+   * \endcode
+   */
+  request_future<bool> remote_get(procid_t target, size_t region,
+                                  size_t offset, void* dst, size_t len);
+
+  /**
+   * \brief Writes len bytes from src at offset of the given registered
+   * region of machine target.
+   *
+   * src is copied before the call returns. The returned future becomes
+   * ready once the write has been applied on the target. As with
+   * remote_get(), its value is false, and nothing is written, if the
+   * bytes are not all within a registered region.
+   */
+  request_future<bool> remote_put(procid_t target, size_t region,
+                                  size_t offset, const void* src, size_t len);
+
   /// \cond GRAPHLAB_INTERNAL
 
   /// \internal
@@ -959,6 +1160,12 @@ class distributed_control{
     return registered_objects[id];
   }
 
+  /// \internal
+  /// Returns true if the object has been registered. Never blocks.
+  inline bool is_registered_object(size_t id) {
+    return id < num_registered_objects() && registered_objects[id] != NULL;
+  }
+
   /// \internal
   inline dc_impl::dc_dist_object_base* get_rmi_instance(size_t id) {
     while(id >= num_registered_objects()) sched_yield();
@@ -1298,6 +1505,25 @@ class distributed_control{
   template <typename U, typename PlusEqual>
   inline void all_reduce2(U& data, PlusEqual plusequal, bool control = false);
 
+  /**
+   * \brief Selects the algorithm used by the collective operations
+   * (broadcast(), gather(), all_gather(), all_reduce() and all_reduce2())
+   * of this distributed_control.
+   *
+   * COLLECTIVE_LOG_DEPTH (the default) uses binomial trees for broadcast()
+   * and gather(), and recursive doubling for all_gather() and all_reduce(),
+   * completing in O(log(numprocs())) rounds with no single machine handling
+   * more than O(log(numprocs())) messages. COLLECTIVE_WIDE_TREE uses the
+   * original tree of fan-out BARRIER_BRANCH_FACTOR rooted at machine 0.
+   * COLLECTIVE_LOG_DEPTH always sends its messages on the control plane,
+   * whatever the "control" argument of the collective.
+   *
+   * All machines must call this with the same value, and not while a
+   * collective operation is in progress. Each dc_dist_object selects its
+   * own algorithm through dc_dist_object::set_collective_type().
+   */
+  inline void set_collective_type(dc_collective_type type);
+
 
    /**
     \brief A distributed barrier which waits for all machines to call the
@@ -1448,6 +1674,10 @@ inline void distributed_control::all_reduce2(U& data, PlusEqual plusequal, bool
   distributed_services->all_reduce2(data, plusequal, control);
 }
 
+inline void distributed_control::set_collective_type(dc_collective_type type) {
+  distributed_services->rmi_instance().set_collective_type(type);
+}
+
 
 
 
@@ -22,14 +22,26 @@
 
 
 #include <iostream>
+#include <algorithm>
 #include <boost/iostreams/stream.hpp>
 
 #include <graphlab/rpc/dc.hpp>
 #include <graphlab/rpc/dc_buffered_stream_send2.hpp>
 #include <graphlab/util/branch_hints.hpp>
+#include <graphlab/util/lz4_block.hpp>
 namespace graphlab {
 namespace dc_impl {
 
+  namespace {
+    // a buffer must shrink by at least 1/COMPRESSION_MIN_SAVING to be
+    // sent compressed
+    const size_t COMPRESSION_MIN_SAVING = 8;
+    // after this many consecutive incompressible buffers ...
+    const size_t INCOMPRESSIBLE_STREAK_LIMIT = 8;
+    // ... this many buffers are sent without trying
+    const size_t INCOMPRESSIBLE_SKIP_BLOCKS = 64;
+  }
+
   void dc_buffered_stream_send2::flush() {
     comm->trigger_send_timeout(target, true);
   }
@@ -40,6 +52,69 @@ namespace dc_impl {
 
 
 
+  size_t dc_buffered_stream_send2::set_option(std::string opt, size_t val) {
+    size_t prevval = 0;
+    if (opt == "compress") {
+      prevval = compress;
+      compress = (val != 0);
+    } else if (opt == "streams") {
+      lock.lock();
+      prevval = nstreams;
+      nstreams = std::max<size_t>(val, 1);
+      held_back.resize(nstreams);
+      lock.unlock();
+    }
+    return prevval;
+  }
+
+  void dc_buffered_stream_send2::
+      get_compression_stats(dc_compression_stats& stats) const {
+    stats.blocks_compressed += blocks_compressed.value;
+    stats.blocks_uncompressed += blocks_uncompressed.value;
+    stats.bytes_before += bytes_before.value;
+    stats.bytes_after += bytes_after.value;
+  }
+
+  void dc_buffered_stream_send2::compress_buffer(iovec& sendvec) {
+    if (!compress || sendvec.iov_len < RPC_COMPRESSION_THRESHOLD ||
+        sendvec.iov_len > uint32_t(-1)) return;
+    if (skip_blocks > 0) {
+      --skip_blocks;
+      return;
+    }
+    const size_t headerlen = sizeof(packet_hdr) + sizeof(uint32_t);
+    // give up as soon as the output is not meaningfully smaller
+    size_t cap = sendvec.iov_len - sendvec.iov_len / COMPRESSION_MIN_SAVING
+                 - headerlen;
+    char* out = (char*)malloc(headerlen + cap);
+    size_t clen = lz4::compress((char*)sendvec.iov_base, sendvec.iov_len,
+                                out + headerlen, cap);
+    if (clen == 0) {
+      free(out);
+      blocks_uncompressed.inc();
+      if (++incompressible_streak >= INCOMPRESSIBLE_STREAK_LIMIT) {
+        incompressible_streak = 0;
+        skip_blocks = INCOMPRESSIBLE_SKIP_BLOCKS;
+      }
+      return;
+    }
+    incompressible_streak = 0;
+    packet_hdr* hdr = reinterpret_cast<packet_hdr*>(out);
+    hdr->len = sizeof(uint32_t) + clen;
+    hdr->src = dc->procid();
+    hdr->packet_type_mask = COMPRESSED_PACKET;
+    hdr->sequentialization_key = 0;
+    uint32_t rawlen = sendvec.iov_len;
+    memcpy(out + sizeof(packet_hdr), &rawlen, sizeof(uint32_t));
+
+    blocks_compressed.inc();
+    bytes_before.inc(sendvec.iov_len);
+    bytes_after.inc(headerlen + clen);
+    free(sendvec.iov_base);
+    sendvec.iov_base = out;
+    sendvec.iov_len = headerlen + clen;
+  }
+
   inline size_t dc_buffered_stream_send2::bytes_sent() {
     size_t ret = total_bytes_sent;
     lock.lock();
@@ -82,21 +157,71 @@ namespace dc_impl {
     for (size_t i = 0; i < all_buffers.size(); ++i) {
       unregister_send_buffer(all_buffers[i]);
     }
+    // release whatever the comm never picked up
+    for (size_t i = 0;i < held_back.size(); ++i) {
+      for (size_t j = 0;j < held_back[i].size(); ++j) {
+        if (held_back[i][j].pinned != NULL) held_back[i][j].pinned->decref();
+        else free(held_back[i][j].buf);
+      }
+    }
+  }
+
+  size_t dc_buffered_stream_send2::choose_stream(const buffer_elem& elem) {
+    if (nstreams == 1) return 0;
+    // Pieces of a packet must arrive in order on a single stream, and so
+    // must calls with a sequentialization key. Only whole blocks without
+    // keyed calls are free to take any stream.
+    if (elem.pinned != NULL || elem.partial ||
+        dc_send::block_sequentialization_key(elem.buf, elem.len) != 0) {
+      return 0;
+    }
+    return (next_stream++) % nstreams;
+  }
+
+  size_t dc_buffered_stream_send2::write_elem(circular_iovec_buffer& outdata,
+                                              const buffer_elem& elem) {
+    iovec sendvec;
+    sendvec.iov_base = elem.buf;
+    sendvec.iov_len = elem.len;
+    if (elem.pinned != NULL) outdata.write(sendvec, elem.pinned);
+    else outdata.write(sendvec);
+    return elem.len;
   }
 
   size_t dc_buffered_stream_send2::get_outgoing_data(circular_iovec_buffer& outdata) {
+    return get_outgoing_data(outdata, 0);
+  }
+
+  size_t dc_buffered_stream_send2::get_outgoing_data(circular_iovec_buffer& outdata,
+                                                     size_t stream) {
     lock.lock();
     size_t sendlen = 0;
+    // buffers held back for this stream were extracted earlier, so they
+    // go first
+    if (stream < held_back.size()) {
+      for (size_t i = 0;i < held_back[stream].size(); ++i) {
+        sendlen += write_elem(outdata, held_back[stream][i]);
+      }
+      held_back[stream].clear();
+    }
     for (size_t i = 0;i < send_buffers.size(); ++i) {
       std::pair<buffer_elem*, buffer_elem*> bufs = send_buffers[i]->extract(target);
       if (bufs.first != NULL) {
         while(bufs.first != bufs.second) {
           buffer_elem* prev = bufs.first;
-          iovec sendvec;
-          sendvec.iov_base = bufs.first->buf;
-          sendvec.iov_len = bufs.first->len;
-          sendlen += sendvec.iov_len;
-          outdata.write(sendvec);
+          buffer_elem elem = *bufs.first;
+          size_t elemstream = choose_stream(elem);
+          // only whole packets can be wrapped in a compressed packet
+          if (elem.pinned == NULL && !elem.partial) {
+            iovec sendvec;
+            sendvec.iov_base = elem.buf;
+            sendvec.iov_len = elem.len;
+            compress_buffer(sendvec);
+            elem.buf = (char*)sendvec.iov_base;
+            elem.len = sendvec.iov_len;
+          }
+          if (elemstream == stream) sendlen += write_elem(outdata, elem);
+          else held_back[elemstream].push_back(elem);
           buffer_elem** next = &bufs.first->next;
           volatile buffer_elem** n = (volatile buffer_elem**)(next);
           while(__unlikely__((*n) == NULL)) {
@@ -107,16 +232,27 @@ namespace dc_impl {
         }
       }
     }
+    // these may not begin or end on packet boundaries, so they are never
+    // compressed and always use stream 0
     for (size_t i = 0;i < additional_flush_buffers.size(); ++i) {
-      iovec sendvec;
-      sendvec.iov_base = additional_flush_buffers[i].first;
-      sendvec.iov_len = additional_flush_buffers[i].second;
-      sendlen += sendvec.iov_len;
-      outdata.write(sendvec);
+      buffer_elem elem;
+      elem.buf = additional_flush_buffers[i].first;
+      elem.len = additional_flush_buffers[i].second;
+      if (stream == 0) sendlen += write_elem(outdata, elem);
+      else held_back[0].push_back(elem);
     }
+    // the buffers now belong to the comm
+    additional_flush_buffers.clear();
     lock.unlock();
     return sendlen;
   }
+
+  bool dc_buffered_stream_send2::has_outgoing_data(size_t stream) {
+    lock.lock();
+    bool ret = stream < held_back.size() && !held_back[stream].empty();
+    lock.unlock();
+    return ret;
+  }
 } // namespace dc_impl
 } // namespace graphlab
 
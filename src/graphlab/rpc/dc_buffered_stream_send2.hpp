@@ -66,7 +66,9 @@ class dc_buffered_stream_send2: public dc_send{
   dc_buffered_stream_send2(distributed_control* dc,
                                    dc_comm_base *comm,
                                    procid_t target) :
-                  dc(dc),  comm(comm), target(target) { }
+                  dc(dc),  comm(comm), target(target), compress(false),
+                  incompressible_streak(0), skip_blocks(0),
+                  nstreams(1), next_stream(0), held_back(1) { }
 
   ~dc_buffered_stream_send2();
 
@@ -76,6 +78,10 @@ class dc_buffered_stream_send2: public dc_send{
 
   size_t get_outgoing_data(circular_iovec_buffer& outdata);
 
+  size_t get_outgoing_data(circular_iovec_buffer& outdata, size_t stream);
+
+  bool has_outgoing_data(size_t stream);
+
   inline size_t bytes_sent();
 
   void write_to_buffer(char* c, size_t len);
@@ -84,6 +90,17 @@ class dc_buffered_stream_send2: public dc_send{
 
   void flush_soon();
 
+  /**
+   * Option "compress": if non-zero, buffers of at least
+   * RPC_COMPRESSION_THRESHOLD bytes are sent LZ4 compressed.
+   * Option "streams": the number of streams the comm keeps to the
+   * target. Blocks are spread round robin across the streams.
+   * Returns the previous value.
+   */
+  size_t set_option(std::string opt, size_t val);
+
+  void get_compression_stats(dc_compression_stats& stats) const;
+
  private:
   /// pointer to the owner
   distributed_control* dc;
@@ -101,6 +118,38 @@ class dc_buffered_stream_send2: public dc_send{
 
   std::vector<std::pair<char*, size_t> > additional_flush_buffers;
   mutex lock;
+
+  bool compress;
+  // number of consecutive buffers which did not compress
+  size_t incompressible_streak;
+  // number of buffers to send uncompressed before trying again
+  size_t skip_blocks;
+  atomic<size_t> blocks_compressed;
+  atomic<size_t> blocks_uncompressed;
+  atomic<size_t> bytes_before;
+  atomic<size_t> bytes_after;
+
+  size_t nstreams;
+  // stream the next unkeyed block is sent on
+  size_t next_stream;
+  // buffers extracted for each stream which its comm thread has not
+  // picked up yet
+  std::vector<std::vector<buffer_elem> > held_back;
+
+  /**
+   * Replaces the buffer in sendvec with a COMPRESSED_PACKET if
+   * compression is enabled and worthwhile.
+   */
+  void compress_buffer(iovec& sendvec);
+
+  /**
+   * Returns the stream a buffer extracted from a thread local buffer is
+   * sent on. Must be called before the buffer is compressed.
+   */
+  size_t choose_stream(const buffer_elem& elem);
+
+  /// Moves a buffer into outdata, returning its length
+  size_t write_elem(circular_iovec_buffer& outdata, const buffer_elem& elem);
 };
 
 
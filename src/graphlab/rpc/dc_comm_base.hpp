@@ -31,6 +31,8 @@
 #include <graphlab/rpc/dc_internal_types.hpp>
 #include <graphlab/rpc/dc_receive.hpp>
 #include <graphlab/rpc/dc_send.hpp>
+#include <graphlab/rpc/dc_compile_parameters.hpp>
+#include <graphlab/rpc/flush_controller.hpp>
 namespace graphlab {
 namespace dc_impl {  
 
@@ -43,7 +45,7 @@ The base class of all comms implementations
 class dc_comm_base {
  public:
    
-  inline dc_comm_base() { };
+  inline dc_comm_base(): flushcontrol(NULL) { };
   
   virtual size_t capabilities() const  = 0;
   /**
@@ -89,6 +91,22 @@ class dc_comm_base {
   virtual size_t network_bytes_received() const = 0;
   virtual size_t send_queue_length() const = 0;
 
+  /**
+   * Sets the controller picking the send poll interval. Must be called
+   * before init(). Without one, SEND_POLL_TIMEOUT is used.
+   */
+  inline void set_flush_controller(flush_controller* controller) {
+    flushcontrol = controller;
+  }
+
+ protected:
+  flush_controller* flushcontrol;
+
+  /// The number of microseconds the send threads should wait between polls
+  inline size_t send_poll_timeout() {
+    if (flushcontrol == NULL) return SEND_POLL_TIMEOUT;
+    return flushcontrol->send_poll_timeout();
+  }
 };
 
 } // namespace dc_impl
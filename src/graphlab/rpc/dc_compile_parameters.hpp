@@ -36,8 +36,18 @@
   \ingroup rpc
   \def RPC_MAX_N_PROCS
   \brief Maximum number of processes supported
+
+  The number of processes is a runtime value. This is only bounded by
+  the width of procid_t (procid_t(-1) is reserved).
+ */
+#define RPC_MAX_N_PROCS 65535
+
+/**
+  \ingroup rpc
+  \def RPC_DEFAULT_COLLECTIVE
+  \brief default algorithm used by the collective operations
  */
-#define RPC_MAX_N_PROCS 128
+#define RPC_DEFAULT_COLLECTIVE COLLECTIVE_LOG_DEPTH
 
 /**
  * \ingroup RPC
@@ -71,6 +81,24 @@
  */
 #define SEND_POLL_TIMEOUT 10000
 
+/**
+ * \ingroup RPC
+ * \def MIN_SEND_POLL_TIMEOUT
+ * Lower bound in microseconds on the poll interval chosen by the
+ * adaptive flush controller. Under load the send threads poll more
+ * often than SEND_POLL_TIMEOUT, but never more often than this.
+ */
+#define MIN_SEND_POLL_TIMEOUT 1000
+
+/**
+ * \ingroup RPC
+ * \def SHM_RING_SIZE
+ * The size in bytes of the shared memory ring buffer carrying the data
+ * from one process to another process on the same host when the
+ * SHM_COMM communication layer is used. Must be a power of 2.
+ */
+#define SHM_RING_SIZE (1024 * 1024)
+
 
 /**
  * \ingroup rpc
@@ -94,6 +122,23 @@
  */
 #define NUM_FULL_BUFFER_LIMIT 32 
 
+/**
+ * \ingroup rpc
+ * \def RPC_COMPRESSION_THRESHOLD
+ * When block compression is enabled (see the "compress" option of
+ * dc_init_param::initstring), outgoing buffers of at least this many
+ * bytes are LZ4 compressed. Smaller buffers are sent as is.
+ */
+#define RPC_COMPRESSION_THRESHOLD 4096
+
+/**
+ * \ingroup rpc
+ * \def RPC_ZERO_COPY_THRESHOLD
+ * zero_copy_buffer arguments of at least this many bytes are sent
+ * without copying. Smaller ones are cheaper to copy.
+ */
+#define RPC_ZERO_COPY_THRESHOLD 16384
+
 /**************************************************************************/
 /*                                                                        */
 /*                          RPC Handling Control                          */
@@ -145,5 +190,45 @@
  */
 #define DEFAULT_BUFFERED_EXCHANGE_SIZE FULL_BUFFER_SIZE_LIMIT
 
+/**
+ * \ingroup RPC
+ * \def RPC_EXCHANGE_MEMORY_BUDGET
+ * Total number of bytes the per thread, per target buffers of all
+ * adaptively sized buffered exchanges in a process may hold. Can be
+ * changed with the "exchange_budget_mb" option of
+ * dc_init_param::initstring.
+ */
+#define RPC_EXCHANGE_MEMORY_BUDGET (128 * 1024 * 1024)
+
+/**
+ * \ingroup RPC
+ * \def MIN_EXCHANGE_BUFFER_SIZE
+ * Smallest buffer size the adaptive flush controller will pick.
+ */
+#define MIN_EXCHANGE_BUFFER_SIZE 4096
+
+/**
+ * \ingroup RPC
+ * \def MAX_EXCHANGE_BUFFER_SIZE
+ * Largest buffer size the adaptive flush controller will pick.
+ */
+#define MAX_EXCHANGE_BUFFER_SIZE (4 * 1024 * 1024)
+
+/**
+ * \ingroup RPC
+ * \def RPC_FLUSH_SAMPLE_INTERVAL
+ * Number of microseconds between two throughput measurements of the
+ * adaptive flush controller.
+ */
+#define RPC_FLUSH_SAMPLE_INTERVAL 100000
+
+/**
+ * \ingroup RPC
+ * \def DEFAULT_BATCHED_CALL_SIZE
+ * Size in bytes of the arguments accumulated by a batched_remote_call
+ * before the batch is sent.
+ */
+#define DEFAULT_BATCHED_CALL_SIZE FULL_BUFFER_SIZE_LIMIT
+
 
 #endif
@@ -28,6 +28,7 @@
 #include <vector>
 #include <string>
 #include <set>
+#include <map>
 #include <graphlab/parallel/atomic.hpp>
 #include <graphlab/parallel/fiber_conditional.hpp>
 #include <graphlab/rpc/dc_internal_types.hpp>
@@ -235,6 +236,9 @@ class dc_dist_object : public dc_impl::dc_dist_object_base{
     ab_barrier_sense = 1;
     ab_barrier_release = -1;
 
+    //-------- Initialize the log-depth collectives --------
+    collective = RPC_DEFAULT_COLLECTIVE;
+    coll_generation = 0;
 
     //-------- Initialize the full barrier ---------
 
@@ -365,6 +369,8 @@ class dc_dist_object : public dc_impl::dc_dist_object_base{
   */
   BOOST_PP_REPEAT(7, RPC_INTERFACE_GENERATOR, (remote_call, dc_impl::object_call_issue, STANDARD_CALL) )
   BOOST_PP_REPEAT(7, RPC_INTERFACE_GENERATOR, (control_call,dc_impl::object_call_issue, (STANDARD_CALL | CONTROL_PACKET)) )
+  BOOST_PP_REPEAT(7, RPC_INTERFACE_GENERATOR, (inline_call,dc_impl::object_call_issue, (STANDARD_CALL | INLINE_CALL | FLUSH_PACKET)) )
+  BOOST_PP_REPEAT(7, RPC_INTERFACE_GENERATOR, (inline_control_call,dc_impl::object_call_issue, (STANDARD_CALL | CONTROL_PACKET | INLINE_CALL | FLUSH_PACKET)) )
 
   /**
    * This generates a "split call". Where the header of the call message
@@ -513,6 +519,7 @@ class dc_dist_object : public dc_impl::dc_dist_object_base{
 
   BOOST_PP_REPEAT(6, RPC_INTERFACE_GENERATOR, (internal_call,dc_impl::object_call_issue, STANDARD_CALL) )
   BOOST_PP_REPEAT(6, RPC_INTERFACE_GENERATOR, (internal_control_call,dc_impl::object_call_issue, (STANDARD_CALL | CONTROL_PACKET)) )
+  BOOST_PP_REPEAT(6, RPC_INTERFACE_GENERATOR, (internal_inline_control_call,dc_impl::object_call_issue, (STANDARD_CALL | CONTROL_PACKET | INLINE_CALL | FLUSH_PACKET)) )
 
 
   #define REQUEST_INTERFACE_GENERATOR(Z,N,ARGS) \
@@ -594,6 +601,24 @@ class dc_dist_object : public dc_impl::dc_dist_object_base{
  */
   void remote_call(procid_t targetmachine, Fn fn, ...);
 
+/**
+ * \brief Performs a non-blocking RPC call to the copy of this object on
+ * the target machine, which executes it on its receiving thread.
+ *
+ * See distributed_control::inline_call(). The member function must be
+ * short and must never block or yield. inline_control_call() does the
+ * same without being counted by full_barrier() or the call statistics.
+ * A call which arrives before the target machine has constructed its
+ * copy of the object is queued for the function call handlers instead.
+ *
+ * \param targetmachine The ID of the machine to run the function on
+ * \param fn The function to run on the target machine. Must be a pointer to
+ *            member function in the owning object.
+ * \param ... The arguments to send to Fn. Arguments must be serializable.
+ *            and must be castable to the target types.
+ */
+  void inline_call(procid_t targetmachine, Fn fn, ...);
+
 
 
 /**
@@ -844,7 +869,7 @@ class dc_dist_object : public dc_impl::dc_dist_object_base{
     recvstruct.lock.unlock();
     if (control == false) {
       // remote call to release the sender. Use an empty blob
-      dc_.control_call(source, request_reply_handler, tag, dc_impl::blob());
+      dc_.reply_control_call(source, request_reply_handler, tag, dc_impl::blob());
       // I have to increment the calls sent manually here
       // since the matched send/recv calls do not go through the
       // typical object calls. It goes through the DC, but I also want to charge
@@ -852,12 +877,259 @@ class dc_dist_object : public dc_impl::dc_dist_object_base{
       inc_calls_received(source);
     }
     else {
-      dc_.control_call(source, request_reply_handler, tag, dc_impl::blob());
+      dc_.reply_control_call(source, request_reply_handler, tag, dc_impl::blob());
     }
   }
 
 
 
+/*****************************************************************************
+                Implementation of the Log-Depth Collectives
+ *****************************************************************************/
+
+ private:
+  /// The collective algorithm used by broadcast, gather, all_gather and
+  /// all_reduce.
+  dc_collective_type collective;
+  /** Sequence number of the current log-depth collective. Every machine
+   * issues collectives in the same order, so (generation, step) uniquely
+   * identifies a message of a collective.
+   */
+  size_t coll_generation;
+  typedef std::map<std::pair<size_t, size_t>, std::string> coll_message_map;
+  /// Collective messages which arrived but have not yet been consumed
+  coll_message_map coll_received;
+  fiber_conditional coll_cond;
+  mutex coll_mut;
+
+  /// step used by the broadcast messages
+  static const size_t COLL_BROADCAST_STEP = 0;
+  /// step used when folding the extra machines into the power of two
+  static const size_t COLL_FOLD_STEP = (size_t)(-1);
+  /// step used to return the reduced value to the extra machines
+  static const size_t COLL_UNFOLD_STEP = (size_t)(-2);
+
+  void __coll_receive(size_t generation, size_t step, const std::string& s) {
+    coll_mut.lock();
+    coll_received[std::make_pair(generation, step)] = s;
+    coll_cond.signal();
+    coll_mut.unlock();
+  }
+
+  /**
+   * Collective messages are always control calls. The waiting fiber may
+   * return, and the object be destroyed, as soon as __coll_receive
+   * signals it, so the dispatcher must not touch the object afterwards
+   * to count the call.
+   */
+  void coll_send(procid_t target, size_t generation, size_t step,
+                 const std::string& s) {
+    internal_control_call(target, &dc_dist_object<T>::__coll_receive,
+                          generation, step, s);
+  }
+
+  /// Waits for the message (generation, step) and removes it from the store
+  std::string coll_wait(size_t generation, size_t step) {
+    std::pair<size_t, size_t> key(generation, step);
+    std::string ret;
+    coll_mut.lock();
+    coll_message_map::iterator iter = coll_received.find(key);
+    while (iter == coll_received.end()) {
+      coll_cond.wait(coll_mut);
+      iter = coll_received.find(key);
+    }
+    ret.swap(iter->second);
+    coll_received.erase(iter);
+    coll_mut.unlock();
+    return ret;
+  }
+
+  template <typename U>
+  static std::string coll_serialize(const U& u) {
+    charstream strm(128);
+    oarchive oarc(strm);
+    oarc << u;
+    strm.flush();
+    return std::string(strm->c_str(), strm->size());
+  }
+
+  template <typename U>
+  static void coll_deserialize(const std::string& s, U& u) {
+    std::stringstream strm(s);
+    iarchive iarc(strm);
+    iarc >> u;
+  }
+
+  /**
+   * The highest power of two which is <= rank. Used to find the parent of
+   * a rank in a binomial tree. rank must be > 0.
+   */
+  static size_t coll_highest_bit(size_t rank) {
+    size_t mask = 1;
+    while (mask * 2 <= rank) mask *= 2;
+    return mask;
+  }
+
+  /**
+   * Children of relative rank "rank" in a binomial tree over numprocs()
+   * machines rooted at relative rank 0. The children are returned largest
+   * subtree first.
+   */
+  std::vector<size_t> coll_binomial_children(size_t rank) const {
+    std::vector<size_t> children;
+    size_t mask = 1;
+    while (mask < numprocs()) mask *= 2;
+    for (mask /= 2; mask > rank; mask /= 2) {
+      if (rank + mask < numprocs()) children.push_back(rank + mask);
+    }
+    return children;
+  }
+
+  /// Binomial tree broadcast. Completes in log2(numprocs()) rounds.
+  template <typename U>
+  void log_depth_broadcast(U& data, bool originator) {
+    size_t generation = coll_generation++;
+    std::pair<size_t, std::string> msg;
+    if (originator) {
+      msg.first = procid();
+      msg.second = coll_serialize(data);
+    }
+    else {
+      coll_deserialize(coll_wait(generation, COLL_BROADCAST_STEP), msg);
+    }
+    // forward the message down my subtree
+    size_t root = msg.first;
+    size_t rank = (procid() + numprocs() - root) % numprocs();
+    std::vector<size_t> children = coll_binomial_children(rank);
+    if (!children.empty()) {
+      std::string forward = coll_serialize(msg);
+      for (size_t i = 0;i < children.size(); ++i) {
+        coll_send((procid_t)((children[i] + root) % numprocs()),
+                  generation, COLL_BROADCAST_STEP, forward);
+      }
+    }
+    if (!originator) coll_deserialize(msg.second, data);
+  }
+
+  /// Binomial tree gather. Completes in log2(numprocs()) rounds.
+  template <typename U>
+  void log_depth_gather(std::vector<U>& data, procid_t sendto) {
+    size_t generation = coll_generation++;
+    size_t rank = (procid() + numprocs() - sendto) % numprocs();
+    // the serialized contributions of my subtree
+    std::vector<std::pair<size_t, std::string> > blocks;
+    if (rank != 0) {
+      blocks.push_back(std::make_pair(size_t(procid()),
+                                      coll_serialize(data[procid()])));
+    }
+    std::vector<size_t> children = coll_binomial_children(rank);
+    for (size_t i = 0;i < children.size(); ++i) {
+      // messages are tagged with the sender's absolute procid
+      size_t child = (children[i] + sendto) % numprocs();
+      std::vector<std::pair<size_t, std::string> > childblocks;
+      coll_deserialize(coll_wait(generation, child), childblocks);
+      blocks.insert(blocks.end(), childblocks.begin(), childblocks.end());
+    }
+    if (rank != 0) {
+      size_t parent = rank - coll_highest_bit(rank);
+      coll_send((procid_t)((parent + sendto) % numprocs()),
+                generation, procid(), coll_serialize(blocks));
+    }
+    else {
+      for (size_t i = 0;i < blocks.size(); ++i) {
+        coll_deserialize(blocks[i].second, data[blocks[i].first]);
+      }
+    }
+  }
+
+  /**
+   * Recursive doubling reduction. Completes in log2(numprocs()) rounds
+   * (plus two if numprocs() is not a power of two), after which all
+   * machines hold the combined value.
+   *
+   * combine(left, right) must implement left = left + right. Both
+   * partners of an exchange always combine the lower ranked value on the
+   * left, so every machine ends up with a bitwise identical result even if
+   * the operation is not exactly associative (i.e. floating point).
+   */
+  template <typename U, typename Combine>
+  void recursive_doubling(U& data, Combine combine) {
+    size_t generation = coll_generation++;
+    size_t pof2 = coll_highest_bit(numprocs());
+    size_t me = procid();
+    if (me >= pof2) {
+      // fold into (me - pof2), and wait for the result
+      coll_send((procid_t)(me - pof2), generation, COLL_FOLD_STEP,
+                coll_serialize(data));
+      coll_deserialize(coll_wait(generation, COLL_UNFOLD_STEP), data);
+      return;
+    }
+    if (me + pof2 < numprocs()) {
+      U other;
+      coll_deserialize(coll_wait(generation, COLL_FOLD_STEP), other);
+      combine(data, other);
+    }
+    size_t step = 1;
+    for (size_t mask = 1; mask < pof2; mask *= 2, ++step) {
+      size_t partner = me ^ mask;
+      coll_send((procid_t)partner, generation, step,
+                coll_serialize(data));
+      U other;
+      coll_deserialize(coll_wait(generation, step), other);
+      if (me < partner) {
+        combine(data, other);
+      }
+      else {
+        combine(other, data);
+        data = other;
+      }
+    }
+    if (me + pof2 < numprocs()) {
+      coll_send((procid_t)(me + pof2), generation, COLL_UNFOLD_STEP,
+                coll_serialize(data));
+    }
+  }
+
+  /// Concatenates the (procid, serialized value) blocks of an all_gather
+  struct coll_block_append {
+    void operator()(std::vector<std::pair<size_t, std::string> >& left,
+                    const std::vector<std::pair<size_t, std::string> >& right) {
+      left.insert(left.end(), right.begin(), right.end());
+    }
+  };
+
+  template <typename U>
+  void log_depth_all_gather(std::vector<U>& data) {
+    std::vector<std::pair<size_t, std::string> > blocks;
+    blocks.push_back(std::make_pair(size_t(procid()),
+                                    coll_serialize(data[procid()])));
+    recursive_doubling(blocks, coll_block_append());
+    for (size_t i = 0;i < blocks.size(); ++i) {
+      if (blocks[i].first != procid()) {
+        coll_deserialize(blocks[i].second, data[blocks[i].first]);
+      }
+    }
+  }
+
+ public:
+
+  /**
+   * \brief Selects the algorithm used by broadcast(), gather(),
+   * all_gather(), all_reduce() and all_reduce2().
+   *
+   * All machines must select the same algorithm, and must not change it
+   * while a collective is in progress. Defaults to RPC_DEFAULT_COLLECTIVE.
+   */
+  void set_collective_type(dc_collective_type type) {
+    collective = type;
+  }
+
+  /// \brief Returns the algorithm used by the collective operations.
+  dc_collective_type get_collective_type() const {
+    return collective;
+  }
+
+
 /*****************************************************************************
                       Implementation of Broadcast
  *****************************************************************************/
@@ -876,6 +1148,15 @@ private:
   /// \copydoc distributed_control::broadcast()
   template <typename U>
   void broadcast(U& data, bool originator, bool control = false) {
+    if (numprocs() == 1) return;
+    if (collective == COLLECTIVE_LOG_DEPTH) {
+      log_depth_broadcast(data, originator);
+      // the tree alone lets the originator and the inner nodes return
+      // before the leaves enter. Callers rely on broadcast blocking until
+      // every machine has entered it.
+      barrier();
+      return;
+    }
     if (originator) {
       // construct the data stream
       std::stringstream strm;
@@ -935,6 +1216,13 @@ private:
   /// \copydoc distributed_control::gather()
   template <typename U>
   void gather(std::vector<U>& data, procid_t sendto, bool control = false) {
+    if (collective == COLLECTIVE_LOG_DEPTH && numprocs() > 1) {
+      log_depth_gather(data, sendto);
+      // as in broadcast, the root and inner nodes only wait for their own
+      // subtree. gather must block until every machine has entered it.
+      barrier();
+      return;
+    }
     // if not root
     if (sendto != procid()) {
       std::stringstream strm( std::ios::out | std::ios::binary );
@@ -1051,6 +1339,10 @@ private:
   template <typename U>
   void all_gather(std::vector<U>& data, bool control = false) {
     if (numprocs() == 1) return;
+    if (collective == COLLECTIVE_LOG_DEPTH) {
+      log_depth_all_gather(data);
+      return;
+    }
     // get the string representation of the data
     charstream strm(128);
     oarchive oarc(strm);
@@ -1183,6 +1475,10 @@ private:
   template <typename U, typename PlusEqual>
   void all_reduce2(U& data, PlusEqual plusequal, bool control = false) {
     if (numprocs() == 1) return;
+    if (collective == COLLECTIVE_LOG_DEPTH) {
+      recursive_doubling(data, plusequal);
+      return;
+    }
     // get the string representation of the data
    /* charstream strm(128);
     oarchive oarc(strm);
@@ -1371,7 +1667,8 @@ private:
 
 
   /**
-    The child calls this function in the parent once the child enters the barrier
+    The child calls this function in the parent once the child enters the barrier.
+    The barrier calls are inline calls: they run on the receiving thread.
   */
   void __child_to_parent_barrier_trigger(procid_t source) {
     barrier_mut.lock();
@@ -1392,7 +1689,7 @@ private:
     // get my largest child
     logger(LOG_DEBUG, "Barrier Release %d", releaseval);
     for (procid_t i = 0;i < numchild; ++i) {
-      internal_control_call((procid_t)(childbase + i),
+      internal_inline_control_call((procid_t)(childbase + i),
                             &dc_dist_object<T>::__parent_to_child_barrier_release,
                             releaseval);
 
@@ -1420,7 +1717,7 @@ private:
         // call child to parent in parent
         barrier_mut.unlock();
         if (procid() != 0) {
-          internal_control_call(parent,
+          internal_inline_control_call(parent,
                            &dc_dist_object<T>::__child_to_parent_barrier_trigger,
                            procid());
         }
@@ -1436,7 +1733,7 @@ private:
       barrier_release = barrier_val;
 
       for (procid_t i = 0;i < numchild; ++i) {
-        internal_control_call((procid_t)(childbase + i),
+        internal_inline_control_call((procid_t)(childbase + i),
                              &dc_dist_object<T>::__parent_to_child_barrier_release,
                              barrier_val);
 
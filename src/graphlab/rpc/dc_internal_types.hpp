@@ -28,6 +28,7 @@
 #include <graphlab/rpc/dc_types.hpp>
 #include <graphlab/util/resizing_array_sink.hpp>
 #include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/atomic.hpp>
 #include <graphlab/serialization/serialization_includes.hpp>
 namespace graphlab {
 class distributed_control;
@@ -67,6 +68,13 @@ typedef boost::unordered_map<std::string, dispatch_type> dispatch_map_type;
 const size_t COMM_STREAM = 1;
 const size_t COMM_DATAGRAM = 0;
 
+/**
+ * \internal
+ * The body of an INLINE_CALL packet starts with the id of the object
+ * the call is addressed to. Calls to plain functions use NO_OBJECT_ID.
+ */
+const size_t NO_OBJECT_ID = size_t(-1);
+
 /**
  * \internal
  * \ingroup rpc
@@ -80,6 +88,32 @@ struct packet_hdr {
 
 typedef uint32_t block_header_type;
 
+/**
+ * \internal
+ * \ingroup rpc
+ * The operations carried by a ONE_SIDED_PACKET */
+enum one_sided_op {
+  ONE_SIDED_GET,        /// read len bytes of a region
+  ONE_SIDED_GET_REPLY,  /// the bytes read, to be stored at dst
+  ONE_SIDED_PUT,        /// write the len bytes following the header
+  ONE_SIDED_PUT_ACK,    /// the write completed
+  ONE_SIDED_ERROR       /// the get or put was outside the registered regions
+};
+
+/**
+ * \internal
+ * \ingroup rpc
+ * The body of a ONE_SIDED_PACKET. For ONE_SIDED_PUT and
+ * ONE_SIDED_GET_REPLY it is followed by len bytes of data. */
+struct one_sided_hdr {
+  size_t op;      /// a one_sided_op
+  size_t region;  /// registered memory region on the target
+  size_t offset;  /// offset into the region
+  size_t len;     /// number of bytes to transfer
+  size_t dst;     /// destination buffer of a get on the requester
+  size_t handle;  /// reply container on the requester
+};
+
 /**
  * \internal
  * \ingroup rpc
@@ -133,13 +167,47 @@ struct terminator_token {
 
 
 
+/**
+ * \internal
+ * \ingroup rpc
+ * The shared state behind a zero_copy_buffer. Every zero_copy_buffer
+ * and every outgoing iovec pointing into ptr holds one reference.
+ * on_release is called when the last reference is dropped.
+ */
+struct zero_copy_state {
+  atomic<size_t> refcount;
+  const char* ptr;
+  size_t len;
+  boost::function<void(void)> on_release;
+
+  zero_copy_state(const char* ptr, size_t len,
+                  const boost::function<void(void)>& on_release):
+      refcount(1), ptr(ptr), len(len), on_release(on_release) { }
+
+  inline void incref() {
+    refcount.inc();
+  }
+
+  inline void decref() {
+    if (refcount.dec() == 0) {
+      if (on_release) on_release();
+      delete this;
+    }
+  }
+};
+
 /**
  * Used to maintain a linked list of buffers.
  */
 struct buffer_elem {
   char* buf;
   size_t len;
+  /// If not NULL, buf is caller owned memory released through pinned
+  zero_copy_state* pinned;
+  /// True if buf does not both begin and end on a packet boundary
+  bool partial;
   buffer_elem* next;
+  buffer_elem(): buf(NULL), len(0), pinned(NULL), partial(false), next(NULL) { }
 };
 
 }
@@ -34,6 +34,18 @@ namespace graphlab {
    */
   const unsigned char STANDARD_CALL = 1;
 
+  /**
+   * \internal
+   * \ingroup rpc
+   *
+   * The call is short and never blocks, so it is executed by the
+   * receiving thread as soon as it arrives instead of being queued
+   * for the function call handlers (see distributed_control::inline_call).
+   * The packet body leads with the id of the target object, so that a
+   * call to an object which is not yet constructed can be queued instead.
+   */
+  const unsigned char INLINE_CALL = 8;
+
   /**
    * \internal
     \ingroup rpc
@@ -43,6 +55,16 @@ namespace graphlab {
   */
   const unsigned char CONTROL_PACKET = 16; 
 
+  /**
+   * \internal
+   * \ingroup rpc
+   *
+   * One-sided memory access (see distributed_control::remote_get).
+   * These packets are serviced by the receiving thread as soon as they
+   * arrive and never reach the function call handlers.
+   */
+  const unsigned char ONE_SIDED_PACKET = 32;
+
   /**
    * \internal
    * \ingroup rpc
@@ -51,6 +73,16 @@ namespace graphlab {
    * packet, a flush is required
    */
   const unsigned char FLUSH_PACKET = 64;
+
+  /**
+   * \internal
+   * \ingroup rpc
+   *
+   * The packet body is a 32 bit uncompressed length followed by an
+   * LZ4 compressed block which decompresses to a sequence of
+   * complete packets.
+   */
+  const unsigned char COMPRESSED_PACKET = 128;
 }
 #endif
 
@@ -69,6 +69,19 @@ class dc_receive {
    * If the sender multithreads, the sending thread must shut down.
    */
   virtual void shutdown() = 0;
+
+  /**
+   * Adds the receive side block compression counters to stats.
+   */
+  virtual void get_compression_stats(dc_compression_stats& stats) const { }
+
+  /**
+   * Returns a new receiver for an additional stream from the same
+   * source, or NULL if this is not supported. Comms which keep several
+   * connections to a peer cut each of them into packets with its own
+   * receiver. The caller owns the returned object.
+   */
+  virtual dc_receive* create_stream_receiver() { return NULL; }
 };
 
 
@@ -81,6 +81,11 @@ class dc_send{
     return 0;
   }
 
+  /**
+   * Adds the send side block compression counters to stats.
+   */
+  virtual void get_compression_stats(dc_compression_stats& stats) const { }
+
   /**
    * Returns length if there is data, 0 otherwise. This function
    * must be reentrant, but it is guaranteed that only one thread will
@@ -88,6 +93,44 @@ class dc_send{
    */
   virtual size_t get_outgoing_data(circular_iovec_buffer& outdata) = 0;
 
+  /**
+   * Striped version of get_outgoing_data() used by comms which keep
+   * several streams to the target (see the "streams" option of
+   * dc_buffered_stream_send2). Moves the data destined for the given
+   * stream into outdata and holds back the data of the other streams
+   * until they ask for it. Blocks which carry calls with a
+   * sequentialization key are always sent on stream 0.
+   * Only one thread calls this function for a given stream at any time.
+   */
+  virtual size_t get_outgoing_data(circular_iovec_buffer& outdata,
+                                   size_t stream) {
+    return stream == 0 ? get_outgoing_data(outdata) : 0;
+  }
+
+  /**
+   * Returns true if data is being held back for the given stream.
+   */
+  virtual bool has_outgoing_data(size_t stream) {
+    return false;
+  }
+
+  /**
+   * Utility function: returns the first non-zero sequentialization key
+   * of the packets in a block of complete packets, or 0 if there is none.
+   */
+  inline static unsigned char block_sequentialization_key(const char* data,
+                                                         size_t len) {
+    while (len >= sizeof(packet_hdr)) {
+      const packet_hdr* hdr = reinterpret_cast<const packet_hdr*>(data);
+      if (hdr->sequentialization_key != 0) return hdr->sequentialization_key;
+      size_t packetlen = sizeof(packet_hdr) + hdr->len;
+      if (packetlen > len) break;
+      data += packetlen;
+      len -= packetlen;
+    }
+    return 0;
+  }
+
 
   /**
    * Utility function: writes a packet header into an archive.
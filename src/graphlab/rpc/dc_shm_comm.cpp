@@ -0,0 +1,426 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <netdb.h>
+#include <cstring>
+#include <cerrno>
+#include <sstream>
+#include <iomanip>
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <time.h>
+#endif
+
+#include <boost/bind.hpp>
+#include <boost/functional/hash.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/util/stl_util.hpp>
+#include <graphlab/rpc/dc_shm_comm.hpp>
+#include <graphlab/rpc/dc_send.hpp>
+#include <graphlab/rpc/get_current_process_hash.hpp>
+
+namespace graphlab {
+  namespace dc_impl {
+
+    namespace {
+      /**
+       * The sender given to the TCP comm for processes reached through
+       * shared memory. It never has outgoing data.
+       */
+      class null_send: public dc_send {
+       public:
+        void register_send_buffer(thread_local_buffer* buffer) { }
+        void unregister_send_buffer(thread_local_buffer* buffer) { }
+        size_t bytes_sent() { return 0; }
+        void flush() { }
+        void flush_soon() { }
+        void write_to_buffer(char* c, size_t len) {
+          ASSERT_MSG(false, "Unexpected write to a shared memory channel");
+        }
+        size_t get_outgoing_data(circular_iovec_buffer& outdata) { return 0; }
+      };
+
+      // number of empty polls before the receive thread goes to sleep
+      const size_t RECEIVE_SPIN_COUNT = 4096;
+      // the longest the receive thread sleeps without being woken up
+      const size_t RECEIVE_SLEEP_NS = 10 * 1000 * 1000;
+    } // end of anonymous namespace
+
+
+    dc_shm_comm::dc_shm_comm():
+      mybell(NULL), is_closed(true), done(false) { }
+
+    dc_shm_comm::~dc_shm_comm() {
+      close();
+      for (size_t i = 0;i < tcp_sender.size(); ++i) {
+        if (tcp_sender[i] != sender[i]) delete tcp_sender[i];
+      }
+    }
+
+
+    std::string dc_shm_comm::segment_name(procid_t src, procid_t dest) const {
+      return segment_prefix + "_" + tostr(src) + "_" + tostr(dest);
+    }
+
+    void* dc_shm_comm::create_segment(const std::string& name, size_t len) {
+      // remove any stale segment left behind by a crashed process
+      shm_unlink(name.c_str());
+      int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+      if (fd < 0) {
+        logstream(LOG_FATAL) << "Unable to create shared memory segment "
+                             << name << ": " << strerror(errno) << std::endl;
+      }
+      if (ftruncate(fd, len) != 0) {
+        logstream(LOG_FATAL) << "Unable to size shared memory segment "
+                             << name << ": " << strerror(errno) << std::endl;
+      }
+      void* ptr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      ::close(fd);
+      if (ptr == MAP_FAILED) {
+        logstream(LOG_FATAL) << "Unable to map shared memory segment "
+                             << name << ": " << strerror(errno) << std::endl;
+      }
+      created_segments.push_back(name);
+      return ptr;
+    }
+
+    void* dc_shm_comm::open_segment(const std::string& name, size_t len) {
+      int fd = shm_open(name.c_str(), O_RDWR, 0600);
+      if (fd < 0) {
+        logstream(LOG_FATAL) << "Unable to open shared memory segment "
+                             << name << ": " << strerror(errno) << std::endl;
+      }
+      void* ptr = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+      ::close(fd);
+      if (ptr == MAP_FAILED) {
+        logstream(LOG_FATAL) << "Unable to map shared memory segment "
+                             << name << ": " << strerror(errno) << std::endl;
+      }
+      return ptr;
+    }
+
+
+    void dc_shm_comm::init(const std::vector<std::string> &machines,
+                           const std::map<std::string,std::string> &initopts,
+                           procid_t curmachineid,
+                           std::vector<dc_receive*> receiver_,
+                           std::vector<dc_send*> sender_) {
+      const procid_t nprocs = (procid_t)(machines.size());
+      receiver = receiver_;
+      sender = sender_;
+      channels.resize(nprocs);
+      for (size_t i = 0;i < nprocs; ++i) {
+        channels[i].out = NULL;
+        channels[i].in = NULL;
+        channels[i].bell = NULL;
+        channels[i].triggered.value = false;
+      }
+
+      // find the processes on this host
+      std::vector<uint32_t> addrs(nprocs);
+      for (size_t i = 0;i < nprocs; ++i) {
+        std::string address = machines[i].substr(0, machines[i].find(":"));
+        struct hostent* ent = gethostbyname(address.c_str());
+        ASSERT_TRUE(ent != NULL);
+        ASSERT_EQ(ent->h_length, 4);
+        addrs[i] = *reinterpret_cast<uint32_t*>(ent->h_addr_list[0]);
+      }
+      for (procid_t i = 0;i < nprocs; ++i) {
+        if (addrs[i] == addrs[curmachineid]) local_procs.push_back(i);
+      }
+
+      // all processes of this job agree on the segment names
+      std::string key = get_current_process_hash();
+      for (size_t i = 0;i < machines.size(); ++i) key += machines[i];
+      std::stringstream strm;
+      strm << "/graphlab_" << std::hex << boost::hash<std::string>()(key);
+      segment_prefix = strm.str();
+
+      // create the incoming rings and the doorbell before connecting. A
+      // peer only connects once it has done the same, so once tcp.init()
+      // returns, the segments of all peers exist.
+      mybell = (shm_doorbell*)create_segment(segment_prefix + "_" +
+                                             tostr(curmachineid) + "_bell",
+                                             sizeof(shm_doorbell));
+      mybell->seq = 0;
+      mybell->waiting = 0;
+      for (size_t i = 0;i < local_procs.size(); ++i) {
+        procid_t src = local_procs[i];
+        shm_ring* ring = (shm_ring*)create_segment(segment_name(src, curmachineid),
+                                                   sizeof(shm_ring));
+        ring->head = 0;
+        ring->tail = 0;
+        channels[src].in = ring;
+      }
+
+      tcp_sender = sender;
+      for (size_t i = 0;i < local_procs.size(); ++i) {
+        tcp_sender[local_procs[i]] = new null_send;
+      }
+      tcp.init(machines, initopts, curmachineid, receiver, tcp_sender);
+
+      for (size_t i = 0;i < local_procs.size(); ++i) {
+        procid_t dest = local_procs[i];
+        channels[dest].out = (shm_ring*)open_segment(segment_name(curmachineid, dest),
+                                                     sizeof(shm_ring));
+        channels[dest].bell = (shm_doorbell*)open_segment(segment_prefix + "_" +
+                                                          tostr(dest) + "_bell",
+                                                          sizeof(shm_doorbell));
+      }
+      logstream(LOG_INFO) << "Proc " << curmachineid << " uses shared memory for "
+                          << local_procs.size() << " of " << nprocs
+                          << " processes" << std::endl;
+
+      shm_bytessent = 0;
+      shm_bytesreceived = 0;
+      shm_buffered_len = 0;
+      done = false;
+      // next to the TCP threads, which use the last 2 cores
+      receivethread.launch(boost::bind(&dc_shm_comm::receive_loop, this),
+                           thread::cpu_count() - 2);
+      sendthread.launch(boost::bind(&dc_shm_comm::send_loop, this),
+                        thread::cpu_count() - 1);
+      is_closed = false;
+    }
+
+
+    void dc_shm_comm::close() {
+      if (is_closed) return;
+      logstream(LOG_INFO) << "Closing shared memory channels" << std::endl;
+      // flush everything still queued for local peers
+      for (size_t i = 0;i < local_procs.size(); ++i) {
+        while(process_channel(local_procs[i])) usleep(100);
+      }
+      done = true;
+      send_lock.lock();
+      send_cond.signal();
+      send_lock.unlock();
+      sendthread.join();
+      ring_doorbell(mybell);
+      receivethread.join();
+
+      tcp.close();
+
+      for (size_t i = 0;i < channels.size(); ++i) {
+        if (channels[i].out) munmap(channels[i].out, sizeof(shm_ring));
+        if (channels[i].in) munmap(channels[i].in, sizeof(shm_ring));
+        if (channels[i].bell) munmap(channels[i].bell, sizeof(shm_doorbell));
+        channels[i].out = channels[i].in = NULL;
+        channels[i].bell = NULL;
+      }
+      munmap(mybell, sizeof(shm_doorbell));
+      mybell = NULL;
+      for (size_t i = 0;i < created_segments.size(); ++i) {
+        shm_unlink(created_segments[i].c_str());
+      }
+      created_segments.clear();
+      is_closed = true;
+    }
+
+
+    void dc_shm_comm::trigger_send_timeout(procid_t target, bool urgent) {
+      if (!is_local(target)) {
+        tcp.trigger_send_timeout(target, urgent);
+      } else if (urgent) {
+        process_channel(target);
+      } else if (!channels[target].triggered.exchange(true)) {
+        send_lock.lock();
+        send_cond.signal();
+        send_lock.unlock();
+      }
+    }
+
+
+    size_t dc_shm_comm::write_ring(shm_ring* ring, circular_iovec_buffer& outvec) {
+      const size_t head = ring->head;
+      size_t space = SHM_RING_SIZE - (head - ring->tail);
+      size_t written = 0;
+      struct msghdr data;
+      while (space > 0 && !outvec.empty()) {
+        outvec.fill_msghdr(data);
+        size_t batch = 0;
+        for (size_t i = 0;i < (size_t)data.msg_iovlen && space > 0; ++i) {
+          const char* src = (const char*)data.msg_iov[i].iov_base;
+          size_t len = std::min(space, (size_t)data.msg_iov[i].iov_len);
+          space -= len;
+          batch += len;
+          while (len > 0) {
+            const size_t pos = (head + written) & (SHM_RING_SIZE - 1);
+            const size_t n = std::min(len, SHM_RING_SIZE - pos);
+            memcpy(ring->data + pos, src, n);
+            src += n; len -= n; written += n;
+          }
+        }
+        if (batch == 0) break;
+        outvec.sent(batch);
+      }
+      // publish the data only once it has been copied
+      __sync_synchronize();
+      ring->head = head + written;
+      return written;
+    }
+
+
+    bool dc_shm_comm::process_channel(procid_t target) {
+      channel& chan = channels[target];
+      if (!chan.m.try_lock()) return false;
+      // cleared before looking for data, so a later trigger is not lost
+      chan.triggered.exchange(false);
+      shm_buffered_len.inc(sender[target]->get_outgoing_data(chan.outvec));
+      if (!chan.outvec.empty()) {
+        size_t written = write_ring(chan.out, chan.outvec);
+        if (written > 0) {
+          shm_bytessent.inc(written);
+          ring_doorbell(chan.bell);
+        }
+      }
+      bool pending = !chan.outvec.empty();
+      chan.m.unlock();
+      return pending;
+    }
+
+
+    size_t dc_shm_comm::read_ring(procid_t source) {
+      shm_ring* ring = channels[source].in;
+      size_t tail = ring->tail;
+      const size_t head = ring->head;
+      // do not read the data before the head which publishes it
+      __sync_synchronize();
+      if (head == tail) return 0;
+      dc_receive* rcv = receiver[source];
+      size_t buflength;
+      char* c = rcv->get_buffer(buflength);
+      size_t total = 0;
+      while (tail != head) {
+        const size_t pos = tail & (SHM_RING_SIZE - 1);
+        const size_t n = std::min(std::min(head - tail, SHM_RING_SIZE - pos),
+                                  buflength);
+        memcpy(c, ring->data + pos, n);
+        tail += n; total += n;
+        c = rcv->advance_buffer(c, n, buflength);
+      }
+      // release the space only once it has been copied out
+      __sync_synchronize();
+      ring->tail = tail;
+      shm_bytesreceived.inc(total);
+      return total;
+    }
+
+
+    void dc_shm_comm::ring_doorbell(shm_doorbell* bell) {
+      __sync_synchronize();
+      if (bell->waiting) {
+        __sync_fetch_and_add(&bell->seq, 1);
+#ifdef __linux__
+        syscall(SYS_futex, &bell->seq, FUTEX_WAKE, 1, NULL, NULL, 0);
+#endif
+      }
+    }
+
+
+    void dc_shm_comm::wait_doorbell() {
+      const int seq = mybell->seq;
+      mybell->waiting = 1;
+      __sync_synchronize();
+      // a sender may have written before it could see the waiting flag
+      for (size_t i = 0;i < local_procs.size(); ++i) {
+        shm_ring* ring = channels[local_procs[i]].in;
+        if (ring->head != ring->tail) {
+          mybell->waiting = 0;
+          return;
+        }
+      }
+      if (!done) {
+#ifdef __linux__
+        struct timespec timeout = {0, RECEIVE_SLEEP_NS};
+        syscall(SYS_futex, &mybell->seq, FUTEX_WAIT, seq, &timeout, NULL, 0);
+#else
+        usleep(RECEIVE_SLEEP_NS / 1000 / 100);
+#endif
+      }
+      mybell->waiting = 0;
+    }
+
+
+////////////////////////////////////////////////////////////////////////////
+//       These stuff run in seperate threads                              //
+////////////////////////////////////////////////////////////////////////////
+
+    void dc_shm_comm::send_loop() {
+      logstream(LOG_INFO) << "Shared memory send loop Started" << std::endl;
+      while (!done) {
+        bool pending = false;
+        for (size_t i = 0;i < local_procs.size(); ++i) {
+          pending |= process_channel(local_procs[i]);
+        }
+        if (pending) {
+          // a ring is full. Wait for the receiver to drain it.
+          sched_yield();
+          continue;
+        }
+        // sampling the senders takes their locks, so not under send_lock
+        size_t timeout = send_poll_timeout();
+        send_lock.lock();
+        bool triggered = false;
+        for (size_t i = 0;i < local_procs.size(); ++i) {
+          triggered |= channels[local_procs[i]].triggered.value;
+        }
+        if (!triggered && !done) {
+          send_cond.timedwait_ns(send_lock, timeout * 1000);
+        }
+        send_lock.unlock();
+      }
+      logstream(LOG_INFO) << "Shared memory send loop Stopped" << std::endl;
+    }
+
+
+    void dc_shm_comm::receive_loop() {
+      logstream(LOG_INFO) << "Shared memory receive loop Started" << std::endl;
+      size_t idle = 0;
+      while (!done) {
+        size_t received = 0;
+        for (size_t i = 0;i < local_procs.size(); ++i) {
+          received += read_ring(local_procs[i]);
+        }
+        if (received > 0) {
+          idle = 0;
+        } else if (++idle < RECEIVE_SPIN_COUNT) {
+          cpu_relax();
+        } else {
+          wait_doorbell();
+          idle = 0;
+        }
+      }
+      // drain what is left
+      for (size_t i = 0;i < local_procs.size(); ++i) read_ring(local_procs[i]);
+      logstream(LOG_INFO) << "Shared memory receive loop Stopped" << std::endl;
+    }
+
+  }; // end of namespace dc_impl
+}; // end of namespace graphlab
@@ -0,0 +1,194 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef DC_SHM_COMM_HPP
+#define DC_SHM_COMM_HPP
+
+#include <vector>
+#include <string>
+#include <map>
+
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/atomic.hpp>
+#include <graphlab/rpc/dc_types.hpp>
+#include <graphlab/rpc/dc_internal_types.hpp>
+#include <graphlab/rpc/dc_comm_base.hpp>
+#include <graphlab/rpc/dc_tcp_comm.hpp>
+#include <graphlab/rpc/circular_iovec_buffer.hpp>
+
+namespace graphlab {
+namespace dc_impl {
+
+/**
+ \ingroup rpc
+ \internal
+Shared memory implementation of the communications subsystem.
+
+Processes on the same host exchange data through single producer, single
+consumer ring buffers in POSIX shared memory, one ring for every ordered
+pair of processes. Each process has one send thread, which copies
+outgoing data into the rings of its peers, and one receive thread, which
+drains its incoming rings into the receivers. An idle receive thread
+sleeps on a futex in shared memory which senders wake up.
+
+Processes on other hosts are reached through a dc_tcp_comm, which also
+establishes the connections to all processes at startup and so acts as
+the barrier after which all the shared memory segments exist. Two
+processes are on the same host if their addresses in the machines list
+resolve to the same IP address.
+*/
+class dc_shm_comm:public dc_comm_base {
+ public:
+
+  dc_shm_comm();
+
+  size_t capabilities() const {
+    return COMM_STREAM;
+  }
+
+  /**
+   Sets up the shared memory rings to the processes on this host and the
+   TCP connections to all processes. Parameters are as in dc_tcp_comm.
+  */
+  void init(const std::vector<std::string> &machines,
+            const std::map<std::string,std::string> &initopts,
+            procid_t curmachineid,
+            std::vector<dc_receive*> receiver,
+            std::vector<dc_send*> senders);
+
+  /** shuts down all rings and sockets and cleans up */
+  void close();
+
+  ~dc_shm_comm();
+
+  inline procid_t numprocs() const {
+    return tcp.numprocs();
+  }
+
+  inline procid_t procid() const {
+    return tcp.procid();
+  }
+
+  /// Returns true if data to target goes through shared memory
+  inline bool is_local(procid_t target) const {
+    return channels[target].out != NULL;
+  }
+
+  /**
+   * Returns the total number of bytes sent, through shared memory or TCP
+   */
+  inline size_t network_bytes_sent() const {
+    return tcp.network_bytes_sent() + shm_bytessent.value;
+  }
+
+  /**
+   * Returns the total number of bytes received, through shared memory or TCP
+   */
+  inline size_t network_bytes_received() const {
+    return tcp.network_bytes_received() + shm_bytesreceived.value;
+  }
+
+  inline size_t send_queue_length() const {
+    size_t a = shm_bytessent.value;
+    size_t b = shm_buffered_len.value;
+    return tcp.send_queue_length() + (b - a);
+  }
+
+  void trigger_send_timeout(procid_t target, bool urgent);
+
+ private:
+  /// The ring buffer in shared memory. head and tail count bytes.
+  struct shm_ring {
+    volatile size_t head;   /// bytes written. Only changed by the sender
+    char pad0[64 - sizeof(size_t)];
+    volatile size_t tail;   /// bytes read. Only changed by the receiver
+    char pad1[64 - sizeof(size_t)];
+    char data[SHM_RING_SIZE];
+  };
+
+  /// Wakes up the receive thread of a process. Also in shared memory.
+  struct shm_doorbell {
+    volatile int seq;       /// futex word, changed on every wakeup
+    volatile int waiting;   /// set while the receive thread sleeps
+  };
+
+  struct channel {
+    shm_ring* out;          /// ring to the peer, NULL if the peer is remote
+    shm_ring* in;           /// ring from the peer
+    shm_doorbell* bell;     /// the doorbell of the peer
+    mutex m;                /// held while filling the outgoing ring
+    circular_iovec_buffer outvec;  /// outgoing data not yet in the ring
+    /// set by senders which want the send thread to look at this channel
+    atomic<bool> triggered;
+  };
+
+  /// reached in a single process as well as through TCP
+  dc_tcp_comm tcp;
+  /// the senders handed to tcp. Local peers get a sender with no data.
+  std::vector<dc_send*> tcp_sender;
+
+  std::vector<dc_receive*> receiver;
+  std::vector<dc_send*> sender;
+  std::vector<channel> channels;
+  std::vector<procid_t> local_procs;
+
+  /// the doorbell of this process
+  shm_doorbell* mybell;
+  /// the shared memory segments created by this process
+  std::vector<std::string> created_segments;
+  std::string segment_prefix;
+
+  atomic<size_t> shm_bytessent;
+  atomic<size_t> shm_bytesreceived;
+  atomic<size_t> shm_buffered_len;
+  bool is_closed;
+  volatile bool done;
+
+  mutex send_lock;
+  conditional send_cond;
+  thread sendthread;
+  thread receivethread;
+
+  std::string segment_name(procid_t src, procid_t dest) const;
+  void* create_segment(const std::string& name, size_t len);
+  void* open_segment(const std::string& name, size_t len);
+
+  /// moves outgoing data of a local peer into its ring.
+  /// Returns true if data is left over because the ring is full.
+  bool process_channel(procid_t target);
+  /// copies as much of outvec as fits into the ring
+  size_t write_ring(shm_ring* ring, circular_iovec_buffer& outvec);
+  /// drains the ring from source into its receiver. Returns the bytes read
+  size_t read_ring(procid_t source);
+
+  void ring_doorbell(shm_doorbell* bell);
+  void wait_doorbell();
+
+  void send_loop();
+  void receive_loop();
+};
+
+} // namespace dc_impl
+} // namespace graphlab
+#endif
@@ -27,6 +27,7 @@
 #include <graphlab/rpc/dc.hpp>
 #include <graphlab/rpc/dc_internal_types.hpp>
 #include <graphlab/rpc/dc_stream_receive.hpp>
+#include <graphlab/util/lz4_block.hpp>
 
 //#define DC_RECEIVE_DEBUG
 namespace graphlab {
@@ -40,17 +41,84 @@ char* dc_stream_receive::get_buffer(size_t& retbuflength) {
 }
 
 
+void dc_stream_receive::get_compression_stats(dc_compression_stats& stats) const {
+  stats.blocks_decompressed += blocks_decompressed.value;
+  stats.bytes_received_compressed += bytes_received_compressed.value;
+  stats.bytes_decompressed += bytes_decompressed.value;
+}
+
+
+dc_receive* dc_stream_receive::create_stream_receiver() {
+  return new dc_stream_receive(dc, associated_proc, counters);
+}
+
+
+void dc_stream_receive::decompress_chunk(char*& chunk, size_t& chunklen) {
+  // first pass: size of the decompressed chunk
+  size_t outlen = 0;
+  size_t offset = 0;
+  while (offset < chunklen) {
+    packet_hdr* hdr = reinterpret_cast<packet_hdr*>(chunk + offset);
+    if (hdr->packet_type_mask & COMPRESSED_PACKET) {
+      if (hdr->len < sizeof(uint32_t)) {
+        logstream(LOG_FATAL) << "Malformed compressed packet from "
+                             << associated_proc << std::endl;
+      }
+      uint32_t rawlen;
+      memcpy(&rawlen, chunk + offset + sizeof(packet_hdr), sizeof(uint32_t));
+      outlen += rawlen;
+    } else {
+      outlen += sizeof(packet_hdr) + hdr->len;
+    }
+    offset += sizeof(packet_hdr) + hdr->len;
+  }
+  // second pass: copy or decompress each packet
+  char* out = (char*)malloc(outlen);
+  size_t outoff = 0;
+  offset = 0;
+  while (offset < chunklen) {
+    packet_hdr* hdr = reinterpret_cast<packet_hdr*>(chunk + offset);
+    const char* body = chunk + offset + sizeof(packet_hdr);
+    if (hdr->packet_type_mask & COMPRESSED_PACKET) {
+      uint32_t rawlen;
+      memcpy(&rawlen, body, sizeof(uint32_t));
+      if (!lz4::decompress(body + sizeof(uint32_t), hdr->len - sizeof(uint32_t),
+                           out + outoff, rawlen)) {
+        logstream(LOG_FATAL) << "Corrupt compressed packet from "
+                             << associated_proc << std::endl;
+      }
+      counters->blocks_decompressed.inc();
+      counters->bytes_received_compressed.inc(sizeof(packet_hdr) + hdr->len);
+      counters->bytes_decompressed.inc(rawlen);
+      outoff += rawlen;
+    } else {
+      memcpy(out + outoff, hdr, sizeof(packet_hdr) + hdr->len);
+      outoff += sizeof(packet_hdr) + hdr->len;
+    }
+    offset += sizeof(packet_hdr) + hdr->len;
+  }
+  free(chunk);
+  chunk = out;
+  chunklen = outlen;
+}
+
+
 char* dc_stream_receive::advance_buffer(char* c, size_t wrotelength, 
                             size_t& retbuflength) {
   // find the last complete message we have read
   write_buffer_written += wrotelength;
   if (write_buffer_written >= sizeof(packet_hdr)) {
     size_t offset = 0;
+    bool has_compressed_packets = false;
+    bool has_receive_thread_packets = false;
     packet_hdr* hdr = reinterpret_cast<packet_hdr*>(writebuffer);
     // keep pushing the header until I reach a point where there is insufficient
     // room to read a header, or the message is not large enough
     while(offset + sizeof(packet_hdr) <= write_buffer_written &&
           offset + hdr->len + sizeof(packet_hdr) <= write_buffer_written) {
+      has_compressed_packets |= (hdr->packet_type_mask & COMPRESSED_PACKET) != 0;
+      has_receive_thread_packets |=
+          (hdr->packet_type_mask & (ONE_SIDED_PACKET | INLINE_CALL)) != 0;
       offset += hdr->len + sizeof(packet_hdr);
       hdr = reinterpret_cast<packet_hdr*>(writebuffer + offset);
     }
@@ -73,7 +141,22 @@ char* dc_stream_receive::advance_buffer(char* c, size_t wrotelength,
       }
       // if we reach here, we have an available block
       // give away the buffer to dc
-      dc->deferred_function_call_chunk(writebuffer, offset, associated_proc);
+      char* chunk = writebuffer;
+      size_t chunklen = offset;
+      if (has_compressed_packets) {
+        decompress_chunk(chunk, chunklen);
+        // the compressed packets may have contained some
+        has_receive_thread_packets = true;
+      }
+      // one-sided operations and inline calls are serviced right here
+      if (has_receive_thread_packets) {
+        dc->process_receive_thread_packets(chunk, chunklen);
+      }
+      if (chunklen > 0) {
+        dc->deferred_function_call_chunk(chunk, chunklen, associated_proc);
+      } else {
+        free(chunk);
+      }
       writebuffer = new_writebuffer;
       write_buffer_written -= offset;
       write_buffer_len = new_buflen;
@@ -50,13 +50,23 @@ namespace dc_impl {
 class dc_stream_receive: public dc_receive{
  public:
   
-  dc_stream_receive(distributed_control* dc, procid_t associated_proc): 
+  /**
+   * Receivers created by create_stream_receiver() count their
+   * decompressed blocks in the counters of counter_owner.
+   */
+  dc_stream_receive(distributed_control* dc, procid_t associated_proc,
+                    dc_stream_receive* counter_owner = NULL): 
                   writebuffer(NULL), write_buffer_written(0), dc(dc), 
-                  associated_proc(associated_proc) { 
+                  associated_proc(associated_proc),
+                  counters(counter_owner ? counter_owner : this) { 
     writebuffer = (char*)malloc(RECEIVE_BUFFER_SIZE);
     write_buffer_len = RECEIVE_BUFFER_SIZE;
   }
 
+  void get_compression_stats(dc_compression_stats& stats) const;
+
+  dc_receive* create_stream_receiver();
+
  private:
 
   char* writebuffer;
@@ -67,9 +77,22 @@ class dc_stream_receive: public dc_receive{
   distributed_control* dc;
 
   procid_t associated_proc;
-  
+
+  dc_stream_receive* counters;
+
+  atomic<size_t> blocks_decompressed;
+  atomic<size_t> bytes_received_compressed;
+  atomic<size_t> bytes_decompressed;
+
   void shutdown();
 
+  /**
+   * Replaces a chunk of complete packets containing COMPRESSED_PACKETs
+   * with a newly allocated chunk in which they are decompressed.
+   * The original chunk is freed.
+   */
+  void decompress_chunk(char*& chunk, size_t& chunklen);
+
   
   char* get_buffer(size_t& retbuflength);
   
@@ -70,17 +70,35 @@ namespace graphlab {
       nprocs = (procid_t)(machines.size());
       receiver = receiver_;
       sender = sender_;
+      streams_per_peer = get_count_option(initopts, "sockets_per_peer", 1);
+      num_loops = get_count_option(initopts, "comm_threads", streams_per_peer);
+      if (streams_per_peer > 1) {
+        for (size_t i = 0;i < sender.size(); ++i) {
+          sender[i]->set_option("streams", streams_per_peer);
+        }
+      }
 
       // insert machines into the address map
       all_addrs.resize(nprocs);
       portnums.resize(nprocs);
-      assert(triggered_timeouts.size() >= nprocs);
-      triggered_timeouts.clear();
       // fill all the socks
-      sock.resize(nprocs);
-      for (size_t i = 0;i < nprocs; ++i) {
-        sock[i].id = i;
+      sock.resize(nprocs * streams_per_peer);
+      for (size_t i = 0;i < sock.size(); ++i) {
+        sock[i].id = i / streams_per_peer;
+        sock[i].stream = i % streams_per_peer;
+        // the connections to a machine are spread across the loops
+        sock[i].loop = (sock[i].id + sock[i].stream) % num_loops;
         sock[i].owner = this;
+        if (sock[i].stream == 0) {
+          sock[i].receiver = receiver[sock[i].id];
+        } else {
+          sock[i].receiver = receiver[sock[i].id]->create_stream_receiver();
+          if (sock[i].receiver == NULL) {
+            logstream(LOG_FATAL) << "Receiver does not support "
+                                 << "multiple sockets per peer" << std::endl;
+          }
+          stream_receivers.push_back(sock[i].receiver);
+        }
         sock[i].outsock = -1;
         sock[i].insock = -1;
         sock[i].inevent = NULL;
@@ -137,7 +155,7 @@ namespace graphlab {
         // wait for p - 1 incoming connections
         insock_lock.lock();
         while(1) {
-          if (num_in_connected() == sock.size() - 1) break;
+          if (num_in_connected() == sock.size() - streams_per_peer) break;
           insock_cond.wait(insock_lock);
         }
         insock_lock.unlock();
@@ -173,42 +191,79 @@ namespace graphlab {
       // everyone is connected.
       // Construct the eventbase
       construct_events();
-      // we reserve the last 2 cores for communication
-      inthreads.launch(boost::bind(&dc_tcp_comm::receive_loop, this, inevbase), thread::cpu_count() - 2);
-      outthreads.launch(boost::bind(&dc_tcp_comm::send_loop, this, outevbase), thread::cpu_count() - 1);
+      // we reserve the last 2 * num_loops cores for communication
+      for (size_t i = 0;i < num_loops; ++i) {
+        inthreads.launch(boost::bind(&dc_tcp_comm::receive_loop, this, inevbase[i]),
+                         event_loop_cpu(2 * i + 1));
+        outthreads.launch(boost::bind(&dc_tcp_comm::send_loop, this, outevbase[i]),
+                          event_loop_cpu(2 * i));
+      }
       is_closed = false;
     }
 
+    size_t dc_tcp_comm::get_count_option(
+        const std::map<std::string,std::string> &initopts,
+        const std::string& key, size_t defval) {
+      std::map<std::string, std::string>::const_iterator iter =
+        initopts.find(key);
+      if (iter == initopts.end()) return defval;
+      int val = atoi(iter->second.c_str());
+      if (val <= 0) {
+        logstream(LOG_FATAL) << "Option " << key << " must be a positive "
+                             << "integer. Got " << iter->second << std::endl;
+      }
+      return val;
+    }
+
+    size_t dc_tcp_comm::event_loop_cpu(size_t idx) const {
+      size_t ncpus = thread::cpu_count();
+      return ncpus - 1 - (idx % ncpus);
+    }
+
     void dc_tcp_comm::construct_events() {
       int ret = evthread_use_pthreads();
       if (ret < 0) logstream(LOG_FATAL) << "Unable to initialize libevent with pthread support!" << std::endl;
       // number of evs to create.
-      outevbase = event_base_new();
-      if (!outevbase) logstream(LOG_FATAL) << "Unable to construct libevent base" << std::endl;
-      send_all_timeout.owner = this;
-      send_all_timeout.send_all = true;
-      send_triggered_timeout.owner = this;
-      send_triggered_timeout.send_all = false;
-      send_all_event = event_new(outevbase, -1, EV_TIMEOUT | EV_PERSIST, on_send_event, &(send_all_timeout));
-      assert(send_all_event != NULL);
-      struct timeval t = {SEND_POLL_TIMEOUT / 1000000, SEND_POLL_TIMEOUT %  1000000} ;
-      event_add(send_all_event, &t);
-      send_triggered_event = event_new(outevbase, -1, EV_TIMEOUT | EV_PERSIST, on_send_event, &(send_triggered_timeout));
-      assert(send_triggered_event != NULL);
-
-      inevbase = event_base_new();
-      if (!inevbase) logstream(LOG_FATAL) << "Unable to construct libevent base" << std::endl;
+      outevbase.resize(num_loops);
+      inevbase.resize(num_loops);
+      send_all_event.resize(num_loops);
+      send_triggered_event.resize(num_loops);
+      // the events keep pointers into these
+      send_all_timeout.resize(num_loops);
+      send_triggered_timeout.resize(num_loops);
+      triggered_timeouts.resize(num_loops);
+      for (size_t i = 0;i < num_loops; ++i) {
+        outevbase[i] = event_base_new();
+        if (!outevbase[i]) logstream(LOG_FATAL) << "Unable to construct libevent base" << std::endl;
+        send_all_timeout[i].owner = this;
+        send_all_timeout[i].send_all = true;
+        send_all_timeout[i].loop = i;
+        send_triggered_timeout[i].owner = this;
+        send_triggered_timeout[i].send_all = false;
+        send_triggered_timeout[i].loop = i;
+        triggered_timeouts[i].resize(sock.size());
+        triggered_timeouts[i].clear();
+        send_all_event[i] = event_new(outevbase[i], -1, EV_TIMEOUT | EV_PERSIST, on_send_event, &(send_all_timeout[i]));
+        assert(send_all_event[i] != NULL);
+        send_all_timeout[i].poll_timeout = send_poll_timeout();
+        schedule_send_all(i);
+        send_triggered_event[i] = event_new(outevbase[i], -1, EV_TIMEOUT | EV_PERSIST, on_send_event, &(send_triggered_timeout[i]));
+        assert(send_triggered_event[i] != NULL);
+
+        inevbase[i] = event_base_new();
+        if (!inevbase[i]) logstream(LOG_FATAL) << "Unable to construct libevent base" << std::endl;
+      }
 
 
       //register all event objects
       for (size_t i = 0;i < sock.size(); ++i) {
-        sock[i].inevent = event_new(inevbase, sock[i].insock, EV_READ | EV_PERSIST | EV_ET,
+        sock[i].inevent = event_new(inevbase[sock[i].loop], sock[i].insock, EV_READ | EV_PERSIST | EV_ET,
                                      on_receive_event, &(sock[i]));
         if (sock[i].inevent == NULL) {
           logstream(LOG_FATAL) << "Unable to register socket read event" << std::endl;
         }
 
-        sock[i].outevent = event_new(outevbase, sock[i].outsock, EV_WRITE | EV_PERSIST | EV_ET,
+        sock[i].outevent = event_new(outevbase[sock[i].loop], sock[i].outsock, EV_WRITE | EV_PERSIST | EV_ET,
                                      on_send_event, &(sock[i]));
         if (sock[i].outevent == NULL) {
           logstream(LOG_FATAL) << "Unable to register socket write event" << std::endl;
@@ -228,16 +283,30 @@ namespace graphlab {
       return connected;
     }
 
+    void dc_tcp_comm::trigger_socket(size_t sockid) {
+      socket_info& sockinfo = sock[sockid];
+      if (sockinfo.wouldblock == false &&
+          triggered_timeouts[sockinfo.loop].get(sockid) == false) {
+        triggered_timeouts[sockinfo.loop].set_bit(sockid);
+        event_active(send_triggered_event[sockinfo.loop], EV_TIMEOUT, 1);
+      }
+    }
+
+    void dc_tcp_comm::schedule_send_all(size_t loop) {
+      size_t timeout = send_all_timeout[loop].poll_timeout;
+      struct timeval t = {long(timeout / 1000000), long(timeout % 1000000)};
+      event_add(send_all_event[loop], &t);
+    }
+
     void dc_tcp_comm::trigger_send_timeout(procid_t target, bool urgent) {
+      size_t first = target * streams_per_peer;
       if (!urgent) {
-        if (sock[target].wouldblock == false &&
-            triggered_timeouts.get(target) == false) {
-          triggered_timeouts.set_bit(target);
-          event_active(send_triggered_event, EV_TIMEOUT, 1);
-        }
+        for (size_t i = 0;i < streams_per_peer; ++i) trigger_socket(first + i);
       }
       else {
-        process_sock(&(sock[target]));
+        for (size_t i = 0;i < streams_per_peer; ++i) {
+          process_sock(&(sock[first + i]));
+        }
       }
     }
 
@@ -253,15 +322,32 @@ namespace graphlab {
       // shutdown the listening thread
       listenthread.join();
 
-      // clear the outevent loop
-      event_base_loopbreak(outevbase);
+      // clear the outevent loops
+      for (size_t i = 0;i < num_loops; ++i) event_base_loopbreak(outevbase[i]);
       outthreads.join();
+      // a flush may have been handed to a send loop that stopped before
+      // getting to it. Send whatever is left. Extracting for one stream
+      // may hold back data for the other streams, so repeat until there
+      // is nothing left.
+      bool sent_something = true;
+      while (sent_something) {
+        sent_something = false;
+        for (size_t i = 0;i < sock.size(); ++i) {
+          check_for_new_data(sock[i]);
+          if (!sock[i].outvec.empty()) {
+            send_all(sock[i]);
+            sent_something = true;
+          }
+        }
+      }
       for (size_t i = 0;i < sock.size(); ++i) {
         event_free(sock[i].outevent);
       }
-      event_free(send_triggered_event);
-      event_free(send_all_event);
-      event_base_free(outevbase);
+      for (size_t i = 0;i < num_loops; ++i) {
+        event_free(send_triggered_event[i]);
+        event_free(send_all_event[i]);
+        event_base_free(outevbase[i]);
+      }
 
 
       logstream(LOG_INFO) << "Closing outgoing sockets" << std::endl;
@@ -273,13 +359,13 @@ namespace graphlab {
         }
       }
 
-      // clear the inevent loop
-      event_base_loopbreak(inevbase);
+      // clear the inevent loops
+      for (size_t i = 0;i < num_loops; ++i) event_base_loopbreak(inevbase[i]);
       inthreads.join();
       for (size_t i = 0;i < sock.size(); ++i) {
         event_free(sock[i].inevent);
       }
-      event_base_free(inevbase);
+      for (size_t i = 0;i < num_loops; ++i) event_base_free(inevbase[i]);
 
 
       logstream(LOG_INFO) << "Closing incoming sockets" << std::endl;
@@ -290,6 +376,11 @@ namespace graphlab {
           sock[i].insock = -1;
         }
       }
+      for (size_t i = 0;i < stream_receivers.size(); ++i) {
+        stream_receivers[i]->shutdown();
+        delete stream_receivers[i];
+      }
+      stream_receivers.clear();
       is_closed = true;
     }
 
@@ -323,6 +414,16 @@ namespace graphlab {
       return true;
     }
 
+    void dc_tcp_comm::send_all(socket_info& sockinfo) {
+      while (!send_till_block(sockinfo) && sockinfo.wouldblock) {
+        pollfd pf;
+        pf.fd = sockinfo.outsock;
+        pf.events = POLLOUT;
+        pf.revents = 0;
+        poll(&pf, 1, 1000);
+      }
+    }
+
     int dc_tcp_comm::sendtosock(int sockfd, const char* buf, size_t len) {
       size_t numsent = 0;
       BEGIN_TRACEPOINT(tcp_send_call);
@@ -368,7 +469,7 @@ namespace graphlab {
 
 
     void dc_tcp_comm::new_socket(int newsock, sockaddr_in* otheraddr,
-                                 procid_t id) {
+                                 procid_t id, size_t stream) {
       // figure out the address of the incoming connection
       uint32_t addr = *reinterpret_cast<uint32_t*>(&(otheraddr->sin_addr));
       // locate the incoming address in the list
@@ -376,13 +477,16 @@ namespace graphlab {
                           << inet_ntoa(otheraddr->sin_addr) << std::endl;
       ASSERT_LT(id, all_addrs.size());
       ASSERT_EQ(all_addrs[id], addr);
+      ASSERT_LT(stream, streams_per_peer);
+      size_t sockid = id * streams_per_peer + stream;
       insock_lock.lock();
-      ASSERT_EQ(sock[id].insock, -1);
-      sock[id].insock = newsock;
+      ASSERT_EQ(sock[sockid].insock, -1);
+      sock[sockid].insock = newsock;
       insock_cond.signal();
       insock_lock.unlock();
       logstream(LOG_INFO) << "Proc " << procid() << " accepted connection "
-                          << "from machine " << id << std::endl;
+                          << "from machine " << id << " stream " << stream
+                          << std::endl;
     }
 
 
@@ -416,9 +520,9 @@ namespace graphlab {
     } // end of open_listening
 
     void dc_tcp_comm::connect(size_t target) {
-      if (sock[target].outsock != -1) {
-        return;
-      } else {
+      for (size_t stream = 0;stream < streams_per_peer; ++stream) {
+        socket_info& sockinfo = sock[target * streams_per_peer + stream];
+        if (sockinfo.outsock != -1) continue;
         int newsock = socket(AF_INET, SOCK_STREAM, 0);
         set_tcp_no_delay(newsock);
         sockaddr_in serv_addr;
@@ -452,6 +556,8 @@ namespace graphlab {
             // send the initial message
             initial_message msg; 
             msg.id = curid;
+            msg.stream = stream;
+            msg.streams_per_peer = streams_per_peer;
             memcpy(msg.md5, program_md5.c_str(), 32);
             sendtosock(newsock, reinterpret_cast<char*>(&msg), sizeof(initial_message));
             set_non_blocking(newsock);
@@ -463,9 +569,9 @@ namespace graphlab {
           logstream(LOG_FATAL) << "Failed to establish connection" << std::endl;
         }
         // remember the socket
-        sock[target].outsock = newsock;
+        sockinfo.outsock = newsock;
         logstream(LOG_INFO) << "connection from " << curid << " to " << target
-                            << " established." << std::endl;
+                            << " stream " << stream << " established." << std::endl;
       }
     } // end of connect
 
@@ -534,9 +640,16 @@ namespace graphlab {
                                    << "\tProcess " << remote_message.id << " has hash "  << other_md5 << " \n "
                                    << "\tGraphLab requires all machines to run exactly the same binary." << std::endl;
             }
+            if (remote_message.streams_per_peer != streams_per_peer) {
+              logstream(LOG_FATAL) << "Process " << remote_message.id << " uses "
+                                   << remote_message.streams_per_peer
+                                   << " sockets per peer, but process " << curid
+                                   << " uses " << streams_per_peer << std::endl;
+            }
             // register the new socket
             set_non_blocking(newsock);
-            new_socket(newsock, &their_addr, remote_message.id);
+            new_socket(newsock, &their_addr, remote_message.id,
+                       remote_message.stream);
             ++numsocks_connected;
           }
         }
@@ -555,7 +668,7 @@ namespace graphlab {
       dc_tcp_comm* comm = sockinfo->owner;
       if (ev & EV_READ) {
         // get a direct pointer to my receiver
-        dc_receive* receiver = comm->receiver[sockinfo->id];
+        dc_receive* receiver = sockinfo->receiver;
 
         size_t buflength;
         char *c = receiver->get_buffer(buflength);
@@ -597,7 +710,20 @@ namespace graphlab {
 
 
     void dc_tcp_comm::check_for_new_data(dc_tcp_comm::socket_info& sockinfo) {
-      buffered_len.inc(sender[sockinfo.id]->get_outgoing_data(sockinfo.outvec));
+      dc_send* s = sender[sockinfo.id];
+      if (streams_per_peer == 1) {
+        buffered_len.inc(s->get_outgoing_data(sockinfo.outvec));
+        return;
+      }
+      buffered_len.inc(s->get_outgoing_data(sockinfo.outvec, sockinfo.stream));
+      // the sender may have extracted data for the other connections
+      // to this machine. Make sure they pick it up.
+      size_t first = sockinfo.id * streams_per_peer;
+      for (size_t i = 0;i < streams_per_peer; ++i) {
+        if (i != sockinfo.stream && s->has_outgoing_data(i)) {
+          trigger_socket(first + i);
+        }
+      }
     }
 
 
@@ -627,8 +753,9 @@ namespace graphlab {
         dc_tcp_comm* comm = te->owner;
         if (te->send_all == false) {
           // this is a triggered event
-          foreach(uint32_t i, comm->triggered_timeouts) {
-            comm->triggered_timeouts.clear_bit(i);
+          dense_bitset& triggered = comm->triggered_timeouts[te->loop];
+          foreach(uint32_t i, triggered) {
+            triggered.clear_bit(i);
             dc_tcp_comm::socket_info* sockinfo = &(comm->sock[i]);
             process_sock(sockinfo);
           }
@@ -636,7 +763,13 @@ namespace graphlab {
           // send all event
           for(uint32_t i = 0;i < comm->sock.size(); ++i) {
             dc_tcp_comm::socket_info* sockinfo = &(comm->sock[i]);
-            process_sock(sockinfo);
+            if (sockinfo->loop == te->loop) process_sock(sockinfo);
+          }
+          // follow the poll interval picked by the flush controller
+          size_t timeout = comm->send_poll_timeout();
+          if (timeout != te->poll_timeout) {
+            te->poll_timeout = timeout;
+            comm->schedule_send_all(te->loop);
           }
         }
       }
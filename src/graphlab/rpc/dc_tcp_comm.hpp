@@ -65,6 +65,8 @@ class dc_tcp_comm:public dc_comm_base {
 
   inline dc_tcp_comm() {
     is_closed = true;
+    streams_per_peer = 1;
+    num_loops = 1;
     INITIALIZE_TRACER(tcp_send_call, "dc_tcp_comm: send syscall");
   }
 
@@ -80,7 +82,10 @@ class dc_tcp_comm:public dc_comm_base {
    attached receiver
 
    machines: a vector of strings where each string is of the form [IP]:[portnumber]
-   initopts: unused
+   initopts: "sockets_per_peer" sets the number of connections to each
+             machine (default 1). Blocks are striped across them.
+             "comm_threads" sets the number of send event loops and of
+             receive event loops (default: sockets_per_peer).
    curmachineid: The ID of the current machine. machines[curmachineid] will be
                  the listening address of this machine
 
@@ -101,7 +106,7 @@ class dc_tcp_comm:public dc_comm_base {
   }
 
   inline bool channel_active(size_t target) const {
-    return (sock[target].outsock != -1);
+    return (sock[target * streams_per_peer].outsock != -1);
   }
 
   /**
@@ -156,7 +161,8 @@ class dc_tcp_comm:public dc_comm_base {
   void set_non_blocking(int fd);
 
   /// called when listener receives an incoming socket request
-  void new_socket(int newsock, sockaddr_in* otheraddr, procid_t remotemachineid);
+  void new_socket(int newsock, sockaddr_in* otheraddr, procid_t remotemachineid,
+                  size_t stream);
 
 
   /// The number of incoming connections established
@@ -168,15 +174,21 @@ class dc_tcp_comm:public dc_comm_base {
   void open_listening(int sockhandle = 0);
 
 
-  /// constructs a connection to the target machine
+  /// constructs all the connections to the target machine
   void connect(size_t target);
 
+  /// parses a positive integer option, returning defval if it is not set
+  size_t get_count_option(const std::map<std::string,std::string> &initopts,
+                          const std::string& key, size_t defval);
+
   /// wrapper around the standard send. but loops till the buffer is all sent
   int sendtosock(int sockfd, const char* buf, size_t len);
 
 
   procid_t curid;   /// if od the current processor
   procid_t nprocs;  /// number of processors
+  size_t streams_per_peer;  /// number of connections to each machine
+  size_t num_loops; /// number of send and of receive event loops
   bool is_closed;   /// whether this socket is closed
 
   std::string program_md5;  /// MD5 hash of current program
@@ -194,15 +206,22 @@ class dc_tcp_comm:public dc_comm_base {
 
   struct initial_message {
     procid_t id;
+    uint32_t stream;
+    uint32_t streams_per_peer;
     char md5[32];
   };
 
 
   /// All information about stuff regarding a particular sock
-  /// Passed to the receive handler
+  /// Passed to the receive handler.
+  /// sock[id * streams_per_peer + stream] holds connection number stream
+  /// to machine id.
   struct socket_info{
     size_t id;    /// which machine this is connected to
+    size_t stream; /// which of the connections to the machine this is
+    size_t loop;  /// which send and receive event loops service it
     dc_tcp_comm* owner; /// this object
+    dc_receive* receiver; /// cuts the incoming stream into packets
     int outsock;  /// FD of the outgoing socket
     int insock;   /// FD of the incoming socket
     struct event* inevent;  /// event object for incoming information
@@ -219,21 +238,37 @@ class dc_tcp_comm:public dc_comm_base {
 
   struct timeout_event {
     bool send_all;
+    size_t loop;
+    /// the interval the send all event is currently scheduled with
+    size_t poll_timeout;
     dc_tcp_comm* owner;
   };
 
   std::vector<socket_info> sock;
+  /// receivers for the additional streams. Owned by this object
+  std::vector<dc_receive*> stream_receivers;
 
+  /**
+   * Sends everything that is still queued for the socket, waiting for the
+   * socket to become writable when necessary. Only used on close, once
+   * the send loops have stopped.
+   */
+  void send_all(socket_info& sockinfo);
   /**
    * Sends as much of the buffer inside the sockinfo as possible
    * until the send call will block or all sends are complete.
    * Returns true when the buffer has been completely sent
    * If wouldblock returns true, the next call to send_till_block may block
    */
-  void send_all(socket_info& sockinfo);
   bool send_till_block(socket_info& sockinfo);
   void check_for_new_data(socket_info& sockinfo);
   void construct_events();
+  /// asks the send loop of a socket to process it soon
+  void trigger_socket(size_t sockid);
+  /// (re)arms the send all event of a loop with its current poll interval
+  void schedule_send_all(size_t loop);
+  /// processor the event loop with the given index is pinned to
+  size_t event_loop_cpu(size_t idx) const;
 
 
 
@@ -247,20 +282,22 @@ class dc_tcp_comm:public dc_comm_base {
 
   friend void process_sock(socket_info* sockinfo);
   friend void on_receive_event(int fd, short ev, void* arg);
-  struct event_base* inevbase;
+  std::vector<struct event_base*> inevbase;
 
 
   ////////////       Sending Sockets      //////////////////////
   thread_group outthreads;
   void send_loop(struct event_base*);
   friend void on_send_event(int fd, short ev, void* arg);
-  struct event_base* outevbase;
-  struct event* send_triggered_event;
-  struct event* send_all_event;
-  timeout_event send_triggered_timeout;
-  timeout_event send_all_timeout;
-
-  fixed_dense_bitset<256> triggered_timeouts;
+  // one entry per send loop
+  std::vector<struct event_base*> outevbase;
+  std::vector<struct event*> send_triggered_event;
+  std::vector<struct event*> send_all_event;
+  std::vector<timeout_event> send_triggered_timeout;
+  std::vector<timeout_event> send_all_timeout;
+
+  /// triggered_timeouts[i] holds the sockets loop i was asked to process
+  std::vector<dense_bitset> triggered_timeouts;
   ////////////       Listening Sockets     //////////////////////
   int listensock;
   thread listenthread;
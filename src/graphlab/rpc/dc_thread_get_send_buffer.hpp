@@ -40,6 +40,17 @@ inline void release_thread_local_buffer(procid_t target,
   p->release(target, do_not_count_bytes_sent);
 }
 
+/**
+ * \internal
+ * Sends region at the current position of arc without copying it, if arc
+ * is the acquired thread local buffer. Returns false otherwise.
+ */
+inline bool splice_thread_local_buffer(oarchive& arc, zero_copy_state* region) {
+  void* ptr = pthread_getspecific(thrlocal_send_buffer_key);
+  thread_local_buffer* p = (thread_local_buffer*)(ptr);
+  return p != NULL && p->splice(arc, region);
+}
+
 /**
  * \internal
  * Writes a sequence of bytes to the local send buffer
@@ -36,7 +36,45 @@ namespace graphlab {
    */
   enum dc_comm_type {
     TCP_COMM,   ///< TCP/IP
-    SCTP_COMM   ///< SCTP (limited support)
+    SCTP_COMM,  ///< SCTP (limited support)
+    SHM_COMM    ///< Shared memory between processes on one host, TCP/IP otherwise
+  };
+
+  /**
+   * \ingroup rpc
+   * The algorithm used by the collective operations (broadcast, gather,
+   * all_gather and all_reduce).
+   */
+  enum dc_collective_type {
+    COLLECTIVE_WIDE_TREE,   ///< A tree of fan-out BARRIER_BRANCH_FACTOR rooted at machine 0
+    COLLECTIVE_LOG_DEPTH    ///< Binomial trees and recursive doubling
+  };
+
+  /**
+   * \ingroup rpc
+   * Block compression counters for the connection to one peer.
+   * See distributed_control::compression_stats().
+   */
+  struct dc_compression_stats {
+    /// Outgoing buffers sent compressed
+    size_t blocks_compressed;
+    /// Outgoing buffers above the threshold which did not compress well
+    size_t blocks_uncompressed;
+    /// Total size of the compressed outgoing buffers before compression
+    size_t bytes_before;
+    /// Total size of the compressed outgoing buffers after compression
+    size_t bytes_after;
+    /// Incoming compressed buffers
+    size_t blocks_decompressed;
+    /// Total size of the incoming compressed buffers
+    size_t bytes_received_compressed;
+    /// Total size of the incoming compressed buffers after decompression
+    size_t bytes_decompressed;
+
+    dc_compression_stats():
+        blocks_compressed(0), blocks_uncompressed(0),
+        bytes_before(0), bytes_after(0), blocks_decompressed(0),
+        bytes_received_compressed(0), bytes_decompressed(0) { }
   };
 
 
@@ -215,7 +215,7 @@ namespace graphlab {
       // broadcast a completion
       for (procid_t i = 0;i < rmi.numprocs(); ++i) {
         if (i != rmi.procid()) {
-          rmi.control_call(i,
+          rmi.inline_control_call(i,
                            &fiber_async_consensus::force_done);
         }
       }
@@ -271,7 +271,7 @@ namespace graphlab {
                           << cur_token.total_calls_received << " " 
                           << cur_token.total_calls_sent << std::endl;
 
-      rmi.control_call((procid_t)((rmi.procid() + 1) % rmi.numprocs()),
+      rmi.inline_control_call((procid_t)((rmi.procid() + 1) % rmi.numprocs()),
                        &fiber_async_consensus::receive_the_token,
                        cur_token);
     }
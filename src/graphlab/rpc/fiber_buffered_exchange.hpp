@@ -130,15 +130,23 @@ namespace graphlab {
       }
     }
 
+    /// the size at which the buffers to the given target are sent
+    inline size_t buffer_limit(procid_t proc) {
+      if (max_buffer_size > 0) return max_buffer_size;
+      return rpc.dc().flush_control().buffer_size(proc);
+    }
+
   public:
     /**
      * Constructs a buffered exchange object.
      *
      * \ref dc The master distributed_control object
      * \ref max_buffer_size The size of the per thread and per target send buffer.
+     *                      If 0, the buffers are sized by the flush controller
+     *                      of the distributed_control. See buffered_exchange.
      */
     fiber_buffered_exchange(distributed_control& dc,
-                      const size_t max_buffer_size = DEFAULT_BUFFERED_EXCHANGE_SIZE) :
+                      const size_t max_buffer_size = 0) :
       rpc(dc, this),
       max_buffer_size(max_buffer_size) {
        send_buffers.resize(fiber_control::get_instance().num_workers());
@@ -150,6 +158,10 @@ namespace graphlab {
            send_buffers[i][j].numinserts = 0;
          }
        }
+       if (max_buffer_size == 0) {
+         rpc.dc().flush_control().register_buffers(send_buffers.size() *
+                                                   dc.numprocs());
+       }
        rpc.barrier();
       }
 
@@ -161,6 +173,10 @@ namespace graphlab {
           if (send_buffers[i][j].oarc) rpc.split_call_cancel(send_buffers[i][j].oarc);
         }
       }
+      if (max_buffer_size == 0) {
+        rpc.dc().flush_control().unregister_buffers(send_buffers.size() *
+                                                    rpc.numprocs());
+      }
     }
     // fiber_buffered_exchange(distributed_control& dc, handler_type recv_handler,
     //                   size_t buffer_size = 1000) :
@@ -185,7 +201,7 @@ namespace graphlab {
       ++send_buffers[wid][proc].numinserts;
 
 
-      if(send_buffers[wid][proc].oarc->off >= max_buffer_size) {
+      if(send_buffers[wid][proc].oarc->off >= buffer_limit(proc)) {
         flush_buffer(wid, proc);
       }
     } // end of send
@@ -0,0 +1,129 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <algorithm>
+#include <graphlab/rpc/flush_controller.hpp>
+
+namespace graphlab {
+namespace dc_impl {
+
+flush_controller::flush_controller(const std::vector<dc_send*>& senders,
+                                   size_t memory_budget):
+    senders(senders), budget(memory_budget), numbuffers(0),
+    last_bytes(senders.size(), 0), rate(senders.size(), 0),
+    target_size(senders.size(), DEFAULT_BUFFERED_EXCHANGE_SIZE),
+    poll_timeout(SEND_POLL_TIMEOUT), last_sample(0) {
+  ti.start();
+}
+
+void flush_controller::register_buffers(size_t n) {
+  numbuffers.inc(n);
+  lock.lock();
+  rebalance();
+  lock.unlock();
+}
+
+void flush_controller::unregister_buffers(size_t n) {
+  numbuffers.dec(n);
+  lock.lock();
+  rebalance();
+  lock.unlock();
+}
+
+size_t flush_controller::send_poll_timeout() {
+  if (ti.current_time() - last_sample >= RPC_FLUSH_SAMPLE_INTERVAL * 1E-6 &&
+      lock.try_lock()) {
+    sample();
+    lock.unlock();
+  }
+  return poll_timeout;
+}
+
+void flush_controller::sample() {
+  double now = ti.current_time();
+  double elapsed = now - last_sample;
+  if (elapsed < RPC_FLUSH_SAMPLE_INTERVAL * 1E-6) return;
+  last_sample = now;
+
+  double maxrate = 0;
+  for (size_t i = 0;i < senders.size(); ++i) {
+    size_t bytes = senders[i]->bytes_sent();
+    double current = double(bytes - last_bytes[i]) / elapsed;
+    last_bytes[i] = bytes;
+    // exponentially weighted so a single idle interval does not
+    // throw away what we know about the link
+    rate[i] = 0.5 * rate[i] + 0.5 * current;
+    maxrate = std::max(maxrate, rate[i]);
+  }
+
+  double timeout = SEND_POLL_TIMEOUT;
+  if (maxrate > 0) timeout = 1E6 * FULL_BUFFER_SIZE_LIMIT / maxrate;
+  timeout = std::max(timeout, double(MIN_SEND_POLL_TIMEOUT));
+  timeout = std::min(timeout, double(SEND_POLL_TIMEOUT));
+  poll_timeout = size_t(timeout);
+  rebalance();
+}
+
+void flush_controller::rebalance() {
+  size_t nbuffers = std::max<size_t>(size_t(numbuffers.value), 1);
+  double fair_share = double(budget) / nbuffers;
+  double totalrate = 0;
+  for (size_t i = 0;i < rate.size(); ++i) totalrate += rate[i];
+
+  for (size_t i = 0;i < rate.size(); ++i) {
+    double share = fair_share;
+    // half of the budget is split evenly, the other half by traffic
+    if (totalrate > 0) {
+      share *= 0.5 + 0.5 * rate.size() * rate[i] / totalrate;
+    }
+    double wanted = std::max(rate[i] * SEND_POLL_TIMEOUT * 1E-6,
+                             double(DEFAULT_BUFFERED_EXCHANGE_SIZE));
+    double size = std::min(share, wanted);
+    size = std::max(size, double(MIN_EXCHANGE_BUFFER_SIZE));
+    size = std::min(size, double(MAX_EXCHANGE_BUFFER_SIZE));
+    target_size[i] = size_t(size);
+  }
+}
+
+double flush_controller::mean_buffer_size_kb() const {
+  if (target_size.empty()) return 0;
+  double total = 0;
+  for (size_t i = 0;i < target_size.size(); ++i) total += target_size[i];
+  return total / target_size.size() / 1024;
+}
+
+double flush_controller::buffer_memory_mb() const {
+  if (target_size.empty()) return 0;
+  // buffers are registered for every target, so each target
+  // has numbuffers / numprocs of them
+  double total = 0;
+  for (size_t i = 0;i < target_size.size(); ++i) total += target_size[i];
+  return total * numbuffers.value / target_size.size() / (1024 * 1024);
+}
+
+double flush_controller::send_poll_timeout_ms() const {
+  return poll_timeout / 1000.0;
+}
+
+} // namespace dc_impl
+} // namespace graphlab
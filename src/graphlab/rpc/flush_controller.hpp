@@ -0,0 +1,118 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_DC_FLUSH_CONTROLLER_HPP
+#define GRAPHLAB_DC_FLUSH_CONTROLLER_HPP
+#include <vector>
+#include <graphlab/rpc/dc_types.hpp>
+#include <graphlab/rpc/dc_send.hpp>
+#include <graphlab/rpc/dc_compile_parameters.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/atomic.hpp>
+#include <graphlab/util/timer.hpp>
+
+namespace graphlab {
+namespace dc_impl {
+
+/**
+ * \ingroup rpc
+ * \internal
+ * Picks the size of the buffered_exchange send buffers and the poll
+ * interval of the send threads from the measured throughput to each
+ * peer and a global memory budget.
+ *
+ * Every adaptively sized exchange registers its (thread, target)
+ * buffers. Each buffer gets an equal share of the memory budget,
+ * scaled up for peers which carry more than their share of the traffic.
+ * Within that share, a buffer is sized to hold what its peer receives
+ * in one SEND_POLL_TIMEOUT, but never less than
+ * DEFAULT_BUFFERED_EXCHANGE_SIZE.
+ *
+ * The poll interval is the time it takes the busiest peer to fill
+ * FULL_BUFFER_SIZE_LIMIT bytes, clamped to
+ * [MIN_SEND_POLL_TIMEOUT, SEND_POLL_TIMEOUT].
+ *
+ * Throughput is sampled by the send threads when they ask for the poll
+ * interval, at most once every RPC_FLUSH_SAMPLE_INTERVAL.
+ */
+class flush_controller {
+ public:
+  flush_controller(const std::vector<dc_send*>& senders,
+                   size_t memory_budget);
+
+  /// Adds numbuffers exchange buffers to the ones sharing the budget
+  void register_buffers(size_t numbuffers);
+
+  /// Removes numbuffers exchange buffers
+  void unregister_buffers(size_t numbuffers);
+
+  /// The current size of an exchange buffer to the given target
+  inline size_t buffer_size(procid_t target) const {
+    return target_size[target];
+  }
+
+  /**
+   * The current poll interval of the send threads in microseconds.
+   * Also takes a throughput sample if one is due.
+   */
+  size_t send_poll_timeout();
+
+  /// The measured throughput to the given target in bytes per second
+  inline double throughput(procid_t target) const {
+    return rate[target];
+  }
+
+  inline size_t memory_budget() const {
+    return budget;
+  }
+
+  /// Mean exchange buffer size over all targets in KB
+  double mean_buffer_size_kb() const;
+
+  /// Upper bound on the memory held by the registered buffers in MB
+  double buffer_memory_mb() const;
+
+  /// The current poll interval in milliseconds
+  double send_poll_timeout_ms() const;
+
+ private:
+  std::vector<dc_send*> senders;
+  size_t budget;
+  atomic<size_t> numbuffers;
+
+  std::vector<size_t> last_bytes;
+  std::vector<double> rate;
+  std::vector<size_t> target_size;
+  size_t poll_timeout;
+
+  timer ti;
+  double last_sample;
+  mutex lock;
+
+  void sample();
+  void rebalance();
+};
+
+} // namespace dc_impl
+} // namespace graphlab
+#endif
@@ -91,7 +91,7 @@ void OBJECT_NONINTRUSIVE_REQUESTDISPATCH1 (DcType & dc, procid_t source,
     dc.get_rmi_instance (objid)->inc_bytes_sent (source, retstrm->len);
   }
   if (packet_type_mask & CONTROL_PACKET) {
-    dc.control_call (source, request_reply_handler, id,
+    dc.reply_control_call (source, request_reply_handler, id,
 		     blob (retstrm->str, retstrm->len));
   }
   else {
@@ -144,7 +144,7 @@ void OBJECT_NONINTRUSIVE_REQUESTDISPATCH1 (DcType & dc, procid_t source,
     }                                                                   \
     /*std::cerr << "Request wait on " << id << std::endl ; */           \
     if (packet_type_mask & CONTROL_PACKET) {                            \
-      dc.control_call(source,                                           \
+      dc.reply_control_call(source,                                     \
                       request_reply_handler,                          \
                       id,                                               \
                       blob(retstrm->str, retstrm->len));                \
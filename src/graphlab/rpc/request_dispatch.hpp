@@ -83,7 +83,7 @@ void REQUESTDISPATCH1 (DcType & dc, procid_t source,
   oarc << ret;
   retstrm.flush ();
   if (packet_type_mask & CONTROL_PACKET) {
-    dc.control_call (source, request_reply_handler, id,
+    dc.reply_control_call (source, request_reply_handler, id,
 		     blob (retstrm->str, retstrm->len));
   }
   else {
@@ -125,7 +125,7 @@ void BOOST_PP_CAT(REQUESTDISPATCH,N) (DcType& dc, procid_t source, unsigned char
   oarc << ret; \
   retstrm.flush(); \
   if (packet_type_mask & CONTROL_PACKET) { \
-    dc.control_call(source, request_reply_handler, id, blob(retstrm->str, retstrm->len));\
+    dc.reply_control_call(source, request_reply_handler, id, blob(retstrm->str, retstrm->len));\
   } \
   else {  \
     dc.reply_remote_call(source, request_reply_handler, id, blob(retstrm->str, retstrm->len));\
@@ -166,7 +166,7 @@ void BOOST_PP_CAT(NONINTRUSIVE_REQUESTDISPATCH,N) (DcType& dc, procid_t source,
   oarc << ret; \
   retstrm.flush(); \
   if (packet_type_mask & CONTROL_PACKET) { \
-    dc.control_call(source, request_reply_handler, id, blob(retstrm->str, retstrm->len));\
+    dc.reply_control_call(source, request_reply_handler, id, blob(retstrm->str, retstrm->len));\
   } \
   else if(packet_type_mask & FLUSH_PACKET) {  \
     dc.reply_remote_call(source, request_reply_handler, id, blob(retstrm->str, retstrm->len));\
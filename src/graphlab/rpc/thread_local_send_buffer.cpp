@@ -50,7 +50,15 @@ void thread_local_buffer::push_flush() {
     if (bufs.first != NULL) {
       while(bufs.first != bufs.second) {
         buffer_elem* prev = bufs.first;
-        dc->write_to_buffer(i, bufs.first->buf, bufs.second->len);
+        if (bufs.first->pinned != NULL) {
+          // the slow path only takes ownership of malloc'ed buffers
+          char* copy = (char*)malloc(bufs.first->len);
+          memcpy(copy, bufs.first->buf, bufs.first->len);
+          bufs.first->pinned->decref();
+          dc->write_to_buffer(i, copy, bufs.first->len);
+        } else {
+          dc->write_to_buffer(i, bufs.first->buf, bufs.first->len);
+        }
         buffer_elem** next = &bufs.first->next;
         volatile buffer_elem** n = (volatile buffer_elem**)(next);
         while(__unlikely__((*n) == NULL)) {
@@ -101,18 +109,93 @@ void thread_local_buffer::add_to_queue(procid_t target, char* ptr, size_t len) {
   ASSERT_NE(ptr, NULL);
   elem->buf = ptr;
   elem->len = len;
-  elem->next = NULL;
   outbuf[target]->enqueue(elem);
   if (outbuf[target]->approx_size() > NUM_FULL_BUFFER_LIMIT) {
     pull_flush_soon(target);
   }
 }
 
+bool thread_local_buffer::splice(oarchive& arc, zero_copy_state* region) {
+  if (current_archive.empty() || &arc < &current_archive[0] ||
+      &arc >= &current_archive[0] + current_archive.size()) {
+    return false;
+  }
+  region->incref();
+  pending_splices.push_back(std::make_pair(arc.off, region));
+  return true;
+}
+
+
+void thread_local_buffer::queue_splices(procid_t target) {
+  oarchive& arc = current_archive[target];
+  // Build every piece before queueing any of them: once the archive
+  // buffer is queued, the sender may free it at any time.
+  std::vector<buffer_elem*> elems;
+  size_t prevoff = 0;
+  for (size_t i = 0;i < pending_splices.size(); ++i) {
+    size_t off = pending_splices[i].first;
+    zero_copy_state* region = pending_splices[i].second;
+    // the archive up to the region. The packet header always precedes the
+    // first region, so the first piece is the archive buffer itself
+    // and later pieces are copied out of it.
+    if (off > prevoff) {
+      buffer_elem* elem = new buffer_elem;
+      if (prevoff == 0) {
+        elem->buf = arc.buf;
+      } else {
+        elem->buf = (char*)malloc(off - prevoff);
+        memcpy(elem->buf, arc.buf + prevoff, off - prevoff);
+      }
+      elem->len = off - prevoff;
+      elem->partial = true;
+      elems.push_back(elem);
+    }
+    buffer_elem* elem = new buffer_elem;
+    elem->buf = const_cast<char*>(region->ptr);
+    elem->len = region->len;
+    elem->pinned = region;
+    elem->partial = true;
+    elems.push_back(elem);
+    prevoff = off;
+  }
+  ASSERT_GT(pending_splices[0].first, 0);
+  // the rest of the packet. It must not stay in the current archive:
+  // extract() only takes that when it gets the lock, and the sender would
+  // move on to other threads with this packet unfinished.
+  if (arc.off > prevoff) {
+    buffer_elem* elem = new buffer_elem;
+    elem->buf = (char*)malloc(arc.off - prevoff);
+    memcpy(elem->buf, arc.buf + prevoff, arc.off - prevoff);
+    elem->len = arc.off - prevoff;
+    elem->partial = true;
+    elems.push_back(elem);
+  }
+  arc.buf = NULL;
+  arc.off = 0;
+  arc.len = 0;
+  for (size_t i = 0;i + 1 < elems.size(); ++i) elems[i]->next = elems[i + 1];
+  outbuf[target]->enqueue(elems.front(), elems.back(), elems.size());
+  pending_splices.clear();
+}
+
+
 void thread_local_buffer::release(procid_t target, bool do_not_count_bytes_sent) {
+  size_t spliced_len = 0;
+  for (size_t i = 0;i < pending_splices.size(); ++i) {
+    spliced_len += pending_splices[i].second->len;
+  }
+  if (spliced_len > 0) {
+    // the packet length written by the caller only covers the archive
+    packet_hdr* hdr = reinterpret_cast<packet_hdr*>(current_archive[target].buf +
+                                                    prev_acquire_archive_size);
+    hdr->len += spliced_len;
+  }
   if (!do_not_count_bytes_sent) {
-    bytes_sent[target] += current_archive[target].off - prev_acquire_archive_size - sizeof(packet_hdr);
+    bytes_sent[target] += current_archive[target].off - prev_acquire_archive_size
+                          - sizeof(packet_hdr) + spliced_len;
     inc_calls_sent(target);
   }
+  if (!pending_splices.empty()) queue_splices(target);
 
   if (current_archive[target].off >= FULL_BUFFER_SIZE_LIMIT) {
     // shift the buffer into outbuf
@@ -156,19 +239,18 @@ std::pair<buffer_elem*, buffer_elem*> thread_local_buffer::extract(procid_t targ
     if (archive_locks[target].try_lock()) {
       char* ptr = current_archive[target].buf;
       size_t len = current_archive[target].off;
-      if (len > 0) {
-        current_archive[target].buf = NULL;
-        current_archive[target].off = 0;
-      }
-      archive_locks[target].unlock();
       if (len > 0) {
         buffer_elem* elem = new buffer_elem;
         ASSERT_NE(ptr, NULL);
         elem->buf = ptr;
         elem->len = len;
-        elem->next = NULL;
+        // queue before unlocking so that this buffer stays ahead of
+        // anything the owning thread queues next
         outbuf[target]->enqueue(elem);
+        current_archive[target].buf = NULL;
+        current_archive[target].off = 0;
       }
+      archive_locks[target].unlock();
     } 
   } 
   std::pair<buffer_elem*, buffer_elem*> ret;
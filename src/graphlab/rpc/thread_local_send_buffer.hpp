@@ -19,6 +19,9 @@ struct thread_local_buffer {
   std::vector<mutex> archive_locks;
   std::vector<oarchive> current_archive;
   size_t prev_acquire_archive_size;
+  // zero copy regions to insert into the acquired archive on release,
+  // as (archive offset, region) pairs
+  std::vector<std::pair<size_t, zero_copy_state*> > pending_splices;
 
   procid_t procid;
   distributed_control* dc;
@@ -43,6 +46,15 @@ struct thread_local_buffer {
 
   void write(procid_t target, char* c, size_t len, bool do_not_count_bytes_sent);
 
+  /**
+   * Must be called from within the thread owning this buffer, between
+   * acquire() and release(). If arc is an acquired archive, arranges for
+   * the region to be sent at the current archive position as its own
+   * iovec, takes a reference on it and returns true. Otherwise returns
+   * false and the caller should write the bytes itself.
+   */
+  bool splice(oarchive& arc, zero_copy_state* region);
+
   /**
    * Must be called from within the thread owning this buffer.
    * Flushes the buffer to the sender. This should really only be used
@@ -92,6 +104,15 @@ struct thread_local_buffer {
   void inc_calls_sent(procid_t target);
 
   void add_to_queue(procid_t target, char* ptr, size_t len);
+
+ private:
+  /**
+   * Cuts the acquired archive at the pending splice points and queues
+   * the pieces together with the zero copy regions and the rest of the
+   * packet, all at once so that the sender cannot put anything from
+   * another thread in between. The current archive is left empty.
+   */
+  void queue_splices(procid_t target);
 };
 }
 }
@@ -0,0 +1,143 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_RPC_ZERO_COPY_BUFFER_HPP
+#define GRAPHLAB_RPC_ZERO_COPY_BUFFER_HPP
+#include <cstdlib>
+#include <boost/function.hpp>
+#include <boost/bind.hpp>
+#include <graphlab/serialization/serialization_includes.hpp>
+#include <graphlab/rpc/dc_internal_types.hpp>
+#include <graphlab/rpc/dc_compile_parameters.hpp>
+#include <graphlab/rpc/dc_thread_get_send_buffer.hpp>
+
+namespace graphlab {
+
+/**
+ * \ingroup rpc
+ * \brief A reference counted handle to a caller owned block of memory
+ * which is sent by RPC calls without being copied.
+ *
+ * Ordinarily every RPC argument is serialized into a send buffer which
+ * is later written to the socket. When a zero_copy_buffer of at least
+ * RPC_ZERO_COPY_THRESHOLD bytes is passed as an argument to
+ * remote_call() or remote_request(), only its length is serialized and
+ * the memory itself is handed to the socket as a separate iovec.
+ * The memory must therefore not be modified until the on_release
+ * callback given to the constructor is called, which happens once the
+ * last copy of the handle is destroyed and every send of it has
+ * completed.
+ *
+ * \code
+ * std::vector<double>* centers = new std::vector<double>(...);
+ * graphlab::zero_copy_buffer buf(&(*centers)[0],
+ *                                centers->size() * sizeof(double),
+ *                                boost::bind(delete_vector, centers));
+ * for (procid_t p = 0; p < dc.numprocs(); ++p) {
+ *   dc.remote_call(p, set_centers, buf);
+ * }
+ * \endcode
+ *
+ * On the receiving side, the handle points directly into the receive
+ * buffer and is only valid for the duration of the call. The data must
+ * be copied if it is needed after the function returns.
+ *
+ * Smaller buffers, broadcasts and serialization into any other archive
+ * copy the bytes as usual. The wire format is the same in either case.
+ */
+class zero_copy_buffer {
+ public:
+  /// Constructs an empty buffer
+  zero_copy_buffer(): state(NULL) { }
+
+  /**
+   * Wraps len bytes at ptr. on_release is called when the memory is no
+   * longer referenced.
+   */
+  zero_copy_buffer(const void* ptr, size_t len,
+                   boost::function<void(void)> on_release =
+                      boost::function<void(void)>()):
+      state(new dc_impl::zero_copy_state(reinterpret_cast<const char*>(ptr),
+                                         len, on_release)) { }
+
+  zero_copy_buffer(const zero_copy_buffer& other): state(other.state) {
+    if (state) state->incref();
+  }
+
+  zero_copy_buffer& operator=(const zero_copy_buffer& other) {
+    if (other.state) other.state->incref();
+    if (state) state->decref();
+    state = other.state;
+    return *this;
+  }
+
+  ~zero_copy_buffer() {
+    if (state) state->decref();
+  }
+
+  /// Returns a pointer to the data
+  const char* data() const {
+    return state ? state->ptr : NULL;
+  }
+
+  /// Returns the length of the data in bytes
+  size_t size() const {
+    return state ? state->len : 0;
+  }
+
+  void save(oarchive& oarc) const {
+    size_t len = size();
+    oarc << len;
+    if (len == 0) return;
+    if (len < RPC_ZERO_COPY_THRESHOLD ||
+        !dc_impl::splice_thread_local_buffer(oarc, state)) {
+      oarc.write(state->ptr, len);
+    }
+  }
+
+  void load(iarchive& iarc) {
+    size_t len;
+    iarc >> len;
+    if (state) state->decref();
+    state = NULL;
+    if (len == 0) return;
+    if (iarc.buf != NULL) {
+      // point into the receive buffer
+      state = new dc_impl::zero_copy_state(iarc.buf + iarc.off, len,
+                                           boost::function<void(void)>());
+      iarc.off += len;
+    } else {
+      char* copy = (char*)malloc(len);
+      iarc.read(copy, len);
+      state = new dc_impl::zero_copy_state(copy, len,
+                                           boost::bind(free, copy));
+    }
+  }
+
+ private:
+  dc_impl::zero_copy_state* state;
+};
+
+} // namespace graphlab
+#endif
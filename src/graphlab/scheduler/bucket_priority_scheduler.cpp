@@ -0,0 +1,232 @@
+/*  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <cmath>
+#include <limits>
+#include <graphlab/scheduler/bucket_priority_scheduler.hpp>
+#include <graphlab/parallel/fiber_control.hpp>
+
+#include <graphlab/macros_def.hpp>
+namespace graphlab {
+
+void bucket_priority_scheduler::set_options(const graphlab_options& opts) {
+  ncpus = opts.get_ncpus();
+  std::vector<std::string> keys = opts.get_scheduler_args().get_option_keys();
+  foreach(std::string opt, keys) {
+    if (opt == "delta") {
+      opts.get_scheduler_args().get_option("delta", delta);
+    } else if (opt == "buckets") {
+      opts.get_scheduler_args().get_option("buckets", nbuckets);
+    }  else {
+      logstream(LOG_FATAL) << "Unexpected Scheduler Option: " << opt << std::endl;
+    }
+  }
+  if (!(delta > 0)) {
+    logstream(LOG_FATAL) << "delta must be positive" << std::endl;
+  }
+  if (nbuckets == 0) {
+    logstream(LOG_FATAL) << "There must be at least one bucket" << std::endl;
+  }
+}
+
+// Initializes the internal datastructures
+void bucket_priority_scheduler::initialize_data_structures() {
+  nlists = std::max(ncpus, size_t(1));
+  buckets.resize(nbuckets * nlists);
+  local.resize(nlists);
+  next.resize(num_vertices);
+  vertex_is_scheduled.resize(num_vertices);
+}
+
+bucket_priority_scheduler::bucket_priority_scheduler(size_t num_vertices,
+                                                     const graphlab_options& opts):
+    min_bucket(std::numeric_limits<int64_t>::max()),
+    delta(1.0), nbuckets(64), num_vertices(num_vertices) {
+  ASSERT_GE(opts.get_ncpus(), 1);
+  set_options(opts);
+  initialize_data_structures();
+}
+
+
+void bucket_priority_scheduler::set_num_vertices(const lvid_type numv) {
+  num_vertices = numv;
+  next.resize(numv);
+  vertex_is_scheduled.resize(numv);
+}
+
+int64_t bucket_priority_scheduler::bucket_of(double priority) const {
+  // higher priorities go first, and so get lower bucket numbers
+  const double limit = double(int64_t(1) << 62);
+  double b = std::floor(-priority / delta);
+  if (b != b) return 0;
+  return int64_t(std::max(-limit, std::min(b, limit)));
+}
+
+bool bucket_priority_scheduler::take_list(sub_list& list,
+                                          std::vector<lvid_type>& out) {
+  if (list.head == lvid_type(-1)) return false;
+  lvid_type vid = __sync_lock_test_and_set(&list.head, lvid_type(-1));
+  if (vid == lvid_type(-1)) return false;
+  while (vid != lvid_type(-1)) {
+    out.push_back(vid);
+    vid = next[vid];
+  }
+  return true;
+}
+
+bool bucket_priority_scheduler::take_bucket(int64_t b, size_t first,
+                                            std::vector<lvid_type>& out) {
+  const size_t slot = bucket_slot(b);
+  for (size_t j = 0; j < nlists; ++j) {
+    if (take_list(buckets[slot * nlists + (first + j) % nlists], out)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void bucket_priority_scheduler::advance_min_bucket(local_buffer& buf,
+                                                   int64_t low) {
+  // remember my own move, so that a later drop back to low is noticed
+  if (atomic_compare_and_swap(min_bucket, low, buf.cursor)) {
+    buf.seen_min = buf.cursor;
+  }
+}
+
+void bucket_priority_scheduler::schedule(const lvid_type vid, double priority) {
+  if (vid < num_vertices && !vertex_is_scheduled.set_bit(vid)) {
+    int64_t b = bucket_of(priority);
+    // a higher priority than all the work so far moves the minimum bucket
+    int64_t cur = min_bucket;
+    while (b < cur && !atomic_compare_and_swap(min_bucket, cur, b)) {
+      cur = min_bucket;
+    }
+    cur = min_bucket;
+    if (b < cur) b = cur;
+    else if (b - cur >= int64_t(nbuckets)) b = cur + nbuckets - 1;
+    // workers keep what they schedule, other threads spread it out
+    size_t worker = fiber_control::get_worker_id();
+    size_t l = (worker != (size_t)(-1)) ? worker % nlists :
+        random::fast_uniform(size_t(0), nlists - 1);
+    sub_list& list = buckets[bucket_slot(b) * nlists + l];
+    lvid_type head;
+    do {
+      head = list.head;
+      next[vid] = head;
+    } while (!atomic_compare_and_swap(list.head, head, vid));
+  }
+}
+
+/** Get the next element in the queue */
+sched_status::status_enum 
+bucket_priority_scheduler::get_next(const size_t cpuid, lvid_type& ret_vid) {
+  const size_t mylist = cpuid % nlists;
+  local_buffer& buf = local[mylist];
+  buf.lock.lock();
+  while (1) {
+    while (!buf.vids.empty()) {
+      ret_vid = buf.vids.back();
+      buf.vids.pop_back();
+      if (ret_vid < num_vertices && vertex_is_scheduled.clear_bit(ret_vid)) {
+        buf.lock.unlock();
+        return sched_status::NEW_TASK;
+      }
+    }
+    const int64_t low = min_bucket;
+    if (low == std::numeric_limits<int64_t>::max()) break;
+    // restart from the minimum if higher priority work was scheduled
+    // since I last looked, or if the other cpus drained my bucket
+    if (low < buf.seen_min || buf.cursor < low) buf.cursor = low;
+    buf.seen_min = low;
+    // refill from my bucket, beginning with my own list
+    const int64_t cur = buf.cursor;
+    bool found = take_bucket(cur, mylist, buf.vids);
+    if (found) continue;
+    // the rest of my bucket may be in the buffers of the other cpus.
+    // Take half of one of them
+    for (size_t j = 1; j < nlists && !found; ++j) {
+      local_buffer& victim = local[(mylist + j) % nlists];
+      if (victim.vids.size() > 1 && victim.lock.try_lock()) {
+        size_t half = victim.vids.size() / 2;
+        buf.vids.insert(buf.vids.end(), victim.vids.begin(),
+                        victim.vids.begin() + half);
+        victim.vids.erase(victim.vids.begin(), victim.vids.begin() + half);
+        victim.lock.unlock();
+        found = half > 0;
+      }
+    }
+    if (found) continue;
+    // my bucket is empty. Move my cursor on to the next bucket with work
+    const int64_t end = low + int64_t(nbuckets);
+    for (int64_t b = cur + 1; b < end && !found; ++b) {
+      found = take_bucket(b, mylist, buf.vids);
+      if (found) buf.cursor = b;
+    }
+    if (found) {
+      // if I was draining the minimum bucket, all the buckets before my
+      // new cursor are empty
+      if (cur == low) advance_min_bucket(buf, low);
+      continue;
+    }
+    // the buckets between the minimum and my cursor may still have work
+    for (int64_t b = low; b < cur && !found; ++b) {
+      found = take_bucket(b, mylist, buf.vids);
+      if (found) buf.cursor = b;
+    }
+    if (!found) break;
+    if (buf.cursor > low) advance_min_bucket(buf, low);
+  }
+  // the buffers of the other cpus are only looked at when they are large,
+  // so check for stragglers before reporting that there is nothing left
+  for (size_t j = 1; j < nlists; ++j) {
+    local_buffer& victim = local[(mylist + j) % nlists];
+    if (!victim.vids.empty() && victim.lock.try_lock()) {
+      while (!victim.vids.empty()) {
+        ret_vid = victim.vids.back();
+        victim.vids.pop_back();
+        if (ret_vid < num_vertices && vertex_is_scheduled.clear_bit(ret_vid)) {
+          victim.lock.unlock();
+          buf.lock.unlock();
+          return sched_status::NEW_TASK;
+        }
+      }
+      victim.lock.unlock();
+    }
+  }
+  buf.lock.unlock();
+  return sched_status::EMPTY;
+} // end of get_next
+
+
+bool bucket_priority_scheduler::empty() {
+  for (size_t i = 0;i < buckets.size(); ++i) {
+    if (buckets[i].head != lvid_type(-1)) return false;
+  }
+  for (size_t i = 0;i < local.size(); ++i) {
+    if (!local[i].vids.empty()) return false;
+  }
+  return true;
+}
+
+}
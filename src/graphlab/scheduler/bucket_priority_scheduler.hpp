@@ -0,0 +1,159 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#ifndef GRAPHLAB_BUCKET_PRIORITY_SCHEDULER_HPP
+#define GRAPHLAB_BUCKET_PRIORITY_SCHEDULER_HPP
+
+#include <vector>
+#include <limits>
+
+#include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+
+#include <graphlab/util/random.hpp>
+#include <graphlab/scheduler/ischeduler.hpp>
+#include <graphlab/util/dense_bitset.hpp>
+
+#include <graphlab/options/graphlab_options.hpp>
+
+namespace graphlab {
+
+  /**
+   * \ingroup group_schedulers
+   *
+   * An approximate priority scheduler based on delta-stepping
+   * (U. Meyer, P. Sanders. Delta-stepping: a parallelizable shortest
+   * path algorithm. J. Algorithms 2003).
+   *
+   * Instead of a heap, scheduled vertices are placed in buckets of
+   * priority width "delta". The buckets form a circular array of
+   * "buckets" entries following the highest priority bucket which still
+   * has work. Priorities beyond the last bucket go into the last
+   * bucket. Vertices within a bucket run in no particular order.
+   *
+   * Every cpu keeps its own cursor, the bucket it is draining, and moves
+   * it forward on its own once that bucket is empty. The shared minimum
+   * bucket is only written when a higher priority than all the work so
+   * far is scheduled, or when the minimum bucket drains.
+   *
+   * Each bucket is split into one lock-free list per cpu. Inserting is
+   * a single compare and swap. A thread takes over a whole list at a
+   * time into a small local buffer and pops from there.
+   */
+  class bucket_priority_scheduler : public ischeduler {
+
+  private:
+    // a lock-free intrusive list of vertices. The links are in next
+    struct sub_list {
+      volatile lvid_type head;
+      char pad[64 - sizeof(lvid_type)];
+      sub_list(): head(lvid_type(-1)) { }
+    };
+
+    // the vertices a cpu has taken from the buckets
+    struct local_buffer {
+      padded_simple_spinlock lock;
+      std::vector<lvid_type> vids;
+      // the absolute number of the bucket this cpu is draining
+      int64_t cursor;
+      // the value of min_bucket the cursor was last compared with
+      int64_t seen_min;
+      char pad[64];
+      local_buffer(): cursor(std::numeric_limits<int64_t>::max()),
+                      seen_min(std::numeric_limits<int64_t>::max()) { }
+    };
+
+    // a bitset denoting if a vertex is scheduled
+    dense_bitset vertex_is_scheduled;
+    // next[v] is the vertex after v in the list v is in
+    std::vector<lvid_type> next;
+    // buckets[b * nlists + i] is the i'th list of bucket b
+    std::vector<sub_list> buckets;
+    std::vector<local_buffer> local;
+    // the absolute number of the highest priority bucket with work.
+    // The circular array holds the buckets following it
+    volatile int64_t min_bucket;
+
+    // the number of CPUs
+    size_t ncpus;
+    // the number of lists per bucket
+    size_t nlists;
+    // the width of a bucket
+    double delta;
+    // the number of buckets
+    size_t nbuckets;
+    // the number of vertices in the graph
+    size_t num_vertices;
+
+    void set_options(const graphlab_options& opts);
+
+    // Initializes the internal datastructures
+    void initialize_data_structures();
+
+    // the absolute bucket number of a priority
+    int64_t bucket_of(double priority) const;
+
+    // the position of an absolute bucket number in the circular array
+    size_t bucket_slot(int64_t b) const {
+      int64_t n = int64_t(nbuckets);
+      return size_t(((b % n) + n) % n);
+    }
+
+    // takes over the list, appending its vertices to the buffer
+    bool take_list(sub_list& list, std::vector<lvid_type>& out);
+
+    // takes over one of the lists of bucket b, beginning with list first
+    bool take_bucket(int64_t b, size_t first, std::vector<lvid_type>& out);
+
+    // moves min_bucket from low to the cursor of buf, once the buckets
+    // in between are found empty
+    void advance_min_bucket(local_buffer& buf, int64_t low);
+
+  public:
+
+    bucket_priority_scheduler(size_t num_vertices,
+                              const graphlab_options& opts);
+
+    void set_num_vertices(const lvid_type numv);
+
+    void schedule(const lvid_type vid, double priority = 1);
+
+    /** Get the next element in the queue */
+    sched_status::status_enum get_next(const size_t cpuid,
+                                       lvid_type& ret_vid);
+
+    bool empty();
+
+    static void print_options_help(std::ostream& out) {
+      out << "\t delta = [double, the priority range of a bucket. "
+          << "Default = 1]\n"
+          << "\t buckets = [number of buckets. Default = 64]\n";
+    }
+
+
+  };
+
+
+} // end of namespace graphlab
+
+#endif
+
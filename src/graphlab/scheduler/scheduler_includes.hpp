@@ -22,6 +22,7 @@
 #ifndef GRAPHLAB_SCHEDULER_INCLUDES_HPP
 #define GRAPHLAB_SCHEDULER_INCLUDES_HPP
 
+#include <graphlab/scheduler/bucket_priority_scheduler.hpp>
 #include <graphlab/scheduler/fifo_scheduler.hpp>
 #include <graphlab/scheduler/get_message_priority.hpp>
 #include <graphlab/scheduler/ischeduler.hpp>
@@ -30,4 +31,5 @@
 #include <graphlab/scheduler/scheduler_factory.hpp>
 #include <graphlab/scheduler/scheduler_list.hpp>
 #include <graphlab/scheduler/sweep_scheduler.hpp>
+#include <graphlab/scheduler/work_stealing_scheduler.hpp>
 #endif
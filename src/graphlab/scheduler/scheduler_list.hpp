@@ -43,12 +43,24 @@
     "This scheduler maintains a shared FIFO queue of FIFO queues. "     \
     "Each thread maintains its own smaller in and out queues. When a "  \
     "threads out queue is too large (greater than \"queuesize\") then " \
-    "the thread puts its out queue at the end of the master queue."))   
+    "the thread puts its out queue at the end of the master queue."))   \
+  (("work_stealing", work_stealing_scheduler,                           \
+    "Each thread owns a deque which it pushes to and pops from without "\
+    "locking. Idle threads steal from randomly chosen threads. Scales "  \
+    "well under skewed scheduling patterns, but the evaluation order "  \
+    "is mostly LIFO."))                                                \
+  (("bucket_priority", bucket_priority_scheduler,                       \
+    "Approximate priority scheduler. Vertices are kept in buckets of "  \
+    "width \"delta\" and the highest priority bucket is processed "     \
+    "first. Much cheaper than the priority scheduler, with most of "    \
+    "its convergence benefits for SSSP-like problems."))
 
 #include <graphlab/scheduler/fifo_scheduler.hpp>
 #include <graphlab/scheduler/sweep_scheduler.hpp>
 #include <graphlab/scheduler/priority_scheduler.hpp>
 #include <graphlab/scheduler/queued_fifo_scheduler.hpp>
+#include <graphlab/scheduler/work_stealing_scheduler.hpp>
+#include <graphlab/scheduler/bucket_priority_scheduler.hpp>
 
 
 namespace graphlab {
@@ -0,0 +1,146 @@
+/*  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <graphlab/scheduler/work_stealing_scheduler.hpp>
+#include <graphlab/parallel/fiber_control.hpp>
+
+#include <graphlab/macros_def.hpp>
+namespace graphlab {
+
+void work_stealing_scheduler::set_options(const graphlab_options& opts) {
+  ncpus = opts.get_ncpus();
+  std::vector<std::string> keys = opts.get_scheduler_args().get_option_keys();
+  foreach(std::string opt, keys) {
+    logstream(LOG_FATAL) << "Unexpected Scheduler Option: " << opt << std::endl;
+  }
+}
+
+// Initializes the internal datastructures
+void work_stealing_scheduler::initialize_data_structures() {
+  queues.resize(std::max(ncpus, size_t(1)));
+  for (size_t i = 0; i < queues.size(); ++i) queues[i] = new worker_queue;
+  vertex_is_scheduled.resize(num_vertices);
+}
+
+work_stealing_scheduler::work_stealing_scheduler(size_t num_vertices,
+                                                 const graphlab_options& opts):
+     num_vertices(num_vertices) { 
+  ASSERT_GE(opts.get_ncpus(), 1);
+  set_options(opts);
+  initialize_data_structures();
+}
+
+work_stealing_scheduler::~work_stealing_scheduler() {
+  for (size_t i = 0; i < queues.size(); ++i) delete queues[i];
+}
+
+
+void work_stealing_scheduler::set_num_vertices(const lvid_type numv) {
+  num_vertices = numv;
+  vertex_is_scheduled.resize(numv);
+}
+
+size_t work_stealing_scheduler::owned_queue(size_t cpuid,
+                                            bool in_get_next) const {
+  size_t worker = fiber_control::get_worker_id();
+  if (worker != (size_t)(-1)) {
+    return worker < queues.size() ? worker : queues.size();
+  }
+  return in_get_next ? cpuid % queues.size() : queues.size();
+}
+
+void work_stealing_scheduler::drain_inbox(worker_queue& q) {
+  std::vector<lvid_type> incoming;
+  q.inbox_lock.lock();
+  incoming.swap(q.inbox);
+  q.inbox_lock.unlock();
+  for (size_t i = 0; i < incoming.size(); ++i) q.deque.push_bottom(incoming[i]);
+}
+
+void work_stealing_scheduler::schedule(const lvid_type vid, double priority) {
+  if (vid < num_vertices && !vertex_is_scheduled.set_bit(vid)) {
+    size_t owned = owned_queue(0, false);
+    if (owned < queues.size()) {
+      queues[owned]->deque.push_bottom(vid);
+      return;
+    }
+    // not a worker. Pick the smaller of two random inboxes
+    size_t idx = 0;
+    if (queues.size() > 1) {
+      const size_t r1 = random::fast_uniform(size_t(0), queues.size() - 1);
+      const size_t r2 = random::fast_uniform(size_t(0), queues.size() - 1);
+      idx = (queues[r1]->inbox.size() < queues[r2]->inbox.size()) ? r1 : r2;
+    }
+    worker_queue& q = *queues[idx];
+    q.inbox_lock.lock(); q.inbox.push_back(vid); q.inbox_lock.unlock();
+  }
+}
+
+/** Get the next element in the queue */
+sched_status::status_enum work_stealing_scheduler::get_next(const size_t cpuid,
+                                                            lvid_type& ret_vid) {
+  size_t owned = owned_queue(cpuid, true);
+  // work on my own deque first
+  if (owned < queues.size()) {
+    worker_queue& q = *queues[owned];
+    if (!q.inbox.empty()) drain_inbox(q);
+    while (q.deque.pop_bottom(ret_vid)) {
+      if (claim(ret_vid)) return sched_status::NEW_TASK;
+    }
+  }
+  // steal, beginning at a random victim
+  const size_t start = random::fast_uniform(size_t(0), queues.size() - 1);
+  for (size_t i = 0; i < queues.size(); ++i) {
+    worker_queue& q = *queues[(start + i) % queues.size()];
+    // a failed steal may just have lost a race. Retry while there is work
+    while (!q.deque.empty()) {
+      if (q.deque.steal(ret_vid) && claim(ret_vid)) {
+        return sched_status::NEW_TASK;
+      }
+    }
+    if (!q.inbox.empty()) {
+      bool good = false;
+      q.inbox_lock.lock();
+      while (!q.inbox.empty()) {
+        ret_vid = q.inbox.back();
+        q.inbox.pop_back();
+        good = claim(ret_vid);
+        if (good) break;
+      }
+      q.inbox_lock.unlock();
+      if (good) return sched_status::NEW_TASK;
+    }
+  }
+  return sched_status::EMPTY;     
+} // end of get_next
+
+
+bool work_stealing_scheduler::empty() {
+  for (size_t i = 0;i < queues.size(); ++i) {
+    if (!queues[i]->deque.empty() || !queues[i]->inbox.empty()) return false;
+  }
+  return true;
+}
+
+}
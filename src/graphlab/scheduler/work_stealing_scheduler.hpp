@@ -0,0 +1,119 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+#ifndef GRAPHLAB_WORK_STEALING_SCHEDULER_HPP
+#define GRAPHLAB_WORK_STEALING_SCHEDULER_HPP
+
+#include <vector>
+
+#include <graphlab/graph/graph_basic_types.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/parallel/work_stealing_deque.hpp>
+
+#include <graphlab/util/random.hpp>
+#include <graphlab/scheduler/ischeduler.hpp>
+#include <graphlab/util/dense_bitset.hpp>
+
+#include <graphlab/options/graphlab_options.hpp>
+
+namespace graphlab {
+
+  /**
+   * \ingroup group_schedulers
+   *
+   * A work stealing scheduler. Every worker owns a Chase-Lev deque.
+   * Vertices scheduled by a worker are pushed onto its own deque and the
+   * worker pops them back in LIFO order without taking any locks. A
+   * worker which runs out of work steals from the top of a randomly
+   * chosen victim. Threads which do not own a deque (such as the RPC
+   * handler threads) place new vertices in the lock protected inbox of
+   * one of the deques, from where the owner or a thief picks them up.
+   *
+   * Inside a fiber, the deque is owned by the fiber worker the caller runs
+   * on. Outside of fibers, get_next(cpuid) treats the caller as the owner
+   * of deque cpuid, so only one thread may use each cpuid.
+   */
+  class work_stealing_scheduler : public ischeduler {
+  
+  private:
+    struct worker_queue {
+      work_stealing_deque<lvid_type> deque;
+      padded_simple_spinlock inbox_lock;
+      std::vector<lvid_type> inbox;
+    };
+
+    // a bitset denoting if a vertex is scheduled
+    dense_bitset vertex_is_scheduled;
+    // one queue per worker
+    std::vector<worker_queue*> queues;
+
+    // the number of CPUs
+    size_t ncpus;
+    // the number of vertices in the graph
+    size_t num_vertices;
+
+    void set_options(const graphlab_options& opts);
+
+    // Initializes the internal datastructures
+    void initialize_data_structures();
+
+    // the queue owned by the calling thread, or queues.size() if none
+    size_t owned_queue(size_t cpuid, bool in_get_next) const;
+
+    // moves the inbox of an owned queue into its deque
+    void drain_inbox(worker_queue& q);
+
+    // claims a popped vertex. Fails if the vertex is no longer scheduled
+    bool claim(lvid_type vid) {
+      return vid < num_vertices && vertex_is_scheduled.clear_bit(vid);
+    }
+
+  public:
+
+    work_stealing_scheduler(size_t num_vertices,
+                            const graphlab_options& opts);
+
+    ~work_stealing_scheduler();
+
+    void set_num_vertices(const lvid_type numv);
+
+    void schedule(const lvid_type vid, double priority = 1 /* ignored */ );
+
+    /** Get the next element in the queue */
+    sched_status::status_enum get_next(const size_t cpuid,
+                                       lvid_type& ret_vid);
+
+
+    bool empty();
+
+    static void print_options_help(std::ostream& out) {
+      out << "\t No options.\n";
+    }
+
+
+  }; 
+
+
+} // end of namespace graphlab
+
+#endif
+
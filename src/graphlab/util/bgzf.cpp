@@ -0,0 +1,261 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <zlib.h>
+#include <stdint.h>
+
+#include <graphlab/util/bgzf.hpp>
+#include <graphlab/util/mmap_file_range.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/logger/assertions.hpp>
+
+
+namespace graphlab {
+  namespace bgzf {
+
+    namespace {
+      // gzip magic, deflate, FEXTRA flag
+      const unsigned char MAGIC[4] = {0x1f, 0x8b, 8, 4};
+      // fixed part of the gzip header and the CRC32 + ISIZE trailer
+      const size_t HEADER_SIZE = 12;
+      const size_t TRAILER_SIZE = 8;
+      // size of the header written by compress_block(), with the
+      // single 6 byte BC extra subfield
+      const size_t BLOCK_HEADER_SIZE = 18;
+      const size_t MAX_BLOCK_SIZE = 0x10000;
+
+      inline size_t read_le16(const char* p) {
+        const unsigned char* u = reinterpret_cast<const unsigned char*>(p);
+        return size_t(u[0]) | (size_t(u[1]) << 8);
+      }
+
+      inline size_t read_le32(const char* p) {
+        return read_le16(p) | (read_le16(p + 2) << 16);
+      }
+
+      inline void write_le16(std::string& out, size_t v) {
+        out.push_back(char(v & 0xff));
+        out.push_back(char((v >> 8) & 0xff));
+      }
+
+      inline void write_le32(std::string& out, size_t v) {
+        write_le16(out, v & 0xffff);
+        write_le16(out, (v >> 16) & 0xffff);
+      }
+
+      /**
+       * Parses the header of the block at data. Returns the total size of
+       * the block, or 0 if data does not start with a BGZF header. length
+       * must be at least HEADER_SIZE.
+       */
+      size_t block_size(const char* data, size_t length) {
+        if (memcmp(data, MAGIC, 4) != 0) return 0;
+        const size_t xlen = read_le16(data + 10);
+        if (HEADER_SIZE + xlen > length) return 0;
+        // look for the BC subfield among the extra subfields
+        const char* sub = data + HEADER_SIZE;
+        const char* subend = sub + xlen;
+        while (sub + 4 <= subend) {
+          const size_t slen = read_le16(sub + 2);
+          if (sub[0] == 'B' && sub[1] == 'C' && slen == 2 &&
+              sub + 6 <= subend) {
+            return read_le16(sub + 4) + 1;
+          }
+          sub += 4 + slen;
+        }
+        return 0;
+      }
+    } // end of anonymous namespace
+
+
+    bool is_bgzf(const std::string& filename) {
+      std::ifstream fin(filename.c_str(), std::ios_base::in | std::ios_base::binary);
+      char header[BLOCK_HEADER_SIZE];
+      fin.read(header, BLOCK_HEADER_SIZE);
+      return fin.good() && block_size(header, BLOCK_HEADER_SIZE) > 0;
+    }
+
+
+    bool read_index(const std::string& filename, std::vector<size_t>& index) {
+      index.clear();
+      // the bgzip index lists the (compressed, uncompressed) offsets of
+      // every block but the first
+      std::ifstream gzi((filename + ".gzi").c_str(),
+                        std::ios_base::in | std::ios_base::binary);
+      if (gzi.good()) {
+        uint64_t n = 0;
+        gzi.read(reinterpret_cast<char*>(&n), sizeof(n));
+        std::vector<uint64_t> entries(2 * n);
+        if (n > 0) {
+          gzi.read(reinterpret_cast<char*>(&entries[0]),
+                   entries.size() * sizeof(uint64_t));
+        }
+        if (!gzi.fail()) {
+          index.push_back(0);
+          for (size_t i = 0; i < n; ++i) index.push_back(entries[2 * i]);
+          return true;
+        }
+        logstream(LOG_WARNING) << "Ignoring unreadable index "
+                               << filename << ".gzi" << std::endl;
+        index.clear();
+      }
+
+      std::ifstream fin(filename.c_str(), std::ios_base::in | std::ios_base::binary);
+      fin.seekg(0, std::ios_base::end);
+      const size_t filesize = fin.tellg();
+      size_t offset = 0;
+      std::vector<char> header(MAX_BLOCK_SIZE);
+      while (offset < filesize) {
+        const size_t len = std::min(MAX_BLOCK_SIZE, filesize - offset);
+        if (len < HEADER_SIZE) return false;
+        fin.seekg(offset);
+        fin.read(&header[0], HEADER_SIZE);
+        if (fin.fail()) return false;
+        const size_t xlen = read_le16(&header[10]);
+        if (HEADER_SIZE + xlen > len) return false;
+        fin.read(&header[HEADER_SIZE], xlen);
+        const size_t bsize = block_size(&header[0], HEADER_SIZE + xlen);
+        if (fin.fail() || bsize == 0) return false;
+        index.push_back(offset);
+        offset += bsize;
+      }
+      return offset == filesize;
+    }
+
+
+    bool inflate_block(const char* data, size_t length, std::string& out,
+                       size_t& bsize) {
+      if (length < HEADER_SIZE) return false;
+      bsize = block_size(data, length);
+      const size_t xlen = read_le16(data + 10);
+      if (bsize == 0 || bsize > length ||
+          bsize < HEADER_SIZE + xlen + TRAILER_SIZE) return false;
+      const size_t isize = read_le32(data + bsize - 4);
+      const uint32_t crc = read_le32(data + bsize - 8);
+      if (isize > MAX_BLOCK_SIZE) return false;
+      const size_t outpos = out.size();
+      out.resize(outpos + isize);
+      if (isize == 0) return true;
+
+      z_stream strm;
+      memset(&strm, 0, sizeof(strm));
+      if (inflateInit2(&strm, -15) != Z_OK) return false;
+      strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data)) +
+                     HEADER_SIZE + xlen;
+      strm.avail_in = bsize - HEADER_SIZE - xlen - TRAILER_SIZE;
+      strm.next_out = reinterpret_cast<Bytef*>(&out[outpos]);
+      strm.avail_out = isize;
+      const int ret = inflate(&strm, Z_FINISH);
+      inflateEnd(&strm);
+      if (ret != Z_STREAM_END || strm.avail_out != 0) return false;
+      return crc32(0, reinterpret_cast<const Bytef*>(&out[outpos]), isize) == crc;
+    }
+
+
+    void compress_block(const char* data, size_t length, std::string& out) {
+      ASSERT_LE(length, BLOCK_SIZE);
+      const size_t start = out.size();
+      out.append(reinterpret_cast<const char*>(MAGIC), 4);
+      write_le32(out, 0);          // MTIME
+      out.push_back(char(0));      // XFL
+      out.push_back(char(0xff));   // OS: unknown
+      write_le16(out, 6);          // XLEN
+      out.push_back('B'); out.push_back('C');
+      write_le16(out, 2);
+      write_le16(out, 0);          // BSIZE, filled in below
+
+      z_stream strm;
+      memset(&strm, 0, sizeof(strm));
+      ASSERT_EQ(deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15,
+                             8, Z_DEFAULT_STRATEGY), Z_OK);
+      // deflate falls back to stored blocks, so BLOCK_SIZE input always
+      // fits in a 64KB block
+      const size_t bound = deflateBound(&strm, length);
+      out.resize(start + BLOCK_HEADER_SIZE + bound);
+      strm.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+      strm.avail_in = length;
+      strm.next_out = reinterpret_cast<Bytef*>(&out[start + BLOCK_HEADER_SIZE]);
+      strm.avail_out = bound;
+      ASSERT_EQ(deflate(&strm, Z_FINISH), Z_STREAM_END);
+      const size_t clen = strm.total_out;
+      deflateEnd(&strm);
+      out.resize(start + BLOCK_HEADER_SIZE + clen);
+
+      write_le32(out, crc32(0, reinterpret_cast<const Bytef*>(data), length));
+      write_le32(out, length);
+      const size_t bsize = out.size() - start;
+      ASSERT_LE(bsize, MAX_BLOCK_SIZE);
+      out[start + 16] = char((bsize - 1) & 0xff);
+      out[start + 17] = char(((bsize - 1) >> 8) & 0xff);
+    }
+
+
+    bool read_lines(const std::string& filename,
+                    const std::vector<size_t>& index,
+                    size_t first, size_t last,
+                    std::string& buffer, size_t& begin, size_t& end) {
+      buffer.clear();
+      begin = end = 0;
+      if (first >= last || first >= index.size()) return true;
+      size_t filesize = 0;
+      if (!mmap_file_range::file_size(filename, filesize)) return false;
+      // map everything from the first block on. Only the pages which are
+      // decompressed are actually read.
+      mmap_file_range range;
+      if (!range.open(filename, index[first], filesize)) return false;
+      const char* ptr = range.begin();
+      size_t bsize = 0;
+      for (size_t i = first; i < last && i < index.size(); ++i) {
+        const size_t offset = index[i] - index[first];
+        if (!inflate_block(ptr + offset, range.size() - offset, buffer, bsize)) {
+          return false;
+        }
+      }
+      // complete the last owned line, which ends at the first newline at
+      // or after the end of the owned blocks
+      const size_t owned = buffer.size();
+      size_t offset = (last < index.size() ? index[last] : filesize) - index[first];
+      end = buffer.find('\n', owned);
+      while (end == std::string::npos && offset < range.size()) {
+        const size_t searchfrom = buffer.size();
+        if (!inflate_block(ptr + offset, range.size() - offset, buffer, bsize)) {
+          return false;
+        }
+        offset += bsize;
+        end = buffer.find('\n', searchfrom);
+      }
+      end = (end == std::string::npos) ? buffer.size() : end + 1;
+      if (first > 0) {
+        begin = buffer.find('\n');
+        begin = (begin == std::string::npos) ? end : std::min(begin + 1, end);
+      }
+      return true;
+    }
+
+  } // end of namespace bgzf
+}; // end of graphlab
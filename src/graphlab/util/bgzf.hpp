@@ -0,0 +1,144 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+
+#ifndef GRAPHLAB_BGZF_HPP
+#define GRAPHLAB_BGZF_HPP
+
+#include <string>
+#include <vector>
+#include <iosfwd>
+#include <boost/iostreams/concepts.hpp>
+#include <boost/iostreams/operations.hpp>
+
+
+namespace graphlab {
+
+  /**
+   * \ingroup util_internal
+   * \brief Reading and writing of BGZF (blocked gzip) files.
+   *
+   * A BGZF file is a sequence of gzip members, each holding at most 64KB
+   * of uncompressed data and recording its own compressed size in a gzip
+   * extra field. The file is therefore a valid gzip file, but any block
+   * can be located and decompressed on its own, so that one compressed
+   * file can be read by many threads in parallel. BGZF files are produced
+   * by bgzip (from htslib) and by bgzf_compressor.
+   */
+  namespace bgzf {
+
+    /// Uncompressed bytes per block written by compress_block()
+    static const size_t BLOCK_SIZE = 0xff00;
+
+    /// Returns true if the file begins with a BGZF block header.
+    bool is_bgzf(const std::string& filename);
+
+    /**
+     * Fills index with the byte offset of every block in the file. The
+     * offsets are read from the bgzip index filename + ".gzi" if it
+     * exists, and otherwise by walking the block headers. Returns false
+     * if the file is not a valid BGZF file.
+     */
+    bool read_index(const std::string& filename, std::vector<size_t>& index);
+
+    /**
+     * Decompresses the block at data, which holds at least length bytes,
+     * and appends its contents to out. On success block_size is set to
+     * the compressed size of the block. Returns false if the block is
+     * truncated or corrupt.
+     */
+    bool inflate_block(const char* data, size_t length, std::string& out,
+                       size_t& block_size);
+
+    /**
+     * Compresses length (at most BLOCK_SIZE) bytes into one block which
+     * is appended to out. A length of 0 writes the BGZF end of file marker.
+     */
+    void compress_block(const char* data, size_t length, std::string& out);
+
+    /**
+     * Reads the lines owned by the blocks [first, last) of index, the
+     * block index of filename. Blocks are decompressed into buffer and on
+     * return the owned lines are buffer[begin, end).
+     *
+     * Let [ubegin, uend) be the uncompressed bytes of the blocks. If first
+     * is 0, the lines starting at or before uend are owned. Otherwise the
+     * lines starting after ubegin and at or before uend are owned. Hence
+     * the adjacent block ranges of a file own every line exactly once.
+     * The blocks past last are decompressed as far as needed to complete
+     * the last line. Returns false on a read or decompression error.
+     */
+    bool read_lines(const std::string& filename,
+                    const std::vector<size_t>& index,
+                    size_t first, size_t last,
+                    std::string& buffer, size_t& begin, size_t& end);
+
+
+    /**
+     * \brief A boost iostreams output filter which writes BGZF.
+     *
+     * The output can be read by any gzip reader, and is split across
+     * threads and machines by distributed_graph::load().
+     * \code
+     *   boost::iostreams::filtering_stream<boost::iostreams::output> fout;
+     *   fout.push(graphlab::bgzf::bgzf_compressor());
+     *   fout.push(boost::iostreams::file_sink("graph.tsv.gz"));
+     * \endcode
+     */
+    class bgzf_compressor : public boost::iostreams::multichar_output_filter {
+     public:
+      template<typename Sink>
+      std::streamsize write(Sink& snk, const char* s, std::streamsize n) {
+        buffer.append(s, n);
+        size_t pos = 0;
+        while (buffer.size() - pos >= BLOCK_SIZE) {
+          write_block(snk, buffer.data() + pos, BLOCK_SIZE);
+          pos += BLOCK_SIZE;
+        }
+        buffer.erase(0, pos);
+        return n;
+      }
+
+      template<typename Sink>
+      void close(Sink& snk) {
+        if (!buffer.empty()) write_block(snk, buffer.data(), buffer.size());
+        buffer.clear();
+        write_block(snk, NULL, 0);
+      }
+
+     private:
+      std::string buffer;
+      std::string block;
+
+      template<typename Sink>
+      void write_block(Sink& snk, const char* s, size_t n) {
+        block.clear();
+        compress_block(s, n, block);
+        boost::iostreams::write(snk, block.data(), block.size());
+      }
+    }; // end of bgzf_compressor
+
+  } // end of namespace bgzf
+}; // end of graphlab
+#endif
@@ -0,0 +1,510 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_COMPACT_BITSET_HPP
+#define GRAPHLAB_COMPACT_BITSET_HPP
+
+#include <cstdlib>
+#include <cstring>
+#include <iterator>
+#include <algorithm>
+#include <stdint.h>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/serialization/iarchive.hpp>
+#include <graphlab/serialization/oarchive.hpp>
+
+namespace graphlab {
+
+  /**  \ingroup util
+   * A set of small integers (< 65536) whose memory footprint scales with
+   * the number of elements rather than with the largest element.
+   *
+   * This is used to store sets of machines (i.e. the mirrors of a vertex)
+   * where the number of machines is a runtime value, but each set
+   * typically contains only a handful of them.
+   *
+   * The set is stored in one of three representations:
+   * \li Up to 3 elements are stored inline in the object (8 bytes).
+   * \li Larger sets are stored as a sorted heap array of 16-bit integers.
+   * \li Once the sorted array would take more space than a bitmap
+   *     covering the largest element, it is converted to a bitmap.
+   *
+   * The interface mirrors fixed_dense_bitset. However, unlike
+   * fixed_dense_bitset, none of the modifying operations are atomic: the
+   * caller must serialize concurrent modification of the same set.
+   */
+  class compact_bitset {
+  public:
+    /// One more than the largest bit index which can be stored
+    static const size_t MAX_BITS = 65536;
+
+    /// Constructs an empty set
+    compact_bitset() : word(0) { }
+
+    /// Make a copy of the set other
+    compact_bitset(const compact_bitset& other) : word(0) {
+      *this = other;
+    }
+
+    ~compact_bitset() {
+      release();
+    }
+
+    /// Make a copy of the set other
+    inline compact_bitset& operator=(const compact_bitset& other) {
+      if (this == &other) return *this;
+      release();
+      if (other.is_inline()) {
+        word = other.word;
+      } else {
+        const size_t bytes = other.heap_bytes();
+        heap_header* h = (heap_header*)malloc(bytes);
+        ASSERT_TRUE(h != NULL);
+        memcpy(h, other.get_heap(), bytes);
+        set_heap(h);
+      }
+      return *this;
+    }
+
+    /// Removes all elements
+    inline void clear() {
+      release();
+    }
+
+    inline bool empty() const {
+      return word == 0;
+    }
+
+    /// Returns the number of elements in the set
+    inline size_t popcount() const {
+      if (word == 0) return 0;
+      else if (word & 1) return (word >> 1) & 3;
+      else return get_heap()->count;
+    }
+
+    /// Returns true if the bit b is set
+    inline bool get(size_t b) const {
+      if (word == 0 || b >= MAX_BITS) return false;
+      if (word & 1) {
+        const size_t n = popcount();
+        for (size_t i = 0; i < n; ++i) {
+          if (inline_entry(i) == b) return true;
+        }
+        return false;
+      }
+      const heap_header* h = get_heap();
+      if (h->dense) {
+        const size_t arrpos = b / WORD_BITS;
+        return arrpos < h->capacity &&
+            (dense_array(h)[arrpos] & (size_t(1) << (b % WORD_BITS)));
+      }
+      const uint16_t* e = sparse_array(h);
+      return std::binary_search(e, e + h->count, (uint16_t)b);
+    }
+
+    /// Sets the bit b returning the old value
+    inline bool set_bit(size_t b) {
+      ASSERT_LT(b, MAX_BITS);
+      if (is_inline()) {
+        uint16_t e[INLINE_CAPACITY + 1];
+        size_t n = unpack_inline(e);
+        size_t pos = 0;
+        while (pos < n && e[pos] < b) ++pos;
+        if (pos < n && e[pos] == b) return true;
+        for (size_t i = n; i > pos; --i) e[i] = e[i - 1];
+        e[pos] = (uint16_t)b;
+        ++n;
+        if (n <= INLINE_CAPACITY) {
+          pack_inline(e, n);
+        } else {
+          heap_header* h = allocate(2 * INLINE_CAPACITY, false);
+          memcpy(sparse_array(h), e, n * sizeof(uint16_t));
+          h->count = (uint32_t)n;
+          set_heap(h);
+        }
+        return false;
+      }
+      heap_header* h = get_heap();
+      if (h->dense) return dense_set(b);
+      uint16_t* e = sparse_array(h);
+      size_t pos = std::lower_bound(e, e + h->count, (uint16_t)b) - e;
+      if (pos < h->count && e[pos] == b) return true;
+      // switch to a bitmap once it is no larger than the sorted array
+      const size_t maxbit = std::max<size_t>(b, e[h->count - 1]);
+      const size_t nwords = maxbit / WORD_BITS + 1;
+      if ((h->count + 1) * sizeof(uint16_t) >= nwords * sizeof(size_t)) {
+        convert_to_dense(nwords);
+        return dense_set(b);
+      }
+      if (h->count == h->capacity) {
+        h = reallocate(h, 2 * h->capacity);
+        e = sparse_array(h);
+      }
+      memmove(e + pos + 1, e + pos, (h->count - pos) * sizeof(uint16_t));
+      e[pos] = (uint16_t)b;
+      ++h->count;
+      return false;
+    }
+
+    /// Equivalent to set_bit(). Provided for fixed_dense_bitset compatibility
+    inline bool set_bit_unsync(size_t b) {
+      return set_bit(b);
+    }
+
+    /// Set the state of the bit returning the old value
+    inline bool set(size_t b, bool value) {
+      if (value) return set_bit(b);
+      else return clear_bit(b);
+    }
+
+    /// Clears the bit b returning the old value
+    inline bool clear_bit(size_t b) {
+      if (word == 0 || b >= MAX_BITS) return false;
+      if (word & 1) {
+        uint16_t e[INLINE_CAPACITY];
+        size_t n = unpack_inline(e);
+        for (size_t i = 0; i < n; ++i) {
+          if (e[i] == b) {
+            for (size_t j = i + 1; j < n; ++j) e[j - 1] = e[j];
+            pack_inline(e, n - 1);
+            return true;
+          }
+        }
+        return false;
+      }
+      heap_header* h = get_heap();
+      if (h->dense) {
+        const size_t arrpos = b / WORD_BITS;
+        const size_t mask = size_t(1) << (b % WORD_BITS);
+        if (arrpos >= h->capacity || !(dense_array(h)[arrpos] & mask)) {
+          return false;
+        }
+        dense_array(h)[arrpos] &= ~mask;
+        --h->count;
+      } else {
+        uint16_t* e = sparse_array(h);
+        uint16_t* pos = std::lower_bound(e, e + h->count, (uint16_t)b);
+        if (pos == e + h->count || *pos != b) return false;
+        memmove(pos, pos + 1, (e + h->count - pos - 1) * sizeof(uint16_t));
+        --h->count;
+      }
+      if (h->count == 0) release();
+      return true;
+    }
+
+    /// Equivalent to clear_bit(). Provided for fixed_dense_bitset compatibility
+    inline bool clear_bit_unsync(size_t b) {
+      return clear_bit(b);
+    }
+
+    /** Returns true with b containing the position of the
+        first bit set to true.
+        If such a bit does not exist, this function returns false.
+    */
+    inline bool first_bit(size_t& b) const {
+      if (word == 0) return false;
+      if (word & 1) {
+        b = inline_entry(0);
+        return true;
+      }
+      const heap_header* h = get_heap();
+      if (!h->dense) {
+        b = sparse_array(h)[0];
+        return true;
+      }
+      return dense_next(h, 0, b);
+    }
+
+    /** Where b is a bit index, this function will return in b,
+        the position of the next bit set to true, and return true.
+        If all bits after b are false, this function returns false.
+    */
+    inline bool next_bit(size_t& b) const {
+      if (word == 0) return false;
+      if (word & 1) {
+        const size_t n = popcount();
+        for (size_t i = 0; i < n; ++i) {
+          if (inline_entry(i) > b) {
+            b = inline_entry(i);
+            return true;
+          }
+        }
+        return false;
+      }
+      const heap_header* h = get_heap();
+      if (h->dense) return dense_next(h, b + 1, b);
+      if (b >= MAX_BITS) return false;
+      const uint16_t* e = sparse_array(h);
+      const uint16_t* pos = std::upper_bound(e, e + h->count, (uint16_t)b);
+      if (pos == e + h->count) return false;
+      b = *pos;
+      return true;
+    }
+
+    struct bit_pos_iterator {
+      typedef std::input_iterator_tag iterator_category;
+      typedef size_t value_type;
+      typedef size_t difference_type;
+      typedef const size_t reference;
+      typedef const size_t* pointer;
+      size_t pos;
+      const compact_bitset* db;
+      bit_pos_iterator():pos(-1),db(NULL) {}
+      bit_pos_iterator(const compact_bitset* const db, size_t pos):pos(pos),db(db) {}
+
+      size_t operator*() const {
+        return pos;
+      }
+      size_t operator++(){
+        if (db->next_bit(pos) == false) pos = (size_t)(-1);
+        return pos;
+      }
+      size_t operator++(int){
+        size_t prevpos = pos;
+        if (db->next_bit(pos) == false) pos = (size_t)(-1);
+        return prevpos;
+      }
+      bool operator==(const bit_pos_iterator& other) const {
+        ASSERT_TRUE(db == other.db);
+        return other.pos == pos;
+      }
+      bool operator!=(const bit_pos_iterator& other) const {
+        ASSERT_TRUE(db == other.db);
+        return other.pos != pos;
+      }
+    };
+
+    typedef bit_pos_iterator iterator;
+    typedef bit_pos_iterator const_iterator;
+
+    bit_pos_iterator begin() const {
+      size_t pos;
+      if (first_bit(pos) == false) pos = size_t(-1);
+      return bit_pos_iterator(this, pos);
+    }
+
+    bit_pos_iterator end() const {
+      return bit_pos_iterator(this, (size_t)(-1));
+    }
+
+    /// Adds all the elements of other to this set
+    compact_bitset& operator|=(const compact_bitset& other) {
+      size_t b;
+      if (other.first_bit(b)) {
+        do {
+          set_bit(b);
+        } while (other.next_bit(b));
+      }
+      return *this;
+    }
+
+    bool operator==(const compact_bitset& other) const {
+      if (popcount() != other.popcount()) return false;
+      size_t b1, b2;
+      bool has1 = first_bit(b1), has2 = other.first_bit(b2);
+      while (has1 && has2) {
+        if (b1 != b2) return false;
+        has1 = next_bit(b1);
+        has2 = other.next_bit(b2);
+      }
+      return has1 == has2;
+    }
+
+    bool operator!=(const compact_bitset& other) const {
+      return !(*this == other);
+    }
+
+    /// Returns the number of bytes of heap memory used by this set
+    size_t heap_memory_usage() const {
+      return is_inline() ? 0 : heap_bytes();
+    }
+
+    /// Serializes this set to an archive
+    inline void save(oarchive& oarc) const {
+      oarc << (uint32_t)popcount();
+      size_t b;
+      if (first_bit(b)) {
+        do {
+          oarc << (uint16_t)b;
+        } while (next_bit(b));
+      }
+    }
+
+    /// Deserializes this set from an archive
+    inline void load(iarchive& iarc) {
+      clear();
+      uint32_t n;
+      iarc >> n;
+      for (uint32_t i = 0; i < n; ++i) {
+        uint16_t b;
+        iarc >> b;
+        set_bit(b);
+      }
+    }
+
+  private:
+    static const size_t WORD_BITS = 8 * sizeof(size_t);
+    static const size_t INLINE_CAPACITY = 3;
+
+    /** Header of the heap representation. Followed by capacity 16-bit
+     * sorted entries if dense == 0, or capacity size_t words of bitmap
+     * otherwise.
+     */
+    struct heap_header {
+      uint32_t count;
+      uint16_t capacity;
+      uint16_t dense;
+    };
+
+    /** Either 0 (empty), a heap_header pointer (low bit clear), or
+     * an inline set (low bit set) with the element count in bits 1-2
+     * and up to 3 16-bit elements in bits 16-63.
+     */
+    uint64_t word;
+
+    inline bool is_inline() const {
+      return word == 0 || (word & 1);
+    }
+
+    inline heap_header* get_heap() const {
+      return (heap_header*)(uintptr_t)word;
+    }
+
+    inline void set_heap(heap_header* h) {
+      word = (uint64_t)(uintptr_t)h;
+    }
+
+    inline size_t inline_entry(size_t i) const {
+      return (word >> (16 * (i + 1))) & 0xffff;
+    }
+
+    inline size_t unpack_inline(uint16_t* e) const {
+      const size_t n = popcount();
+      for (size_t i = 0; i < n; ++i) e[i] = (uint16_t)inline_entry(i);
+      return n;
+    }
+
+    inline void pack_inline(const uint16_t* e, size_t n) {
+      if (n == 0) {
+        word = 0;
+        return;
+      }
+      uint64_t w = 1 | (uint64_t(n) << 1);
+      for (size_t i = 0; i < n; ++i) w |= uint64_t(e[i]) << (16 * (i + 1));
+      word = w;
+    }
+
+    static inline uint16_t* sparse_array(heap_header* h) {
+      return (uint16_t*)(h + 1);
+    }
+
+    static inline const uint16_t* sparse_array(const heap_header* h) {
+      return (const uint16_t*)(h + 1);
+    }
+
+    static inline size_t* dense_array(heap_header* h) {
+      return (size_t*)(h + 1);
+    }
+
+    static inline const size_t* dense_array(const heap_header* h) {
+      return (const size_t*)(h + 1);
+    }
+
+    static inline size_t heap_bytes(size_t capacity, bool dense) {
+      return sizeof(heap_header) +
+          capacity * (dense ? sizeof(size_t) : sizeof(uint16_t));
+    }
+
+    inline size_t heap_bytes() const {
+      const heap_header* h = get_heap();
+      return heap_bytes(h->capacity, h->dense);
+    }
+
+    static heap_header* allocate(size_t capacity, bool dense) {
+      heap_header* h = (heap_header*)malloc(heap_bytes(capacity, dense));
+      ASSERT_TRUE(h != NULL);
+      h->count = 0;
+      h->capacity = (uint16_t)capacity;
+      h->dense = dense;
+      if (dense) memset(dense_array(h), 0, capacity * sizeof(size_t));
+      return h;
+    }
+
+    heap_header* reallocate(heap_header* h, size_t capacity) {
+      h = (heap_header*)realloc(h, heap_bytes(capacity, h->dense));
+      ASSERT_TRUE(h != NULL);
+      if (h->dense) {
+        memset(dense_array(h) + h->capacity, 0,
+               (capacity - h->capacity) * sizeof(size_t));
+      }
+      h->capacity = (uint16_t)capacity;
+      set_heap(h);
+      return h;
+    }
+
+    inline void release() {
+      if (!is_inline()) free(get_heap());
+      word = 0;
+    }
+
+    void convert_to_dense(size_t nwords) {
+      heap_header* h = get_heap();
+      heap_header* d = allocate(nwords, true);
+      const uint16_t* e = sparse_array(h);
+      for (size_t i = 0; i < h->count; ++i) {
+        dense_array(d)[e[i] / WORD_BITS] |= size_t(1) << (e[i] % WORD_BITS);
+      }
+      d->count = h->count;
+      free(h);
+      set_heap(d);
+    }
+
+    bool dense_set(size_t b) {
+      heap_header* h = get_heap();
+      const size_t arrpos = b / WORD_BITS;
+      if (arrpos >= h->capacity) h = reallocate(h, arrpos + 1);
+      const size_t mask = size_t(1) << (b % WORD_BITS);
+      if (dense_array(h)[arrpos] & mask) return true;
+      dense_array(h)[arrpos] |= mask;
+      ++h->count;
+      return false;
+    }
+
+    /// Finds the first set bit at position >= start
+    static bool dense_next(const heap_header* h, size_t start, size_t& b) {
+      size_t arrpos = start / WORD_BITS;
+      if (arrpos >= h->capacity) return false;
+      size_t block = dense_array(h)[arrpos] &
+          (size_t(-1) << (start % WORD_BITS));
+      while (block == 0) {
+        if (++arrpos >= h->capacity) return false;
+        block = dense_array(h)[arrpos];
+      }
+      b = arrpos * WORD_BITS + (size_t)__builtin_ctzl(block);
+      return true;
+    }
+  };
+
+} // namespace graphlab
+#endif
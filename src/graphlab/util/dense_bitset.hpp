@@ -83,14 +83,14 @@ namespace graphlab {
       size_t prev_arrlen = arrlen;
       arrlen = (n / (sizeof(size_t) * 8)) + (n % (sizeof(size_t) * 8) > 0);
       array = (size_t*)realloc(array, sizeof(size_t) * arrlen);
-      // this zeros the remainder of the block after the last bit
-      fix_trailing_bits();
       // if we grew, we need to zero all new blocks
       if (arrlen > prev_arrlen) {
         for (size_t i = prev_arrlen; i < arrlen; ++i) {
           array[i] = 0;
         }
       }
+      // this zeros the remainder of the block after the last bit
+      fix_trailing_bits();
     }
   
     /// Sets all bits to 0
@@ -27,6 +27,7 @@
 #endif
 
 #include <vector>
+#include <algorithm>
 #include <graphlab/parallel/atomic.hpp>
 
 namespace graphlab {
@@ -75,6 +76,111 @@ namespace graphlab {
         }
       }
     }
+
+    /**
+     * Stable multi-threaded counting sort.
+     * Generate permute_index for value_vec in ascending order and
+     * optionally fill in the prefix array of the counts, exactly as
+     * counting_sort() does.
+     *
+     * The input is cut into one contiguous block per thread. Each thread
+     * builds a private histogram of its block, the histograms are turned
+     * into per-block write offsets by a parallel prefix sum over the
+     * value range, and each thread then scatters its block without any
+     * atomic operations.
+     *
+     * The private histograms cost (maxval+1) entries per block, so the
+     * number of blocks is capped to keep them within a small multiple of
+     * value_vec.size(). When the value range is too wide for even two
+     * blocks, the whole input is sorted as one block by a single thread.
+     * The sort is stable either way.
+     */
+    template <typename valuetype, typename sizetype>
+    void parallel_counting_sort(const std::vector<valuetype>& value_vec,
+                                std::vector<sizetype>& permute_index,
+                                std::vector<sizetype>* prefix_array = NULL) {
+      if(value_vec.size() == 0) return;
+      const size_t nvalues = value_vec.size();
+
+      size_t maxblocks = 1;
+#ifdef _OPENMP
+      maxblocks = omp_get_max_threads();
+#endif
+      valuetype maxval = *std::max_element(value_vec.begin(), value_vec.end());
+      const size_t range = size_t(maxval) + 1;
+      maxblocks = std::min(maxblocks, std::max<size_t>(1, 2 * nvalues / range));
+
+      permute_index.resize(nvalues);
+      if (prefix_array != NULL) prefix_array->resize(range);
+      std::vector< std::vector<sizetype> > hist(maxblocks);
+      // prefix sums of the counts of each value range block
+      std::vector<size_t> range_total(maxblocks + 1, 0);
+      // the runtime may hand out fewer threads than asked for
+      size_t nblocks = 1;
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(maxblocks)
+#endif
+      {
+        size_t b = 0;
+#ifdef _OPENMP
+        b = omp_get_thread_num();
+#pragma omp single
+        nblocks = std::min<size_t>(maxblocks, omp_get_num_threads());
+#endif
+        const bool active = b < nblocks;
+        const size_t begin = nvalues * b / nblocks;
+        const size_t end = nvalues * (b + 1) / nblocks;
+        const size_t vbegin = range * b / nblocks;
+        const size_t vend = range * (b + 1) / nblocks;
+        // Phase 1: private histogram of input block b.
+        if (active) {
+          hist[b].assign(range, 0);
+          sizetype* h = &(hist[b][0]);
+          for (size_t i = begin; i < end; ++i) ++h[value_vec[i]];
+        }
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+        // Phase 2: value range block b sums its counts over all blocks.
+        if (active) {
+          size_t total = 0;
+          for (size_t v = vbegin; v < vend; ++v) {
+            for (size_t k = 0; k < nblocks; ++k) total += hist[k][v];
+          }
+          range_total[b + 1] = total;
+        }
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp single
+#endif
+        for (size_t k = 1; k <= nblocks; ++k) range_total[k] += range_total[k-1];
+        // Phase 3: turn the counts into write offsets. Value v of input
+        // block k is written after all smaller values, and after the
+        // copies of v in the input blocks before k.
+        if (active) {
+          size_t offset = range_total[b];
+          for (size_t v = vbegin; v < vend; ++v) {
+            if (prefix_array != NULL) (*prefix_array)[v] = offset;
+            for (size_t k = 0; k < nblocks; ++k) {
+              const size_t count = hist[k][v];
+              hist[k][v] = offset;
+              offset += count;
+            }
+          }
+        }
+#ifdef _OPENMP
+#pragma omp barrier
+#endif
+        // Phase 4: scatter input block b.
+        if (active) {
+          sizetype* h = &(hist[b][0]);
+          for (size_t i = begin; i < end; ++i) {
+            permute_index[h[value_vec[i]]++] = i;
+          }
+        }
+      }
+    }
 } // end of graphlab
 
 #endif
@@ -110,7 +110,7 @@ namespace graphlab {
                std::vector<valuetype>& value_vec) {
        for (ssize_t i = 1; i < (ssize_t)valueptr_vec.size(); ++i) {
          ASSERT_LE(valueptr_vec[i-1], valueptr_vec[i]);
-         ASSERT_LT(valueptr_vec[i], value_vec.size());
+         ASSERT_LE(valueptr_vec[i], value_vec.size());
        }
        value_ptrs.swap(valueptr_vec);
        values.swap(value_vec);
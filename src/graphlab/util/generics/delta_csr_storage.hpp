@@ -0,0 +1,288 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#ifndef GRAPHLAB_DELTA_CSR_STORAGE
+#define GRAPHLAB_DELTA_CSR_STORAGE
+
+#ifndef __NO_OPENMP__
+#include <omp.h>
+#endif
+
+#include <vector>
+#include <utility>
+#include <stdint.h>
+
+#include <graphlab/util/varint.hpp>
+#include <graphlab/logger/assertions.hpp>
+#include <graphlab/serialization/iarchive.hpp>
+#include <graphlab/serialization/oarchive.hpp>
+
+namespace graphlab {
+  /**
+   * A compressed counterpart of csr_storage for integral values.
+   *
+   * The values of each key are stored as a byte stream of zigzag varint
+   * deltas: the first value relative to the key itself and every other
+   * value relative to its predecessor. Sorted neighbor lists of graphs
+   * with some locality therefore mostly take one or two bytes per value
+   * instead of sizeof(valuetype).
+   *
+   * Optionally each value carries an integral id (e.g. an edge id), which
+   * is delta coded against the previous id and interleaved with the
+   * values. Without stored ids the id of a value is its position in the
+   * storage, as with csr_storage.
+   *
+   * Values are read sequentially through a cursor; there is no random
+   * access within the values of a key.
+   */
+  template <typename sizetype=size_t>
+  class delta_csr_storage {
+   public:
+     /**
+      * Sequential reader over the values of one key. value() and id() are
+      * valid while !done().
+      */
+     class cursor {
+      public:
+       cursor() : ptr(NULL), pos(0), last(0), val(0), idval(0), with_ids(false) { }
+
+       cursor(const unsigned char* ptr, size_t pos, size_t last,
+              uint64_t base, bool with_ids) :
+         ptr(ptr), pos(pos), last(last), val(base), idval(0),
+         with_ids(with_ids) {
+         load();
+       }
+
+       inline bool done() const { return pos >= last; }
+       inline uint64_t value() const { return val; }
+       inline uint64_t id() const { return idval; }
+       /// Position of the current value in the storage
+       inline size_t position() const { return pos; }
+
+       inline void next() {
+         ++pos;
+         load();
+       }
+
+      private:
+       inline void load() {
+         if (pos >= last) return;
+         uint64_t delta;
+         ptr = varint::decode(ptr, delta);
+         val += uint64_t(varint::zigzag_decode(delta));
+         if (with_ids) {
+           ptr = varint::decode(ptr, delta);
+           idval += uint64_t(varint::zigzag_decode(delta));
+         } else {
+           idval = pos;
+         }
+       }
+
+       const unsigned char* ptr;
+       size_t pos;
+       size_t last;
+       uint64_t val;
+       uint64_t idval;
+       bool with_ids;
+     }; // end of cursor
+
+   public:
+     delta_csr_storage() : nvalues(0), with_ids(false) { }
+
+     /**
+      * Encodes the values of a csr_storage style layout: valueptr_vec[i]
+      * is the index of the first value of key i in value_vec.
+      */
+     template <typename valuetype>
+     void encode(const std::vector<sizetype>& valueptr_vec,
+                 const std::vector<valuetype>& value_vec) {
+       encode_impl(valueptr_vec, value_vec.size(), false,
+                   value_reader<valuetype>(value_vec));
+     }
+
+     /**
+      * Encodes (value, id) pairs in a csr_storage style layout. The id of
+      * each value is stored alongside it.
+      */
+     template <typename valuetype, typename idtype>
+     void encode(const std::vector<sizetype>& valueptr_vec,
+                 const std::vector<std::pair<valuetype, idtype> >& value_vec) {
+       encode_impl(valueptr_vec, value_vec.size(), true,
+                   pair_reader<valuetype, idtype>(value_vec));
+     }
+
+     /// Number of keys in the storage.
+     inline size_t num_keys() const { return value_ptrs.size(); }
+
+     /// Number of values in the storage.
+     inline size_t num_values() const { return nvalues; }
+
+     /// Whether ids are stored with the values.
+     inline bool has_ids() const { return with_ids; }
+
+     /// Index of the first value with key == id
+     inline size_t begin_index(size_t id) const {
+       return id < num_keys() ? value_ptrs[id] : nvalues;
+     }
+
+     /// Index past the last value with key == id
+     inline size_t end_index(size_t id) const {
+       return (id+1) < num_keys() ? value_ptrs[id+1] : nvalues;
+     }
+
+     /// Number of values with key == id
+     inline size_t num_values(size_t id) const {
+       return end_index(id) - begin_index(id);
+     }
+
+     /// Cursor at the first value with key == id
+     inline cursor begin(size_t id) const {
+       if (id >= num_keys()) return end(id);
+       return cursor(&bytes[0] + byte_ptrs[id], begin_index(id),
+                     end_index(id), id, with_ids);
+     }
+
+     /// Cursor past the last value with key == id
+     inline cursor end(size_t id) const {
+       const size_t last = end_index(id);
+       return cursor(NULL, last, last, 0, with_ids);
+     }
+
+     /// Number of bytes used by the encoded values
+     size_t num_bytes() const { return bytes.size(); }
+
+     void swap(delta_csr_storage& other) {
+       value_ptrs.swap(other.value_ptrs);
+       byte_ptrs.swap(other.byte_ptrs);
+       bytes.swap(other.bytes);
+       std::swap(nvalues, other.nvalues);
+       std::swap(with_ids, other.with_ids);
+     }
+
+     void clear() {
+       std::vector<sizetype>().swap(value_ptrs);
+       std::vector<size_t>().swap(byte_ptrs);
+       std::vector<unsigned char>().swap(bytes);
+       nvalues = 0;
+       with_ids = false;
+     }
+
+     void load(iarchive& iarc) {
+       clear();
+       iarc >> value_ptrs >> byte_ptrs >> bytes >> nvalues >> with_ids;
+     }
+
+     void save(oarchive& oarc) const {
+       oarc << value_ptrs << byte_ptrs << bytes << nvalues << with_ids;
+     }
+
+     size_t estimate_sizeof() const {
+       return sizeof(*this) + sizeof(sizetype) * value_ptrs.capacity()
+           + sizeof(size_t) * byte_ptrs.capacity() + bytes.capacity();
+     }
+
+   private:
+     template <typename valuetype>
+     struct value_reader {
+       const std::vector<valuetype>& vec;
+       value_reader(const std::vector<valuetype>& vec) : vec(vec) { }
+       uint64_t value(size_t i) const { return vec[i]; }
+       uint64_t id(size_t) const { return 0; }
+     };
+
+     template <typename valuetype, typename idtype>
+     struct pair_reader {
+       const std::vector<std::pair<valuetype, idtype> >& vec;
+       pair_reader(const std::vector<std::pair<valuetype, idtype> >& vec) : vec(vec) { }
+       uint64_t value(size_t i) const { return vec[i].first; }
+       uint64_t id(size_t i) const { return vec[i].second; }
+     };
+
+     static inline size_t delta_size(uint64_t cur, uint64_t prev) {
+       return varint::encoded_size(varint::zigzag_encode(int64_t(cur - prev)));
+     }
+
+     static inline unsigned char* put_delta(uint64_t cur, uint64_t prev,
+                                            unsigned char* out) {
+       return varint::encode(varint::zigzag_encode(int64_t(cur - prev)), out);
+     }
+
+     /**
+      * Two parallel passes over the keys: the first measures the encoded
+      * size of every key, the second writes each key at its offset.
+      */
+     template <typename Reader>
+     void encode_impl(const std::vector<sizetype>& valueptr_vec,
+                      size_t numvalues, bool store_ids,
+                      const Reader& reader) {
+       clear();
+       value_ptrs = valueptr_vec;
+       nvalues = numvalues;
+       with_ids = store_ids;
+       const ssize_t nkeys = value_ptrs.size();
+       byte_ptrs.resize(nkeys + 1, 0);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif
+       for (ssize_t k = 0; k < nkeys; ++k) {
+         size_t len = 0;
+         uint64_t prev = k, previd = 0;
+         for (size_t i = begin_index(k); i < end_index(k); ++i) {
+           len += delta_size(reader.value(i), prev);
+           prev = reader.value(i);
+           if (with_ids) {
+             len += delta_size(reader.id(i), previd);
+             previd = reader.id(i);
+           }
+         }
+         byte_ptrs[k + 1] = len;
+       }
+       for (ssize_t k = 0; k < nkeys; ++k) byte_ptrs[k + 1] += byte_ptrs[k];
+       // slack so the decoder never has to check for the end of the buffer
+       bytes.resize(byte_ptrs[nkeys] + varint::VARINT_MAX_BYTES);
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1024)
+#endif
+       for (ssize_t k = 0; k < nkeys; ++k) {
+         unsigned char* out = &bytes[0] + byte_ptrs[k];
+         uint64_t prev = k, previd = 0;
+         for (size_t i = begin_index(k); i < end_index(k); ++i) {
+           out = put_delta(reader.value(i), prev, out);
+           prev = reader.value(i);
+           if (with_ids) {
+             out = put_delta(reader.id(i), previd, out);
+             previd = reader.id(i);
+           }
+         }
+         ASSERT_TRUE(out == &bytes[0] + byte_ptrs[k + 1]);
+       }
+     }
+
+     std::vector<sizetype> value_ptrs;
+     std::vector<size_t> byte_ptrs;
+     std::vector<unsigned char> bytes;
+     size_t nvalues;
+     bool with_ids;
+  }; // end of class
+} // end of graphlab
+#endif
@@ -67,6 +67,20 @@ class inplace_lf_queue2 {
      asm volatile ("" : : : "memory");
    }
 
+   /**
+    * Enqueues the list first .. last, already linked through their next
+    * pointers, as a whole: a concurrent dequeue_all() returns either none
+    * or all of it.
+    */
+   void enqueue(T* first, T* last, size_t count) {
+     (*get_next_ptr(last)) = NULL;
+     T* prev = last;
+     atomic_exchange(tail, prev);
+     (*get_next_ptr(prev)) = first;
+     numel.inc(count);
+     asm volatile ("" : : : "memory");
+   }
+
    size_t approx_size() {
     return numel;
    }
@@ -0,0 +1,198 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <cstring>
+#include <stdint.h>
+
+#include <graphlab/util/lz4_block.hpp>
+
+
+namespace graphlab {
+  namespace lz4 {
+
+    namespace {
+      // The last match must start at least this far from the end of input
+      const size_t MFLIMIT = 12;
+      // The last bytes of the input are always emitted as literals
+      const size_t LASTLITERALS = 5;
+      const size_t MINMATCH = 4;
+      const size_t MAX_DISTANCE = 65535;
+      const size_t HASH_LOG = 12;
+
+      inline uint32_t read32(const unsigned char* p) {
+        uint32_t v; memcpy(&v, p, sizeof(v)); return v;
+      }
+
+      inline size_t hash(uint32_t v) {
+        return (v * 2654435761U) >> (32 - HASH_LOG);
+      }
+
+      /*
+       * Writes a length as the continuation of a token nibble: a run of
+       * 255 bytes followed by the remainder.
+       */
+      inline unsigned char* write_length(unsigned char* op, size_t len) {
+        while (len >= 255) { *op++ = 255; len -= 255; }
+        *op++ = (unsigned char)len;
+        return op;
+      }
+
+      /*
+       * Emits one sequence: literals [anchor, anchor + nlit) followed by
+       * an optional match. Returns NULL if the output would overflow oend.
+       */
+      inline unsigned char* write_sequence(unsigned char* op,
+                                           unsigned char* oend,
+                                           const unsigned char* anchor,
+                                           size_t nlit,
+                                           bool has_match,
+                                           size_t offset,
+                                           size_t matchlen) {
+        // token + literal length + literals + offset + match length
+        size_t need = 1 + nlit / 255 + 1 + nlit + 2 + matchlen / 255 + 1;
+        if ((size_t)(oend - op) < need) return NULL;
+        unsigned char* token = op++;
+        if (nlit >= 15) {
+          *token = 15 << 4;
+          op = write_length(op, nlit - 15);
+        } else {
+          *token = (unsigned char)(nlit << 4);
+        }
+        memcpy(op, anchor, nlit);
+        op += nlit;
+        if (has_match) {
+          *op++ = (unsigned char)(offset & 0xff);
+          *op++ = (unsigned char)(offset >> 8);
+          size_t ml = matchlen - MINMATCH;
+          if (ml >= 15) {
+            *token |= 15;
+            op = write_length(op, ml - 15);
+          } else {
+            *token |= (unsigned char)ml;
+          }
+        }
+        return op;
+      }
+    } // anonymous namespace
+
+
+    size_t compress(const char* src, size_t len, char* dst, size_t cap) {
+      const unsigned char* base = (const unsigned char*)src;
+      const unsigned char* ip = base;
+      const unsigned char* anchor = base;
+      const unsigned char* iend = base + len;
+      unsigned char* op = (unsigned char*)dst;
+      unsigned char* oend = op + cap;
+
+      if (len >= MFLIMIT + 1) {
+        const unsigned char* mflimit = iend - MFLIMIT;
+        const unsigned char* matchlimit = iend - LASTLITERALS;
+        uint32_t table[1 << HASH_LOG];
+        memset(table, 0, sizeof(table));
+        ++ip;
+        while (ip < mflimit) {
+          uint32_t seq = read32(ip);
+          size_t h = hash(seq);
+          const unsigned char* ref = base + table[h];
+          table[h] = (uint32_t)(ip - base);
+          if (ref >= ip || (size_t)(ip - ref) > MAX_DISTANCE ||
+              read32(ref) != seq) {
+            ++ip;
+            continue;
+          }
+          // extend the match backwards over pending literals
+          while (ip > anchor && ref > base && ip[-1] == ref[-1]) {
+            --ip; --ref;
+          }
+          // and forwards up to the last literals
+          const unsigned char* mp = ip + MINMATCH;
+          const unsigned char* rp = ref + MINMATCH;
+          while (mp < matchlimit && *mp == *rp) { ++mp; ++rp; }
+          op = write_sequence(op, oend, anchor, ip - anchor, true,
+                              ip - ref, mp - ip);
+          if (op == NULL) return 0;
+          // seed the table inside the match so the next one can chain
+          if (mp - 2 > ip) {
+            table[hash(read32(mp - 2))] = (uint32_t)(mp - 2 - base);
+          }
+          ip = anchor = mp;
+        }
+      }
+      op = write_sequence(op, oend, anchor, iend - anchor, false, 0, 0);
+      if (op == NULL) return 0;
+      return op - (unsigned char*)dst;
+    }
+
+
+    bool decompress(const char* src, size_t len, char* dst, size_t dstlen) {
+      const unsigned char* ip = (const unsigned char*)src;
+      const unsigned char* iend = ip + len;
+      unsigned char* op = (unsigned char*)dst;
+      unsigned char* ostart = op;
+      unsigned char* oend = op + dstlen;
+
+      while (ip < iend) {
+        unsigned char token = *ip++;
+        size_t nlit = token >> 4;
+        if (nlit == 15) {
+          unsigned char b;
+          do {
+            if (ip >= iend) return false;
+            b = *ip++;
+            nlit += b;
+          } while (b == 255);
+        }
+        if ((size_t)(iend - ip) < nlit || (size_t)(oend - op) < nlit) {
+          return false;
+        }
+        memcpy(op, ip, nlit);
+        ip += nlit; op += nlit;
+        // the last sequence has literals only
+        if (ip == iend) break;
+
+        if (iend - ip < 2) return false;
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - ostart)) return false;
+        size_t matchlen = token & 15;
+        if (matchlen == 15) {
+          unsigned char b;
+          do {
+            if (ip >= iend) return false;
+            b = *ip++;
+            matchlen += b;
+          } while (b == 255);
+        }
+        matchlen += MINMATCH;
+        if ((size_t)(oend - op) < matchlen) return false;
+        // matches may overlap their own output, so copy bytewise
+        const unsigned char* ref = op - offset;
+        for (size_t i = 0; i < matchlen; ++i) op[i] = ref[i];
+        op += matchlen;
+      }
+      return op == oend;
+    }
+
+  } // namespace lz4
+} // namespace graphlab
@@ -0,0 +1,71 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_LZ4_BLOCK_HPP
+#define GRAPHLAB_LZ4_BLOCK_HPP
+
+#include <cstddef>
+
+
+namespace graphlab {
+
+  /**
+   * \ingroup util_internal
+   * \brief Compression of memory blocks in the LZ4 block format.
+   *
+   * This is a small, dependency free implementation of the LZ4 block
+   * format: a sequence of (literal run, match) pairs, each introduced by
+   * a one byte token and using 16 bit back references. The compressor is
+   * a single pass greedy matcher tuned for speed rather than ratio, since
+   * it is used to shrink RPC buffers on the send path. Output is
+   * compatible with LZ4_decompress_safe() from liblz4, and decompress()
+   * accepts any valid LZ4 block.
+   */
+  namespace lz4 {
+
+    /// Largest possible compressed size of an input of len bytes.
+    inline size_t compress_bound(size_t len) {
+      return len + len / 255 + 16;
+    }
+
+    /**
+     * Compresses len bytes from src into dst, which has room for cap
+     * bytes. Returns the compressed length, or 0 if the output does not
+     * fit in cap bytes. Passing cap >= compress_bound(len) always
+     * succeeds.
+     */
+    size_t compress(const char* src, size_t len, char* dst, size_t cap);
+
+    /**
+     * Decompresses the block of len bytes at src into dst, which must
+     * decompress to exactly dstlen bytes. Returns false if the block is
+     * malformed or does not decompress to dstlen bytes. Never reads or
+     * writes out of bounds.
+     */
+    bool decompress(const char* src, size_t len, char* dst, size_t dstlen);
+
+  } // namespace lz4
+} // namespace graphlab
+
+#endif
@@ -0,0 +1,94 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#include <graphlab/util/mmap_file_range.hpp>
+#include <graphlab/logger/logger.hpp>
+
+
+namespace graphlab {
+
+  mmap_file_range::mmap_file_range() :
+    mapping(NULL), mapping_length(0), data(NULL), length(0) { }
+
+  mmap_file_range::~mmap_file_range() {
+    close();
+  }
+
+  bool mmap_file_range::open(const std::string& filename,
+                             size_t begin, size_t end) {
+    close();
+    if (end <= begin) return true;
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+      logstream(LOG_ERROR) << "Unable to open " << filename
+                           << " for mapping" << std::endl;
+      return false;
+    }
+    // mmap offsets must be page aligned
+    const size_t pagesize = sysconf(_SC_PAGESIZE);
+    const size_t aligned_begin = begin - (begin % pagesize);
+    mapping_length = end - aligned_begin;
+    mapping = mmap(NULL, mapping_length, PROT_READ, MAP_PRIVATE,
+                   fd, aligned_begin);
+    ::close(fd);
+    if (mapping == MAP_FAILED) {
+      logstream(LOG_ERROR) << "Unable to map bytes [" << begin << ", " << end
+                           << ") of " << filename << std::endl;
+      mapping = NULL; mapping_length = 0;
+      return false;
+    }
+    // the range is read front to back exactly once
+    madvise(mapping, mapping_length, MADV_SEQUENTIAL);
+    data = reinterpret_cast<const char*>(mapping) + (begin - aligned_begin);
+    length = end - begin;
+    return true;
+  }
+
+  void mmap_file_range::close() {
+    if (mapping != NULL) munmap(mapping, mapping_length);
+    mapping = NULL; mapping_length = 0;
+    data = NULL; length = 0;
+  }
+
+  bool mmap_file_range::file_size(const std::string& filename, size_t& size) {
+    struct stat st;
+    if (stat(filename.c_str(), &st) != 0) {
+      logstream(LOG_ERROR) << "Unable to stat " << filename << ": "
+                           << strerror(errno) << std::endl;
+      size = 0;
+      return false;
+    }
+    size = st.st_size;
+    return true;
+  }
+
+}; // end of graphlab
@@ -0,0 +1,90 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_MMAP_FILE_RANGE_HPP
+#define GRAPHLAB_MMAP_FILE_RANGE_HPP
+
+#include <string>
+#include <boost/noncopyable.hpp>
+
+
+namespace graphlab {
+
+  /**
+   * \ingroup util_internal
+   * \brief Maps a byte range of a file read-only into memory.
+   *
+   * The mapping is created lazily by the kernel so only the pages which
+   * are actually touched are read. The range [begin, end) may start at
+   * any offset; page alignment is handled internally. The mapping is
+   * released when the object is destroyed.
+   *
+   * \code
+   *   mmap_file_range range;
+   *   size_t size;
+   *   if (mmap_file_range::file_size("graph.tsv", size) &&
+   *       range.open("graph.tsv", 0, size)) {
+   *     const char* ptr = range.begin();
+   *     ...
+   *   }
+   * \endcode
+   */
+  class mmap_file_range : boost::noncopyable {
+   public:
+    mmap_file_range();
+    ~mmap_file_range();
+
+    /**
+     * Maps the bytes [begin, end) of the file. Returns false if the file
+     * could not be opened or mapped. Any previous mapping is released.
+     */
+    bool open(const std::string& filename, size_t begin, size_t end);
+
+    /// Releases the current mapping if any.
+    void close();
+
+    /// Pointer to the first mapped byte of the requested range
+    const char* begin() const { return data; }
+
+    /// Pointer to one past the last mapped byte of the requested range
+    const char* end() const { return data + length; }
+
+    /// Number of bytes in the requested range
+    size_t size() const { return length; }
+
+    /**
+     * Stores the size of a file in bytes in size. Returns false, and logs
+     * the reason, if the file cannot be accessed.
+     */
+    static bool file_size(const std::string& filename, size_t& size);
+
+   private:
+    void* mapping;
+    size_t mapping_length;
+    const char* data;
+    size_t length;
+  }; // end of mmap_file_range
+
+}; // end of graphlab
+#endif
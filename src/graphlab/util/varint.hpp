@@ -0,0 +1,127 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#ifndef GRAPHLAB_VARINT_HPP
+#define GRAPHLAB_VARINT_HPP
+#include <stdint.h>
+#include <cstddef>
+#include <graphlab/util/branch_hints.hpp>
+
+namespace graphlab {
+  /**
+   * \ingroup util_internal
+   * Variable length integer coding. Each byte stores 7 bits of the
+   * value, least significant group first. The high bit of a byte is set
+   * if more bytes follow. Small values (< 128) take a single byte and a
+   * 64 bit value takes at most VARINT_MAX_BYTES bytes.
+   */
+  namespace varint {
+
+    /// The maximum number of bytes used to encode a 64 bit integer
+    static const size_t VARINT_MAX_BYTES = 10;
+
+    /**
+     * Writes v to out and returns a pointer past the last byte written.
+     * out must have room for at least VARINT_MAX_BYTES bytes.
+     */
+    inline unsigned char* encode(uint64_t v, unsigned char* out) {
+      while (v >= 0x80) {
+        *out++ = (unsigned char)(v | 0x80);
+        v >>= 7;
+      }
+      *out++ = (unsigned char)v;
+      return out;
+    }
+
+    /// Returns the number of bytes encode() writes for v
+    inline size_t encoded_size(uint64_t v) {
+      size_t ret = 1;
+      while (v >= 0x80) { v >>= 7; ++ret; }
+      return ret;
+    }
+
+    /**
+     * Reads a value from in and returns a pointer past the last byte read.
+     * Input is trusted: the caller guarantees a complete value is present.
+     */
+    inline const unsigned char* decode(const unsigned char* in, uint64_t& v) {
+      // single byte values are by far the most common case for deltas
+      if (__likely__(*in < 0x80)) {
+        v = *in;
+        return in + 1;
+      }
+      if (in[1] < 0x80) {
+        v = uint64_t(in[0] & 0x7f) | (uint64_t(in[1]) << 7);
+        return in + 2;
+      }
+      uint64_t ret = 0;
+      size_t shift = 0;
+      while (*in & 0x80) {
+        ret |= uint64_t(*in & 0x7f) << shift;
+        shift += 7;
+        ++in;
+      }
+      ret |= uint64_t(*in) << shift;
+      v = ret;
+      return in + 1;
+    }
+
+    /**
+     * Like decode() but never reads at or past end. Returns NULL if the
+     * input ends in the middle of a value.
+     */
+    inline const unsigned char* decode(const unsigned char* in,
+                                       const unsigned char* end,
+                                       uint64_t& v) {
+      uint64_t ret = 0;
+      size_t shift = 0;
+      while (in != end && shift < 64) {
+        const unsigned char c = *in++;
+        ret |= uint64_t(c & 0x7f) << shift;
+        if ((c & 0x80) == 0) {
+          v = ret;
+          return in;
+        }
+        shift += 7;
+      }
+      return NULL;
+    }
+
+    /**
+     * Maps a signed value to an unsigned one so that values of small
+     * magnitude, positive or negative, get small codes:
+     * 0, -1, 1, -2, 2 ... become 0, 1, 2, 3, 4 ...
+     */
+    inline uint64_t zigzag_encode(int64_t v) {
+      return (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+    }
+
+    /// Inverse of zigzag_encode()
+    inline int64_t zigzag_decode(uint64_t v) {
+      return int64_t(v >> 1) ^ -int64_t(v & 1);
+    }
+
+  } // namespace varint
+} // namespace graphlab
+#endif
@@ -20,11 +20,15 @@
  *
  */
 #include <iostream>
+#include <algorithm>
+#include <cstdlib>
 #include <cxxtest/TestSuite.h>
 
 #include <graphlab/util/generics/csr_storage.hpp>
 #include <graphlab/util/generics/dynamic_csr_storage.hpp>
+#include <graphlab/util/generics/delta_csr_storage.hpp>
 #include <graphlab/util/generics/shuffle.hpp>
+#include <graphlab/util/generics/counting_sort.hpp>
 #include <graphlab/logger/assertions.hpp>
 
 class csr_storage_test : public CxxTest::TestSuite {  
@@ -80,6 +84,39 @@ class csr_storage_test : public CxxTest::TestSuite {
     printf("+ Pass test: csr_storage wrap :)\n\n");
   }
 
+  void test_delta_csr_storage() {
+    std::cout << "Test delta_csr_storage encode" << std::endl;
+    std::vector<keytype> keys(get_keyin());
+    std::vector<valuetype> values(get_valin());
+    std::vector<sizetype> permute_index;
+    std::vector<sizetype> prefix;
+
+    graphlab::counting_sort(keys, permute_index, &prefix);
+    graphlab::outofplace_shuffle(values, permute_index);
+
+    graphlab::delta_csr_storage<sizetype> csr;
+    csr.encode(prefix, values);
+    ASSERT_FALSE(csr.has_ids());
+    ASSERT_EQ(csr.num_values(), values.size());
+    check_delta(csr, get_keyout(), get_valout());
+
+    // store the reversed position of each value as its id
+    std::vector<std::pair<valuetype, sizetype> > pairs;
+    for (size_t i = 0; i < values.size(); ++i) {
+      pairs.push_back(std::make_pair(values[i], values.size() - i));
+    }
+    csr.encode(prefix, pairs);
+    ASSERT_TRUE(csr.has_ids());
+    check_delta(csr, get_keyout(), get_valout());
+    for (size_t i = 0; i < csr.num_keys(); ++i) {
+      graphlab::delta_csr_storage<sizetype>::cursor iter = csr.begin(i);
+      for (; !iter.done(); iter.next()) {
+        ASSERT_EQ(iter.id(), values.size() - iter.position());
+      }
+    }
+    printf("+ Pass test: delta_csr_storage encode :)\n\n");
+  }
+
   template<typename csr_type>
   void dynamic_csr_storage_constructor_test() {
     std::cout << "Test dynamic csr_storage constructor" << std::endl;
@@ -176,6 +213,41 @@ class csr_storage_test : public CxxTest::TestSuite {
       stress_insertion_test<dcsr64_t>(982, 294);
   }
 
+  void test_parallel_counting_sort() {
+    std::cout << "Test parallel_counting_sort" << std::endl;
+    // many duplicates: several private histograms
+    parallel_counting_sort_test(100000, 1000);
+    // fewer keys than distinct values: a single block
+    parallel_counting_sort_test(1000, 100000);
+    parallel_counting_sort_test(1, 1);
+    printf("+ Pass test: parallel_counting_sort :)\n\n");
+  }
+
+  void parallel_counting_sort_test(size_t nkeys, size_t range) {
+    std::vector<keytype> keys(nkeys);
+    for (size_t i = 0; i < nkeys; ++i) keys[i] = size_t(std::rand()) % range;
+
+    std::vector<sizetype> permute_index, prefix;
+    graphlab::counting_sort(keys, permute_index, &prefix);
+    std::vector<sizetype> par_permute_index, par_prefix;
+    graphlab::parallel_counting_sort(keys, par_permute_index, &par_prefix);
+
+    // same sorted order and bucket offsets as counting_sort
+    ASSERT_EQ(par_permute_index.size(), nkeys);
+    ASSERT_TRUE(par_prefix == prefix);
+    for (size_t i = 0; i < nkeys; ++i) {
+      ASSERT_EQ(keys[par_permute_index[i]], keys[permute_index[i]]);
+    }
+    // and stable: equal keys keep their input order. Sorting (key, index)
+    // pairs gives the only stable permutation.
+    std::vector<std::pair<keytype, sizetype> > expected(nkeys);
+    for (size_t i = 0; i < nkeys; ++i) expected[i] = std::make_pair(keys[i], i);
+    std::sort(expected.begin(), expected.end());
+    for (size_t i = 0; i < nkeys; ++i) {
+      ASSERT_EQ(par_permute_index[i], expected[i].second);
+    }
+  }
+
 
 
   template<typename csr_type>
@@ -227,6 +299,22 @@ class csr_storage_test : public CxxTest::TestSuite {
           }
         }
       }
+      void check_delta(const graphlab::delta_csr_storage<sizetype>& csr,
+                       std::vector<keytype> keyout,
+                       std::vector<valuetype> valout) {
+        size_t id = 0;
+        for (size_t i = 0; i < csr.num_keys(); ++i) {
+          graphlab::delta_csr_storage<sizetype>::cursor iter = csr.begin(i);
+          ASSERT_EQ(csr.num_values(i), csr.end(i).position() - iter.position());
+          for (; !iter.done(); iter.next()) {
+            ASSERT_EQ(i, keyout[id]);
+            ASSERT_EQ(iter.value(), (size_t)valout[id]);
+            ASSERT_EQ(iter.position(), id);
+            ++id;
+          }
+        }
+        ASSERT_EQ(id, valout.size());
+      }
   template<typename csr_type>
       void check_dcsr(csr_type& csr,
                       size_t nkey,
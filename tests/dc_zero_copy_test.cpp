@@ -0,0 +1,128 @@
+/**
+ * Copyright (c) 2009 Carnegie Mellon University.
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+#include <iostream>
+#include <vector>
+#include <boost/bind.hpp>
+#include <graphlab/rpc/dc.hpp>
+#include <graphlab/util/mpi_tools.hpp>
+#include <graphlab/rpc/dc_init_from_mpi.hpp>
+#include <graphlab/parallel/atomic.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+using namespace graphlab;
+
+/*
+ * One thread sends zero_copy_buffer calls, which are cut into several
+ * pieces in the send buffer, while other threads send small calls to the
+ * same machine. The pieces of a call must reach the wire without calls
+ * of the other threads in between.
+ */
+
+const size_t NUM_BLOCKS = 3000;
+const size_t BLOCK_SIZE = 2 * RPC_ZERO_COPY_THRESHOLD;
+const size_t NUM_SMALL_THREADS = 2;
+const size_t NUM_SMALL_CALLS = 60000;
+// distinct block contents, reused round robin
+const size_t NUM_PATTERNS = 4;
+
+atomic<size_t> blocks_received;
+atomic<size_t> bad_blocks;
+atomic<size_t> small_received[NUM_SMALL_THREADS + 1];
+
+inline char block_byte(size_t block, size_t i) {
+  return char(((block % NUM_PATTERNS) * 7 + i * 131) % 251);
+}
+
+void recv_block(size_t block, zero_copy_buffer buf, size_t check) {
+  bool ok = (check == block * 3 + 1 && buf.size() == BLOCK_SIZE);
+  for (size_t i = 0; ok && i < buf.size(); ++i) {
+    ok = (buf.data()[i] == block_byte(block, i));
+  }
+  if (!ok) bad_blocks.inc();
+  blocks_received.inc();
+}
+
+void recv_small(size_t thread, size_t val, size_t check) {
+  ASSERT_LE(thread, NUM_SMALL_THREADS);
+  ASSERT_EQ(check, val * 3 + thread);
+  small_received[thread].inc();
+}
+
+void send_blocks(distributed_control* dc) {
+  // sent without copying, so they must outlive the sends
+  static std::vector<std::vector<char> > blocks;
+  for (size_t b = 0; b < NUM_PATTERNS; ++b) {
+    blocks.push_back(std::vector<char>(BLOCK_SIZE));
+    for (size_t i = 0; i < BLOCK_SIZE; ++i) blocks[b][i] = block_byte(b, i);
+  }
+  for (size_t b = 0; b < NUM_BLOCKS; ++b) {
+    std::vector<char>& block = blocks[b % NUM_PATTERNS];
+    zero_copy_buffer buf(&block[0], block.size());
+    dc->remote_call(1, recv_block, b, buf, b * 3 + 1);
+    dc->remote_call(1, recv_small, size_t(0), b, b * 3);
+  }
+}
+
+void send_small(distributed_control* dc, size_t thread) {
+  for (size_t i = 0; i < NUM_SMALL_CALLS; ++i) {
+    dc->remote_call(1, recv_small, thread, i, i * 3 + thread);
+  }
+}
+
+
+int main(int argc, char ** argv) {
+  /** Initialization */
+  mpi_tools::init(argc, argv);
+  global_logger().set_log_level(LOG_INFO);
+
+  dc_init_param param;
+  if (init_param_from_mpi(param) == false) {
+    return 0;
+  }
+  distributed_control dc(param);
+  if (dc.numprocs() != 2) {
+    std::cout << "Run with exactly 2 MPI nodes.\n";
+    return 0;
+  }
+  dc.barrier();
+  if (dc.procid() == 0) {
+    thread_group group;
+    group.launch(boost::bind(send_blocks, &dc));
+    for (size_t i = 1; i <= NUM_SMALL_THREADS; ++i) {
+      group.launch(boost::bind(send_small, &dc, i));
+    }
+    group.join();
+  }
+  dc.full_barrier();
+  if (dc.procid() == 1) {
+    ASSERT_EQ(blocks_received.value, NUM_BLOCKS);
+    ASSERT_EQ(bad_blocks.value, 0);
+    ASSERT_EQ(small_received[0].value, NUM_BLOCKS);
+    for (size_t i = 1; i <= NUM_SMALL_THREADS; ++i) {
+      ASSERT_EQ(small_received[i].value, NUM_SMALL_CALLS);
+    }
+    std::cout << "Zero copy calls arrived intact.\n";
+  }
+  dc.barrier();
+  mpi_tools::finalize();
+}
@@ -23,6 +23,7 @@
 
 #include <cxxtest/TestSuite.h>
 #include <graphlab/util/dense_bitset.hpp>
+#include <graphlab/util/compact_bitset.hpp>
 #include <graphlab/macros_def.hpp>
 using namespace graphlab;
 
@@ -158,5 +159,72 @@ public:
   }
 
 
-};
+  void test_compactbitset(void) {
+    // exercise the inline, sorted array and bitmap representations
+    size_t probelocations[12] = {0, 10, 12, 50, 66, 81, 99, 127,
+                                 128, 300, 511, 4000};
+    for (size_t n = 1; n <= 12; ++n) {
+      compact_bitset d;
+      for (size_t i = 0;i < n; ++i) {
+        TS_ASSERT_EQUALS(d.set_bit(probelocations[i]), false);
+        TS_ASSERT_EQUALS(d.set_bit(probelocations[i]), true);
+      }
+      TS_ASSERT_EQUALS(d.popcount(), n);
+      for (size_t i = 0;i < 4096; ++i) {
+        bool inprobe=false;
+        for (size_t j = 0;j < n; ++j) inprobe |= (probelocations[j] == i);
+        TS_ASSERT_EQUALS(d.get(i), inprobe);
+      }
+
+      // test iteration
+      size_t ctr = 0;
+      size_t iter;
+      foreach(iter, d) {
+        TS_ASSERT(ctr < n);
+        TS_ASSERT_EQUALS(iter, probelocations[ctr]);
+        ++ctr;
+      }
+      TS_ASSERT_EQUALS(ctr, n);
+
+      std::stringstream strm;
+      graphlab::oarchive oarc(strm);
+      oarc << d;
+      strm.flush();
+      graphlab::iarchive iarc(strm);
+      compact_bitset d2;
+      d2.set_bit(7);
+      iarc >> d2;
+      TS_ASSERT(d2 == d);
+
+      compact_bitset d3(d);
+      d3.set_bit(7);
+      TS_ASSERT(d3 != d);
+      d3.clear_bit(7);
+      TS_ASSERT(d3 == d);
+
+      // testclearing
+      for (size_t i= 0;i < n; ++i) {
+        TS_ASSERT_EQUALS(d.clear_bit(probelocations[i]), true);
+        TS_ASSERT_EQUALS(d.clear_bit(probelocations[i]), false);
+      }
+      TS_ASSERT(d.empty());
+      TS_ASSERT_EQUALS(d.popcount(), 0);
+      TS_ASSERT_EQUALS(d.heap_memory_usage(), 0);
+    }
 
+    // a handful of machines out of a large cluster is stored inline
+    compact_bitset small;
+    small.set_bit(3); small.set_bit(200); small.set_bit(511);
+    TS_ASSERT_EQUALS(sizeof(small), 8);
+    TS_ASSERT_EQUALS(small.heap_memory_usage(), 0);
+
+    // a dense set is no larger than a bitmap
+    compact_bitset dense;
+    for (size_t i = 0;i < 512; i += 2) dense.set_bit(i);
+    TS_ASSERT_EQUALS(dense.popcount(), 256);
+    TS_ASSERT_LESS_THAN_EQUALS(dense.heap_memory_usage(), 512 / 8 + 16);
+    dense |= small;
+    TS_ASSERT_EQUALS(dense.popcount(), 258);
+  }
+
+};
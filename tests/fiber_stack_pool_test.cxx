@@ -0,0 +1,148 @@
+/*  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <signal.h>
+#include <unistd.h>
+#include <cstring>
+#include <vector>
+#include <boost/bind.hpp>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/parallel/fiber_stack_pool.hpp>
+#include <graphlab/parallel/fiber_control.hpp>
+#include <graphlab/parallel/fiber_group.hpp>
+using namespace graphlab;
+
+static atomic<size_t> fiber_sum;
+
+void stack_user(size_t depth) {
+  // touch a few pages of stack
+  volatile char buf[1024];
+  buf[0] = (char)depth;
+  if (depth > 0) stack_user(depth - 1);
+  fiber_sum.inc(buf[0] >= 0);
+}
+
+class FiberStackPoolTestSuite: public CxxTest::TestSuite {
+ public:
+  void test_rounding() {
+    fiber_stack_pool pool;
+    const size_t pagesize = sysconf(_SC_PAGESIZE);
+    TS_ASSERT_EQUALS(pool.usable_size(1), pagesize);
+    TS_ASSERT_EQUALS(pool.usable_size(pagesize), pagesize);
+    TS_ASSERT_EQUALS(pool.usable_size(pagesize + 1), 2 * pagesize);
+  }
+
+  void test_recycle() {
+    fiber_stack_pool pool;
+    const size_t stacksize = 16384;
+    std::vector<void*> stacks;
+    for (size_t i = 0;i < 8; ++i) {
+      void* s = pool.allocate(stacksize);
+      TS_ASSERT_EQUALS((size_t)s % sysconf(_SC_PAGESIZE), 0);
+      memset(s, (int)i, stacksize);
+      stacks.push_back(s);
+    }
+    TS_ASSERT_EQUALS(pool.misses(), 8);
+    TS_ASSERT_EQUALS(pool.hits(), 0);
+    for (size_t i = 0;i < stacks.size(); ++i) {
+      pool.deallocate(stacks[i], stacksize);
+    }
+    TS_ASSERT_EQUALS(pool.cached_bytes(), 8 * stacksize);
+    // the most recently released stack comes back first
+    TS_ASSERT_EQUALS(pool.allocate(stacksize), stacks.back());
+    TS_ASSERT_EQUALS(pool.hits(), 1);
+    // a different size does not reuse the cached stacks
+    void* other = pool.allocate(2 * stacksize);
+    TS_ASSERT_EQUALS(pool.misses(), 9);
+    pool.deallocate(other, 2 * stacksize);
+    pool.deallocate(stacks.back(), stacksize);
+  }
+
+  void test_cold_and_capacity() {
+    const size_t pagesize = sysconf(_SC_PAGESIZE);
+    const size_t stacksize = 4 * pagesize;
+    // two warm stacks, at most four cached
+    fiber_stack_pool pool(2 * stacksize, 4 * stacksize);
+    std::vector<void*> stacks;
+    for (size_t i = 0;i < 6; ++i) {
+      stacks.push_back(pool.allocate(stacksize));
+      memset(stacks[i], 1, stacksize);
+    }
+    for (size_t i = 0;i < stacks.size(); ++i) {
+      pool.deallocate(stacks[i], stacksize);
+    }
+    TS_ASSERT_EQUALS(pool.cached_bytes(), 4 * stacksize);
+    // warm stacks are handed out before released ones
+    TS_ASSERT_EQUALS(pool.allocate(stacksize), stacks[1]);
+    TS_ASSERT_EQUALS(pool.allocate(stacksize), stacks[0]);
+    // released stacks are still usable
+    for (size_t i = 0;i < 2; ++i) {
+      char* s = (char*)pool.allocate(stacksize);
+      memset(s, 2, stacksize);
+      TS_ASSERT_EQUALS(s[0], 2);
+      pool.deallocate(s, stacksize);
+    }
+    TS_ASSERT_EQUALS(pool.hits(), 4);
+    TS_ASSERT_EQUALS(pool.misses(), 6);
+    pool.deallocate(stacks[0], stacksize);
+    pool.deallocate(stacks[1], stacksize);
+  }
+
+  void test_guard_page() {
+    fiber_stack_pool pool;
+    char* s = (char*)pool.allocate(8192);
+    pid_t pid = fork();
+    if (pid == 0) {
+      // overflowing the bottom of the stack must fault
+      signal(SIGSEGV, SIG_DFL);
+      *(volatile char*)(s - 1) = 1;
+      _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    TS_ASSERT(WIFSIGNALED(status));
+    if (WIFSIGNALED(status)) TS_ASSERT_EQUALS(WTERMSIG(status), SIGSEGV);
+    pool.deallocate(s, 8192);
+  }
+
+  void test_fibers() {
+    fiber_control& fc = fiber_control::get_instance();
+    size_t hits = fc.stack_pool_hits();
+    size_t misses = fc.stack_pool_misses();
+    for (size_t round = 0; round < 4; ++round) {
+      fiber_group group(16384);
+      for (size_t i = 0;i < 100; ++i) {
+        group.launch(boost::bind(stack_user, 8));
+      }
+      group.join();
+    }
+    TS_ASSERT_EQUALS(fiber_sum.value, 4 * 100 * 9);
+    TS_ASSERT_EQUALS(fc.stack_pool_hits() + fc.stack_pool_misses(),
+                     hits + misses + 400);
+    // later rounds reuse the stacks of earlier ones
+    TS_ASSERT_LESS_THAN(fc.stack_pool_misses() - misses, 400);
+  }
+};
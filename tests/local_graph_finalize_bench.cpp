@@ -0,0 +1,162 @@
+/**  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+/**
+ * Benchmark for local_graph::finalize and dynamic_local_graph::finalize.
+ * Builds a random power-law edge list, finalizes it into both graph
+ * types and reports the throughput in edges per second. The serial
+ * (atomic) and parallel counting sorts are also timed on their own, and
+ * a gather over all in edges is timed for the plain, the CSC ordered,
+ * the delta compressed and the degree and RCM renumbered local_graph.
+ *
+ * Usage: local_graph_finalize_bench [nverts] [nedges]
+ */
+
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+#include <graphlab/graph/local_graph.hpp>
+#include <graphlab/graph/dynamic_local_graph.hpp>
+#include <graphlab/util/generics/counting_sort.hpp>
+#include <graphlab/util/random.hpp>
+#include <graphlab/util/timer.hpp>
+#include <graphlab/logger/logger.hpp>
+#include <graphlab/macros_def.hpp>
+
+typedef graphlab::vertex_id_type vertex_id_type;
+
+void report(const std::string& name, size_t nedges, double secs) {
+  std::cout << name << ": " << secs << " secs, "
+            << (secs > 0 ? nedges / secs : 0) << " edges/sec" << std::endl;
+}
+
+/// Sums the edge data of the in edges of every vertex, like a gather.
+template <typename Graph>
+void bench_gather(const std::string& name, Graph& g) {
+  typedef typename Graph::edge_type edge_type;
+  graphlab::timer ti; ti.start();
+  size_t total = 0;
+#ifdef _OPENMP
+#pragma omp parallel for reduction(+:total) schedule(dynamic, 1024)
+#endif
+  for (ssize_t v = 0; v < ssize_t(g.num_vertices()); ++v) {
+    foreach(const edge_type& e, g.in_edges(v)) total += e.data();
+  }
+  report(name, g.num_edges(), ti.current_time());
+  ASSERT_EQ(total, g.num_edges() * (g.num_edges() - 1) / 2);
+}
+
+template <typename Graph>
+void add_edges(Graph& g, size_t nverts,
+               const std::vector<vertex_id_type>& src,
+               const std::vector<vertex_id_type>& dst) {
+  g.resize(nverts);
+  g.reserve_edge_space(src.size());
+  for (size_t i = 0; i < src.size(); ++i) g.add_edge(src[i], dst[i], i);
+}
+
+template <typename Graph>
+void bench_finalize(const std::string& name, Graph& g, size_t nedges) {
+  graphlab::timer ti; ti.start();
+  g.finalize();
+  report(name, nedges, ti.current_time());
+  ASSERT_EQ(g.num_edges(), nedges);
+}
+
+int main(int argc, char** argv) {
+  global_logger().set_log_level(LOG_WARNING);
+  const size_t nverts = argc > 1 ? atol(argv[1]) : 1000000;
+  const size_t nedges = argc > 2 ? atol(argv[2]) : 20000000;
+  std::cout << "Generating " << nedges << " edges over "
+            << nverts << " vertices" << std::endl;
+
+  // Power-law sources, uniform targets, no self edges.
+  graphlab::random::seed(0);
+  std::vector<vertex_id_type> src(nedges), dst(nedges);
+  for (size_t i = 0; i < nedges; ++i) {
+    const double u = graphlab::random::rand01();
+    src[i] = std::min<size_t>(nverts - 1, size_t(nverts * u * u * u));
+    do {
+      dst[i] = graphlab::random::fast_uniform<size_t>(0, nverts - 1);
+    } while (dst[i] == src[i]);
+  }
+
+  std::vector<size_t> permute, prefix;
+  graphlab::timer ti; ti.start();
+  graphlab::counting_sort(src, permute, &prefix);
+  report("counting_sort", nedges, ti.current_time());
+  ti.start();
+  graphlab::parallel_counting_sort(src, permute, &prefix);
+  report("parallel_counting_sort", nedges, ti.current_time());
+
+  {
+    graphlab::local_graph<size_t, size_t> g;
+    add_edges(g, nverts, src, dst);
+    bench_finalize("local_graph::finalize", g, nedges);
+    bench_gather("local_graph gather", g);
+  }
+  {
+    graphlab::local_graph<size_t, size_t> g;
+    g.set_csc_edge_order(true);
+    add_edges(g, nverts, src, dst);
+    bench_finalize("csc ordered local_graph::finalize", g, nedges);
+    bench_gather("csc ordered local_graph gather", g);
+  }
+  {
+    graphlab::local_graph<size_t, size_t> g;
+    g.set_compression(true);
+    add_edges(g, nverts, src, dst);
+    bench_finalize("compressed local_graph::finalize", g, nedges);
+    bench_gather("compressed local_graph gather", g);
+  }
+  {
+    graphlab::local_graph<size_t, size_t> g;
+    add_edges(g, nverts, src, dst);
+    std::vector<graphlab::lvid_type> new_lvid;
+    ti.start();
+    g.reorder_vertices(graphlab::vertex_ordering::DEGREE, new_lvid);
+    report("degree ordering", nedges, ti.current_time());
+    bench_finalize("degree ordered local_graph::finalize", g, nedges);
+    bench_gather("degree ordered local_graph gather", g);
+  }
+  {
+    graphlab::local_graph<size_t, size_t> g;
+    add_edges(g, nverts, src, dst);
+    std::vector<graphlab::lvid_type> new_lvid;
+    ti.start();
+    g.reorder_vertices(graphlab::vertex_ordering::RCM, new_lvid);
+    report("rcm ordering", nedges, ti.current_time());
+    bench_finalize("rcm ordered local_graph::finalize", g, nedges);
+    bench_gather("rcm ordered local_graph gather", g);
+  }
+  {
+    graphlab::dynamic_local_graph<size_t, size_t> g;
+    add_edges(g, nverts, src, dst);
+    bench_finalize("dynamic_local_graph::finalize", g, nedges);
+    bench_gather("dynamic_local_graph gather", g);
+  }
+  return EXIT_SUCCESS;
+}
+
+#include <graphlab/macros_undef.hpp>
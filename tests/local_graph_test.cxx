@@ -23,6 +23,7 @@
 
 // standard C++ headers
 #include <iostream>
+#include <sstream>
 #include <cxxtest/TestSuite.h>
 
 // includes the entire graphlab framework
@@ -48,6 +49,11 @@ public:
     edge_data (int f = 0, int t = 0) : from(f), to(t) {}
   };
 
+  struct named_edge_data {
+    std::string name;
+    named_edge_data(const std::string& name = "") : name(name) { }
+  };
+
   /**
    * Test add vertex and add edges
    */
@@ -86,6 +92,68 @@ public:
     std::cout << "\n+ Pass test: graph dynamicly add edge. :) \n";
   }
 
+  void test_spilled_add_edge() {
+    // a tiny budget forces the edge buffer to spill several runs
+    graphlab::local_graph<vertex_data, edge_data> g;
+    g.set_edge_buffer_budget(4096, "/tmp");
+    test_add_edge_impl(g, 10000);
+    graphlab::dynamic_local_graph<vertex_data, edge_data> g2;
+    g2.set_edge_buffer_budget(4096, "/tmp");
+    test_add_edge_impl(g2, 10000);
+    test_add_edge_impl(g2, 10000, true);
+    std::cout << "\n+ Pass test: spilled graph add edge. :) \n";
+  }
+
+  void test_unserializable_edge_data() {
+    // edge data without save() / load() is fine as long as nothing spills
+    graphlab::local_graph<vertex_data, named_edge_data> g;
+    g.add_vertex(2);
+    g.add_edge(0, 1, named_edge_data("a"));
+    g.add_edge(1, 2, named_edge_data("b"));
+    g.finalize();
+    ASSERT_EQ(g.num_edges(), 2);
+    ASSERT_TRUE((*g.out_edges(1).begin()).data().name == "b");
+    std::cout << "\n+ Pass test: unserializable edge data. :) \n";
+  }
+
+  void test_compressed_graph() {
+    graphlab::local_graph<vertex_data, edge_data> g;
+    g.set_compression(true);
+    test_add_edge_impl(g, 10000);
+    test_powerlaw_graph_impl(g, 10000);
+    ASSERT_TRUE(g.is_compressed());
+    // spilled edges take a different path through finalize
+    g.set_edge_buffer_budget(4096, "/tmp");
+    test_add_edge_impl(g, 10000);
+    std::cout << "\n+ Pass test: compressed graph. :) \n";
+  }
+
+  void test_csc_edge_order() {
+    graphlab::local_graph<vertex_data, edge_data> g;
+    g.set_csc_edge_order(true);
+    test_add_edge_impl(g, 10000);
+    test_powerlaw_graph_impl(g, 10000);
+    ASSERT_TRUE(g.is_csc_edge_order());
+    g.clear();
+    g.set_compression(true);
+    test_add_edge_impl(g, 10000);
+    g.set_edge_buffer_budget(4096, "/tmp");
+    test_add_edge_impl(g, 10000);
+    std::cout << "\n+ Pass test: csc edge order graph. :) \n";
+  }
+
+  void test_reorder_vertices() {
+    graphlab::local_graph<vertex_data, edge_data> g;
+    graphlab::dynamic_local_graph<vertex_data, edge_data> g2;
+    test_reorder_vertices_impl(g, graphlab::vertex_ordering::DEGREE, 10000);
+    test_reorder_vertices_impl(g, graphlab::vertex_ordering::RCM, 10000);
+    g.set_edge_buffer_budget(4096, "/tmp");
+    test_reorder_vertices_impl(g, graphlab::vertex_ordering::RCM, 10000);
+    test_reorder_vertices_impl(g2, graphlab::vertex_ordering::DEGREE, 10000);
+    test_reorder_vertices_impl(g2, graphlab::vertex_ordering::RCM, 10000);
+    std::cout << "\n+ Pass test: reorder vertices. :) \n";
+  }
+
   void test_powerlaw_graph() {
     graphlab::local_graph<vertex_data, edge_data> g;
     graphlab::dynamic_local_graph<vertex_data, edge_data> g2;
@@ -131,7 +199,70 @@ public:
     std::cout << "\n+ Pass test: grid dynamic graph test. :) \n";
   }
 
+  void test_save_load() {
+    typedef graphlab::local_graph<size_t, double> graph_type;
+    typedef graphlab::vertex_id_type vertex_id_type;
+    graph_type g;
+    g.set_compression(true);
+    g.add_vertex(3, 3);
+    g.add_edge(0, 1, 1.0);
+    g.add_edge(0, 2, 2.0);
+    g.add_edge(2, 3, 3.0);
+    g.finalize();
+    std::stringstream strm;
+    graphlab::oarchive oarc(strm);
+    oarc << g;
+    strm.flush();
+    graph_type g2;
+    graphlab::iarchive iarc(strm);
+    iarc >> g2;
+    test_save_load_impl(g2);
+    ASSERT_TRUE(g2.is_compressed());
+
+    // The unversioned layout with ids as wide as vertex_id_type
+    std::vector<vertex_id_type> src, dst;
+    std::vector<std::pair<vertex_id_type, vertex_id_type> > csc_value;
+    src.push_back(0); dst.push_back(1);
+    src.push_back(0); dst.push_back(2);
+    src.push_back(2); dst.push_back(3);
+    for (size_t i = 0; i < src.size(); ++i)
+      csc_value.push_back(std::make_pair(src[i], vertex_id_type(i)));
+    std::stringstream oldstrm;
+    graphlab::oarchive oldoarc(oldstrm);
+    oldoarc << std::vector<size_t>(4, 0)
+            << std::vector<double>(3, 1.0)
+            << graphlab::csr_storage<vertex_id_type, vertex_id_type>(src, dst)
+            << graphlab::csr_storage<std::pair<vertex_id_type, vertex_id_type>,
+                                     vertex_id_type>(dst, csc_value)
+            << true;
+    oldstrm.flush();
+    graph_type g3;
+    graphlab::iarchive oldiarc(oldstrm);
+    oldiarc >> g3;
+    ASSERT_FALSE(g3.is_compressed());
+    ASSERT_EQ(g3.num_vertices(), 4);
+    ASSERT_EQ(g3.num_out_edges(0), 2);
+    ASSERT_EQ(g3.num_out_edges(3), 0);
+    ASSERT_EQ(g3.num_in_edges(3), 1);
+    ASSERT_EQ((*g3.in_edges(3).begin()).source().id(), 2);
+    std::cout << "\n+ Pass test: save and load graph. :) \n";
+  }
+
 private: 
+  void test_save_load_impl(graphlab::local_graph<size_t, double>& g) {
+    typedef graphlab::local_graph<size_t, double> graph_type;
+    ASSERT_EQ(g.num_vertices(), 4);
+    ASSERT_EQ(g.num_edges(), 3);
+    ASSERT_EQ(g.vertex_data(3), 3);
+    double sum = 0;
+    foreach(const graph_type::edge_type& e, g.out_edges(0)) {
+      ASSERT_EQ(e.source().id(), 0);
+      sum += e.data();
+    }
+    ASSERT_EQ(sum, 3.0);
+    ASSERT_EQ(g.num_in_edges(3), 1);
+  }
+
   template<typename Graph>
   void test_add_vertex_impl(Graph& g, size_t nverts) {
     g.clear();
@@ -272,7 +403,65 @@ template<typename Graph>
     check_edge_data(g);
   }
 
-  
+
+  /**
+   * Renumbers a random graph whose vertex data holds the original vertex
+   * id and whose edge data holds the original endpoints, and checks that
+   * every vertex and edge moved to its new id.
+   */
+  template<typename Graph>
+  void test_reorder_vertices_impl(Graph& g,
+                                  graphlab::vertex_ordering::method_type method,
+                                  size_t nedges) {
+    typedef typename Graph::edge_list_type edge_list_type;
+    typedef typename Graph::edge_type edge_type;
+    srand(0);
+    g.clear();
+    const size_t nverts = 3 * sqrt(nedges);
+    for (size_t i = 0; i < nverts; ++i) g.add_vertex(i, vertex_data(i));
+    boost::unordered_set< std::pair<size_t, size_t> > all_edges;
+    while (all_edges.size() < nedges) {
+      size_t src = rand() % nverts;
+      size_t dst = rand() % nverts;
+      if (src == dst || all_edges.count(std::make_pair(src, dst))) continue;
+      all_edges.insert(std::make_pair(src, dst));
+      g.add_edge(src, dst, edge_data(src, dst));
+    }
+    std::vector<graphlab::lvid_type> new_lvid;
+    g.reorder_vertices(method, new_lvid);
+    g.finalize();
+    ASSERT_EQ(new_lvid.size(), nverts);
+    ASSERT_EQ(g.num_edges(), nedges);
+    std::vector<size_t> old_lvid(nverts, size_t(-1));
+    for (size_t i = 0; i < nverts; ++i) {
+      ASSERT_LT(new_lvid[i], nverts);
+      ASSERT_EQ(old_lvid[new_lvid[i]], size_t(-1));
+      old_lvid[new_lvid[i]] = i;
+    }
+    size_t count = 0;
+    size_t last_degree = size_t(-1);
+    for (size_t i = 0; i < nverts; ++i) {
+      ASSERT_EQ(g.vertex(i).data().value, old_lvid[i]);
+      const edge_list_type& out_edges = g.out_edges(i);
+      foreach (const edge_type& e, out_edges) {
+        ASSERT_EQ(size_t(e.data().from), old_lvid[e.source().id()]);
+        ASSERT_EQ(size_t(e.data().to), old_lvid[e.target().id()]);
+        ++count;
+      }
+      const edge_list_type& in_edges = g.in_edges(i);
+      foreach (const edge_type& e, in_edges) {
+        ASSERT_EQ(size_t(e.data().from), old_lvid[e.source().id()]);
+        ASSERT_EQ(size_t(e.data().to), old_lvid[e.target().id()]);
+      }
+      const size_t degree = g.num_in_edges(i) + g.num_out_edges(i);
+      if (method == graphlab::vertex_ordering::DEGREE) {
+        ASSERT_LE(degree, last_degree);
+      }
+      last_degree = degree;
+    }
+    ASSERT_EQ(count, nedges);
+  }
+
   template<typename Graph>
   void test_edge_case_impl(Graph& g) {
     // TODO: 
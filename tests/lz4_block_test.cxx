@@ -0,0 +1,101 @@
+/*  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+
+
+
+#include <vector>
+#include <string>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <cxxtest/TestSuite.h>
+
+#include <graphlab/util/lz4_block.hpp>
+
+using namespace graphlab;
+
+class test_lz4_block : public CxxTest::TestSuite {
+public:
+
+  // compresses and decompresses data, returning the compressed length
+  size_t roundtrip(const std::string& data) {
+    std::vector<char> compressed(lz4::compress_bound(data.size()));
+    size_t clen = lz4::compress(data.c_str(), data.size(),
+                                &compressed[0], compressed.size());
+    TS_ASSERT(clen > 0);
+    std::vector<char> out(data.size() + 1);
+    TS_ASSERT(lz4::decompress(&compressed[0], clen, &out[0], data.size()));
+    TS_ASSERT_EQUALS(std::string(&out[0], data.size()), data);
+    // the decompressed length must match exactly
+    TS_ASSERT(!lz4::decompress(&compressed[0], clen, &out[0], data.size() + 1));
+    return clen;
+  }
+
+  void test_roundtrip() {
+    std::cout << std::endl;
+    std::cout << "Testing LZ4 round trips" << std::endl;
+    roundtrip("");
+    roundtrip("a");
+    roundtrip("hello world");
+    // repetitive input must shrink
+    std::string text;
+    for (size_t i = 0; i < 2000; ++i) text += "vertex " + std::string(i % 7 + 1, 'x');
+    TS_ASSERT_LESS_THAN(roundtrip(text), text.size() / 4);
+    // a long run, which needs the extended length encoding
+    TS_ASSERT_LESS_THAN(roundtrip(std::string(100000, 'z')), size_t(1000));
+    // random input may grow, but stays within the bound
+    srand(1);
+    std::string noise(70000, ' ');
+    for (size_t i = 0; i < noise.size(); ++i) noise[i] = (char)rand();
+    TS_ASSERT(roundtrip(noise) <= lz4::compress_bound(noise.size()));
+  }
+
+  void test_small_output() {
+    std::cout << "Testing LZ4 with insufficient output space" << std::endl;
+    srand(2);
+    std::string noise(4096, ' ');
+    for (size_t i = 0; i < noise.size(); ++i) noise[i] = (char)rand();
+    std::vector<char> out(noise.size() - noise.size() / 8);
+    TS_ASSERT_EQUALS(lz4::compress(noise.c_str(), noise.size(),
+                                   &out[0], out.size()), size_t(0));
+  }
+
+  void test_corrupt_input() {
+    std::cout << "Testing LZ4 with corrupt input" << std::endl;
+    std::string text;
+    for (size_t i = 0; i < 500; ++i) text += "edge data ";
+    std::vector<char> compressed(lz4::compress_bound(text.size()));
+    size_t clen = lz4::compress(text.c_str(), text.size(),
+                                &compressed[0], compressed.size());
+    std::vector<char> out(text.size());
+    // truncated input
+    TS_ASSERT(!lz4::decompress(&compressed[0], clen - 1, &out[0], text.size()));
+    // flipped bytes must never read or write out of bounds
+    srand(3);
+    for (size_t i = 0; i < 1000; ++i) {
+      std::vector<char> bad(compressed.begin(), compressed.begin() + clen);
+      bad[rand() % clen] ^= (char)(1 + rand() % 255);
+      lz4::decompress(&bad[0], clen, &out[0], text.size());
+    }
+  }
+};
@@ -0,0 +1,163 @@
+/*  
+ * Copyright (c) 2009 Carnegie Mellon University. 
+ *     All rights reserved.
+ *
+ *  Licensed under the Apache License, Version 2.0 (the "License");
+ *  you may not use this file except in compliance with the License.
+ *  You may obtain a copy of the License at
+ *
+ *      http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *  Unless required by applicable law or agreed to in writing,
+ *  software distributed under the License is distributed on an "AS
+ *  IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either
+ *  express or implied.  See the License for the specific language
+ *  governing permissions and limitations under the License.
+ *
+ * For more about this software visit:
+ *
+ *      http://www.graphlab.ml.cmu.edu
+ *
+ */
+#include <vector>
+#include <iostream>
+#include <boost/bind.hpp>
+#include <cxxtest/TestSuite.h>
+#include <graphlab/engine/message_array.hpp>
+#include <graphlab/parallel/pthread_tools.hpp>
+#include <graphlab/util/random.hpp>
+#include <graphlab/util/timer.hpp>
+using namespace graphlab;
+
+// packed into a single word
+struct small_message {
+  float value;
+  small_message(float value = 0): value(value) { }
+  small_message& operator+=(const small_message& other) {
+    value += other.value;
+    return *this;
+  }
+  double priority() const { return value; }
+};
+
+// combined with a compare and swap on a word of its own
+struct medium_message {
+  double value;
+  medium_message(double value = 0): value(value) { }
+  medium_message& operator+=(const medium_message& other) {
+    value += other.value;
+    return *this;
+  }
+  double priority() const { return value; }
+};
+
+// goes through the busy state
+struct large_message {
+  double value;
+  std::vector<int> history;
+  large_message(double value = 0): value(value) { }
+  large_message& operator+=(const large_message& other) {
+    value += other.value;
+    return *this;
+  }
+  double priority() const { return value; }
+};
+
+const size_t NUM_VERTICES = 1000;
+const size_t NUM_THREADS = 4;
+const size_t ADDS_PER_THREAD = 200000;
+
+template <typename MessageType>
+void add_messages(message_array<MessageType>& messages, double& consumed) {
+  consumed = 0;
+  for (size_t i = 0; i < ADDS_PER_THREAD; ++i) {
+    size_t idx = random::fast_uniform<size_t>(0, NUM_VERTICES - 1);
+    messages.add(idx, MessageType(1));
+    // every so often take a message out, like the engine does
+    if (i % 4 == 0) {
+      MessageType m;
+      idx = random::fast_uniform<size_t>(0, NUM_VERTICES - 1);
+      if (messages.get(idx, m)) consumed += m.value;
+    }
+  }
+}
+
+template <typename MessageType>
+void test_message_conservation() {
+  message_array<MessageType> messages(NUM_VERTICES);
+  std::vector<double> consumed(NUM_THREADS, 0);
+  timer ti; ti.start();
+  thread_group group;
+  for (size_t i = 0; i < NUM_THREADS; ++i) {
+    group.launch(boost::bind(add_messages<MessageType>,
+                             boost::ref(messages), boost::ref(consumed[i])));
+  }
+  group.join();
+  double runtime = ti.current_time();
+  // every message added is either consumed or still in the array
+  double total = 0;
+  for (size_t i = 0; i < NUM_THREADS; ++i) total += consumed[i];
+  for (size_t i = 0; i < NUM_VERTICES; ++i) {
+    MessageType m;
+    if (messages.get(i, m)) total += m.value;
+  }
+  TS_ASSERT_EQUALS(total, double(NUM_THREADS * ADDS_PER_THREAD));
+  TS_ASSERT_EQUALS(messages.num_adds(), NUM_THREADS * ADDS_PER_THREAD);
+  TS_ASSERT(messages.empty());
+  std::cout << "\n" << NUM_THREADS * ADDS_PER_THREAD / runtime 
+            << " adds per second" << std::endl;
+}
+
+class MessageArrayTestSuite : public CxxTest::TestSuite {
+public:
+  void test_single_threaded() {
+    message_array<small_message> messages(10);
+    double priority = 0;
+    TS_ASSERT(messages.empty());
+    TS_ASSERT(messages.add(3, small_message(1), &priority));
+    TS_ASSERT_EQUALS(priority, 1.0);
+    TS_ASSERT(!messages.add(3, small_message(2), &priority));
+    TS_ASSERT_EQUALS(priority, 3.0);
+    TS_ASSERT_EQUALS(messages.num_joins(), 1);
+    small_message m;
+    TS_ASSERT(messages.peek(3, m));
+    TS_ASSERT_EQUALS(m.value, 3.0);
+    TS_ASSERT(messages.get(3, m));
+    TS_ASSERT_EQUALS(m.value, 3.0);
+    TS_ASSERT(!messages.get(3, m));
+    TS_ASSERT(messages.empty(3));
+
+    message_array<medium_message> medium(10);
+    TS_ASSERT(medium.add(2, medium_message(1.5), &priority));
+    TS_ASSERT(!medium.add(2, medium_message(2), &priority));
+    TS_ASSERT_EQUALS(priority, 3.5);
+    medium_message mm;
+    TS_ASSERT(medium.peek(2, mm));
+    TS_ASSERT_EQUALS(mm.value, 3.5);
+    TS_ASSERT(medium.get(2, mm));
+    TS_ASSERT_EQUALS(mm.value, 3.5);
+    TS_ASSERT(!medium.get(2, mm));
+    TS_ASSERT(medium.add(7, medium_message(1), &priority));
+    medium.clear(7);
+    TS_ASSERT(medium.empty());
+
+    message_array<large_message> large(10);
+    TS_ASSERT(large.add(5, large_message(1), &priority));
+    TS_ASSERT(!large.add(5, large_message(1), &priority));
+    TS_ASSERT_EQUALS(priority, 2.0);
+    large.clear(5);
+    TS_ASSERT(large.empty());
+  }
+
+  void test_parallel_packed() {
+    test_message_conservation<small_message>();
+  }
+
+  void test_parallel_wide() {
+    test_message_conservation<medium_message>();
+  }
+
+  void test_parallel_unpacked() {
+    test_message_conservation<large_message>();
+  }
+};
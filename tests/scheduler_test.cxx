@@ -26,6 +26,8 @@
 #include <graphlab/scheduler/scheduler_includes.hpp>
 #include <graphlab/rpc/async_consensus.hpp>
 #include <graphlab/parallel/atomic.hpp>
+#include <graphlab/parallel/fiber_group.hpp>
+#include <graphlab/util/timer.hpp>
 #include <cxxtest/TestSuite.h>
 
 
@@ -33,23 +35,6 @@ using namespace graphlab;
 
 distributed_control dc;
 
-struct message_type {
-  int value;
-  double pr;
-
-  explicit message_type(int value = 0, double pr = 0):value(value),pr(pr) { }
-  
-  double priority() const {
-    return pr;
-  }
-  message_type& operator+=(const message_type& other) {
-    value += other.value;
-    pr = other.value;
-    return *this;
-  }
-};
-
-
 const size_t NCPUS = 4;
 const size_t NUM_VERTICES = 101;
 std::vector<atomic<int> > correctness_counter;
@@ -62,34 +47,34 @@ void test_scheduler_basic_functionality_single_threaded() {
   SchedulerType sched(NUM_VERTICES, opts);
   const size_t target_value = 100;
   
-  // inject a sequence of messages which will sum to 100 per vertex
+  // scheduling a vertex repeatedly before it runs only runs it once
   for (size_t c = 0;c < target_value; ++c) {
     for (size_t i = 0; i < NUM_VERTICES; ++i) {
-      sched.schedule(i, message_type(1, 1.0));
+      sched.schedule(i, 1.0);
     }
   }
   correctness_counter.clear();
   correctness_counter.resize(NUM_VERTICES, atomic<int>(0));
-  sched.start();
   
   // pull stuff out
   bool allcpus_done = false; 
   while(!allcpus_done) {
     allcpus_done = true;
     for (size_t i = 0; i < NCPUS; ++i) {
-      vertex_id_type v; message_type m;
-      sched_status::status_enum ret = sched.get_next(i, v, m);
+      lvid_type v;
+      sched_status::status_enum ret = sched.get_next(i, v);
       if (ret == sched_status::NEW_TASK) {
         allcpus_done = false;
-        correctness_counter[v].inc(m.value);
+        correctness_counter[v].inc();
       }
     }
   }
 
   // check the counters
   for(size_t i = 0; i < NUM_VERTICES; ++i) {
-    TS_ASSERT_EQUALS(correctness_counter[i].value, (int)target_value);
+    TS_ASSERT_EQUALS(correctness_counter[i].value, 1);
   }
+  TS_ASSERT(sched.empty());
 }
 
 
@@ -102,13 +87,13 @@ void test_basic_functionality_thread(SchedulerType& sched,
                                      size_t schedule_count,
                                      size_t threadid) {
   size_t c = 0;
-  vertex_id_type v; message_type m;
+  lvid_type v;
   while(1) {
     // process as many tasks as I can
     while(1) {
-      sched_status::status_enum ret = sched.get_next(threadid, v, m);
+      sched_status::status_enum ret = sched.get_next(threadid, v);
       if (ret == sched_status::NEW_TASK) {
-        correctness_counter[v].inc(m.value);
+        correctness_counter[v].inc();
       }
       else {
         break;
@@ -118,7 +103,7 @@ void test_basic_functionality_thread(SchedulerType& sched,
     // schedule 1 cycle. If I schedule stuff I go back to processing tasks
     if (c < schedule_count) {
       for (size_t i = 0; i < NUM_VERTICES; ++i) {
-        sched.schedule(i, message_type(1, 1.0));
+        sched.schedule(i, 1.0);
         consensus.cancel();
       }
       ++c;
@@ -127,11 +112,11 @@ void test_basic_functionality_thread(SchedulerType& sched,
     
     // nothing to schedule, nothing to run. try to quit
     consensus.begin_done_critical_section(threadid);
-    sched_status::status_enum ret = sched.get_next(threadid, v, m);
+    sched_status::status_enum ret = sched.get_next(threadid, v);
     if (ret == sched_status::NEW_TASK) {
       // there is task. cancel, process it, and look back
       consensus.cancel_critical_section(threadid);
-      correctness_counter[v].inc(m.value);
+      correctness_counter[v].inc();
     }
     else {
       // no more tasks try to finish up
@@ -150,16 +135,15 @@ void test_scheduler_basic_functionality_parallel() {
   async_consensus consensus(dc, NCPUS);
   
   const size_t schedule_count = 10000;
-  const size_t target_value = schedule_count * NCPUS + 1;
+  // every vertex runs at least once and never more often than scheduled
+  const size_t maximum_value = schedule_count * NCPUS + 1;
 
   correctness_counter.clear();
   correctness_counter.resize(NUM_VERTICES, atomic<int>(0));
 
-  // inject a sequence of messages which will sum to 100 per vertex
   for (size_t i = 0; i < NUM_VERTICES; ++i) {
-    sched.schedule(i, message_type(1, 1.0));
+    sched.schedule(i, 1.0);
   }
-  sched.start();
   
   thread_group group;
   for (size_t i = 0;i < NCPUS;++i) {
@@ -170,126 +154,157 @@ void test_scheduler_basic_functionality_parallel() {
   group.join();
   // check the counters
   for(size_t i = 0; i < NUM_VERTICES; ++i) {
-    TS_ASSERT_EQUALS(correctness_counter[i].value, (int)target_value);
+    TS_ASSERT_LESS_THAN_EQUALS(1, correctness_counter[i].value);
+    TS_ASSERT_LESS_THAN_EQUALS(correctness_counter[i].value, (int)maximum_value);
+  }
+  TS_ASSERT(sched.empty());
+}
+
+
+
+
+/*
+ * Vertices scheduled below the minimum priority are never returned.
+ */
+void test_scheduler_min_priority_single_threaded() {
+  graphlab_options opts;
+  opts.set_ncpus(NCPUS);
+  opts.get_scheduler_args().set_option("min_priority", 100.0);
+  priority_scheduler sched(NUM_VERTICES, opts);
+
+  for (size_t i = 0; i < NUM_VERTICES; ++i) {
+    sched.schedule(i, i < NUM_VERTICES / 2 ? 1.0 : 101.0);
+  }
+  size_t popped = 0;
+  bool allcpus_done = false; 
+  while(!allcpus_done) {
+    allcpus_done = true;
+    for (size_t i = 0; i < NCPUS; ++i) {
+      lvid_type v;
+      if (sched.get_next(i, v) == sched_status::NEW_TASK) {
+        allcpus_done = false;
+        TS_ASSERT_LESS_THAN_EQUALS(NUM_VERTICES / 2, v);
+        ++popped;
+      }
+    }
   }
+  TS_ASSERT_EQUALS(popped, NUM_VERTICES - NUM_VERTICES / 2);
 }
 
 
 
 
+/*
+ * With a single cpu the buckets are processed strictly in order.
+ */
+void test_bucket_priority_order_single_threaded() {
+  graphlab_options opts;
+  opts.set_ncpus(1);
+  opts.get_scheduler_args().set_option("delta", 10.0);
+  opts.get_scheduler_args().set_option("buckets", 4);
+  bucket_priority_scheduler sched(NUM_VERTICES, opts);
+
+  // vertex i has priority -i, which puts it in bucket i / 10
+  for (size_t i = 0; i < NUM_VERTICES; ++i) {
+    sched.schedule(i, -double(i));
+  }
+  size_t popped = 0;
+  size_t last_bucket = 0;
+  lvid_type v;
+  while (sched.get_next(0, v) == sched_status::NEW_TASK) {
+    // buckets beyond the 4th share the last bucket
+    size_t bucket = std::min<size_t>(v / 10, 3);
+    TS_ASSERT_LESS_THAN_EQUALS(last_bucket, bucket);
+    last_bucket = bucket;
+    ++popped;
+  }
+  TS_ASSERT_EQUALS(popped, NUM_VERTICES);
+  TS_ASSERT(sched.empty());
+}
+
 
 
 
 /*
- * Like test_basic_functionality_thread, but only increments the 
- * correctness_counter by 1, and checks to make sure the priority is at least
- * 100.0
+ * A skewed workload: the vertices form a binary tree and running a vertex
+ * schedules its two children. All the work starts at the root, so the
+ * other workers only get work by taking it from the thread that
+ * scheduled it. The workers are fibers, like in the async engine.
  */
+const size_t SKEW_NUM_VERTICES = 1 << 20;
+atomic<size_t> skew_executed;
+
 template <typename SchedulerType>
-void test_scheduler_min_priority_thread(SchedulerType& sched, 
-                                        async_consensus& consensus, 
-                                        size_t schedule_count,
-                                        size_t threadid) {
-  size_t c = 0;
-  vertex_id_type v; message_type m;
-  while(1) {
-    // process as many tasks as I can
-    while(1) {
-      sched_status::status_enum ret = sched.get_next(threadid, v, m);
-      if (ret == sched_status::NEW_TASK) {
-        TS_ASSERT_LESS_THAN_EQUALS(100.0, m.priority());
-        correctness_counter[v].inc(1);
-      }
-      else {
-        break;
-      }
-    }
-    
-    // schedule 1 cycle. If I schedule stuff I go back to processing tasks
-    if (c < schedule_count) {
-      for (size_t i = 0; i < NUM_VERTICES; ++i) {
-        sched.schedule(i, message_type(1, 1.0));
-        consensus.cancel();
-      }
-      ++c;
-      continue;
-    }
-    
-    // nothing to schedule, nothing to run. try to quit
-    consensus.begin_done_critical_section(threadid);
-    sched_status::status_enum ret = sched.get_next(threadid, v, m);
-    if (ret == sched_status::NEW_TASK) {
-      TS_ASSERT_LESS_THAN_EQUALS(100.0, m.priority());
-      // there is task. cancel, process it, and look back
-      consensus.cancel_critical_section(threadid);
-      correctness_counter[v].inc(1);
-    }
-    else {
-      // no more tasks try to finish up
-      bool ret = consensus.end_done_critical_section(threadid);
-      if (ret) break;
+void skewed_worker(SchedulerType& sched, size_t threadid) {
+  lvid_type v;
+  while(skew_executed.value < SKEW_NUM_VERTICES) {
+    if (sched.get_next(threadid, v) == sched_status::NEW_TASK) {
+      if (2 * v + 1 < SKEW_NUM_VERTICES) sched.schedule(2 * v + 1, 1.0);
+      if (2 * v + 2 < SKEW_NUM_VERTICES) sched.schedule(2 * v + 2, 1.0);
+      skew_executed.inc();
+    } else {
+      fiber_control::yield();
     }
   }
 }
 
-
 template <typename SchedulerType>
-void test_scheduler_min_priority_parallel() {
+double benchmark_skewed_schedule(const std::string& name) {
   graphlab_options opts;
   opts.set_ncpus(NCPUS);
-  opts.get_scheduler_args().set_option("min_priority", 100.0);
-  
-  SchedulerType sched(NUM_VERTICES, opts);
-  async_consensus consensus(dc, NCPUS);
-  
-  const size_t schedule_count = 10000;
-  const size_t maximum_value = (size_t)((schedule_count * NCPUS + 101.0) / 100.0);
-
-  correctness_counter.clear();
-  correctness_counter.resize(NUM_VERTICES, atomic<int>(0));
+  SchedulerType sched(SKEW_NUM_VERTICES, opts);
+  skew_executed.value = 0;
+  sched.schedule(0, 1.0);
 
-  // inject a sequence of messages which will sum to 100 per vertex
-  for (size_t i = 0; i < NUM_VERTICES; ++i) {
-    sched.schedule(i, message_type(1, 101.0));
-  }
-  sched.start();
-  
-  thread_group group;
+  timer ti; ti.start();
+  fiber_group group;
+  size_t nworkers = fiber_control::get_instance().num_workers();
   for (size_t i = 0;i < NCPUS;++i) {
-    group.launch(boost::bind(test_scheduler_min_priority_thread<SchedulerType>,
-                             boost::ref(sched), boost::ref(consensus), schedule_count, i));
+    group.launch(boost::bind(skewed_worker<SchedulerType>,
+                             boost::ref(sched), i), i % nworkers);
   }
-
   group.join();
-  // check the counters
-  for(size_t i = 0; i < NUM_VERTICES; ++i) {
-    TS_ASSERT_LESS_THAN_EQUALS(correctness_counter[i].value, (int)maximum_value);
-  }
+  double runtime = ti.current_time();
+  TS_ASSERT_EQUALS(skew_executed.value, SKEW_NUM_VERTICES);
+  TS_ASSERT(sched.empty());
+  std::cout << "\n" << name << ": " << SKEW_NUM_VERTICES 
+            << " skewed tasks in " << runtime << "s" << std::endl;
+  return runtime;
 }
 
+
 class SerializeTestSuite : public CxxTest::TestSuite {
 public:
   void test_scheduler_basic_single_threaded() {
-    test_scheduler_basic_functionality_single_threaded<sweep_scheduler<message_type> >();
-    test_scheduler_basic_functionality_single_threaded<fifo_scheduler<message_type> >();
-    test_scheduler_basic_functionality_single_threaded<priority_scheduler<message_type> >();
-    test_scheduler_basic_functionality_single_threaded<queued_fifo_scheduler<message_type> >();
+    test_scheduler_basic_functionality_single_threaded<sweep_scheduler>();
+    test_scheduler_basic_functionality_single_threaded<fifo_scheduler>();
+    test_scheduler_basic_functionality_single_threaded<priority_scheduler>();
+    test_scheduler_basic_functionality_single_threaded<queued_fifo_scheduler>();
+    test_scheduler_basic_functionality_single_threaded<work_stealing_scheduler>();
+    test_scheduler_basic_functionality_single_threaded<bucket_priority_scheduler>();
   }
   
   void test_scheduler_basic_parallel() {
-    test_scheduler_basic_functionality_parallel<sweep_scheduler<message_type> >();
-    test_scheduler_basic_functionality_parallel<fifo_scheduler<message_type> >();
-    test_scheduler_basic_functionality_parallel<priority_scheduler<message_type> >();
-    test_scheduler_basic_functionality_parallel<queued_fifo_scheduler<message_type> >();
+    test_scheduler_basic_functionality_parallel<sweep_scheduler>();
+    test_scheduler_basic_functionality_parallel<fifo_scheduler>();
+    test_scheduler_basic_functionality_parallel<priority_scheduler>();
+    test_scheduler_basic_functionality_parallel<queued_fifo_scheduler>();
+    test_scheduler_basic_functionality_parallel<work_stealing_scheduler>();
+    test_scheduler_basic_functionality_parallel<bucket_priority_scheduler>();
   }
   
     
   void test_scheduler_min_priority() {
-    test_scheduler_min_priority_parallel<sweep_scheduler<message_type> >();
-    test_scheduler_min_priority_parallel<fifo_scheduler<message_type> >();
-    test_scheduler_min_priority_parallel<priority_scheduler<message_type> >();
-    test_scheduler_min_priority_parallel<queued_fifo_scheduler<message_type> >();
+    test_scheduler_min_priority_single_threaded();
   }
 
-};
+  void test_bucket_priority_order() {
+    test_bucket_priority_order_single_threaded();
+  }
 
+  void test_scheduler_skewed_benchmark() {
+    benchmark_skewed_schedule<fifo_scheduler>("fifo");
+    benchmark_skewed_schedule<work_stealing_scheduler>("work_stealing");
+  }
+
+};
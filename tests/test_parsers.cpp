@@ -21,7 +21,12 @@
  */
 
 
+#include <cstdlib>
+#include <fstream>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/device/file.hpp>
 #include <graphlab/graph/distributed_graph.hpp>
+#include <graphlab/util/bgzf.hpp>
 #include <graphlab/macros_def.hpp>
 
 typedef graphlab::distributed_graph<size_t, size_t> graph_type;
@@ -79,6 +84,16 @@ void test_snap(graphlab::distributed_control& dc) {
   check_structure(graph);  
 }
 
+void test_split_snap(graphlab::distributed_control& dc) {
+  // force the single snap file to be split into many small byte ranges
+  graphlab::graphlab_options opts;
+  opts.get_graph_args().set_option("ingress_split_bytes", 8);
+  graphlab::distributed_graph<size_t, size_t> graph(dc, opts);
+  graph.load_format("data/test_snap", "snap");
+  graph.finalize();
+  check_structure(graph);
+}
+
 void test_tsv(graphlab::distributed_control& dc) {
   graphlab::distributed_graph<size_t, size_t> graph(dc);
   graph.load_format("data/test_tsv", "tsv");
@@ -95,6 +110,14 @@ void test_powerlaw(graphlab::distributed_control& dc) {
 }
 
 
+void set_edge_data(graph_type::edge_type& edge) {
+  edge.data() = edge.source().id() * 10007 + edge.target().id();
+}
+
+size_t count_bad_edge_data(const graph_type::edge_type& edge) {
+  return edge.data() != edge.source().id() * 10007 + edge.target().id();
+}
+
 void test_save_load(graphlab::distributed_control& dc) {
   graphlab::distributed_graph<size_t, size_t> graph(dc);
   graph.load_synthetic_powerlaw(1000);
@@ -115,6 +138,89 @@ void test_save_load(graphlab::distributed_control& dc) {
   ASSERT_EQ(graph.num_vertices(), graph3.num_vertices());
   ASSERT_EQ(graph.num_edges(), graph3.num_edges());
 
+  // the saved files are BGZF, force them to be split into single blocks
+  graphlab::graphlab_options opts;
+  opts.get_graph_args().set_option("ingress_split_bytes", 8);
+  graphlab::distributed_graph<size_t, size_t> graph5(dc, opts);
+  graph5.load_format("data/plawtest_tsv", "tsv");
+  graph5.finalize();
+  ASSERT_EQ(graph.num_vertices(), graph5.num_vertices());
+  ASSERT_EQ(graph.num_edges(), graph5.num_edges());
+
+  // use small chunks so that every machine loads several of them
+  graph.transform_edges(set_edge_data);
+  graph.save_bincsr("data/plawtest_csr", 100);
+  graphlab::distributed_graph<size_t, size_t> graph4(dc);
+  graph4.load_format("data/plawtest_csr", "bincsr");
+  graph4.finalize();
+  ASSERT_EQ(graph.num_vertices(), graph4.num_vertices());
+  ASSERT_EQ(graph.num_edges(), graph4.num_edges());
+  ASSERT_EQ(graph4.map_reduce_edges<size_t>(count_bad_edge_data), 0);
+}
+
+
+/*
+ * Line i of the long line files is "i" followed by a space and up to 3000
+ * pseudo random letters, which depend only on i. Many lines cross the
+ * 64KB BGZF block boundaries, and the letters keep the compressed file
+ * large enough to be split several ways.
+ */
+const size_t NUM_LONG_LINES = 1000;
+
+std::string long_line_padding(size_t i) {
+  std::string padding((i * 7919) % 3000, ' ');
+  size_t x = i + 1;
+  for (size_t j = 0; j < padding.size(); ++j) {
+    x = x * 1103515245 + 12345;
+    padding[j] = char('a' + (x >> 16) % 26);
+  }
+  return padding;
+}
+
+/// Adds the edge i -> i+1 with data i, after checking the line is intact
+bool long_line_parser(graph_type& graph, const std::string& filename,
+                      const std::string& line) {
+  char* end = NULL;
+  const size_t i = strtoul(line.c_str(), &end, 10);
+  if (end == line.c_str() || *end != ' ') return false;
+  if (std::string(end + 1) != long_line_padding(i)) return false;
+  graph.add_edge(i, i + 1, i);
+  return true;
+}
+
+size_t count_bad_long_line_edge(const graph_type::edge_type& edge) {
+  return edge.data() != edge.source().id() ||
+         edge.target().id() != edge.source().id() + 1;
+}
+
+void test_split_long_lines(graphlab::distributed_control& dc) {
+  if (dc.procid() == 0) {
+    std::ofstream fout("data/longlines_txt");
+    boost::iostreams::filtering_stream<boost::iostreams::output> zout;
+    zout.push(graphlab::bgzf::bgzf_compressor());
+    zout.push(boost::iostreams::file_sink("data/longlines_bgzf.gz"));
+    for (size_t i = 0; i < NUM_LONG_LINES; ++i) {
+      const std::string line = graphlab::tostr(i) + " " + long_line_padding(i) + "\n";
+      fout << line;
+      zout << line;
+    }
+  }
+  dc.barrier();
+  const char* files[] = {"data/longlines_txt", "data/longlines_bgzf.gz"};
+  const size_t split_bytes[] = {0, 8, 5000, 100000};
+  for (size_t f = 0; f < 2; ++f) {
+    for (size_t s = 0; s < 4; ++s) {
+      graphlab::graphlab_options opts;
+      opts.get_graph_args().set_option("ingress_split_bytes", split_bytes[s]);
+      graph_type graph(dc, opts);
+      graph.load(files[f], long_line_parser);
+      graph.finalize();
+      // every line is loaded exactly once
+      ASSERT_EQ(graph.num_edges(), NUM_LONG_LINES);
+      ASSERT_EQ(graph.num_vertices(), NUM_LONG_LINES + 1);
+      ASSERT_EQ(graph.map_reduce_edges<size_t>(count_bad_long_line_edge), 0);
+    }
+  }
 }
 
 
@@ -122,8 +228,10 @@ int main(int argc, char** argv) {
   graphlab::distributed_control dc;
   test_adj(dc);
   test_snap(dc);
+  test_split_snap(dc);
   test_tsv(dc);
   test_powerlaw(dc);
   test_save_load(dc);
+  test_split_long_lines(dc);
 };
 
@@ -98,6 +98,8 @@ struct min_distance_type : graphlab::IS_POD_TYPE {
     dist = std::min(dist, other.dist);
     return *this;
   }
+  /// shorter distances first, for the priority schedulers
+  double priority() const { return -dist; }
 };
 
 